@@ -28,6 +28,12 @@ const TEMPLATES: Template[] = [
     value: "cpp-linux",
     icon: "🐧",
   },
+  {
+    name: "cpp-headless",
+    description: "Headless C++ addon for Linux services",
+    value: "cpp-headless",
+    icon: "⚡",
+  },
   {
     name: "cpp-win32",
     description: "C++ addon for Windows platforms",
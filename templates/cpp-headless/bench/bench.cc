@@ -0,0 +1,129 @@
+// Native throughput of the todo store and the event bridge, without Node.
+// Built as the cpp_bench target; run with `npm run bench`.
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "event_bridge.h"
+#include "todo_store.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char* name, size_t ops, double seconds) {
+  std::printf("%-32s %12.0f ops/s  (%zu ops in %.3f s)\n", name, ops / seconds, ops, seconds);
+}
+
+void bench_store(size_t count) {
+  auto start = Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    cpp_code::add_todo("todo " + std::to_string(i), static_cast<int64_t>(i));
+  }
+  report("store add_todo", count, seconds_since(start));
+
+  cpp_code::TodoFilter filter;
+  filter.from = static_cast<int64_t>(count / 4);
+  filter.to = static_cast<int64_t>(count / 2);
+  const size_t queries = 20;
+  start = Clock::now();
+  size_t matched = 0;
+  for (size_t i = 0; i < queries; ++i) {
+    matched += cpp_code::query_todos(filter).size();
+  }
+  double seconds = seconds_since(start);
+  report("store query_todos (25% match)", queries, seconds);
+  std::printf("%-32s %12.0f todos/s scanned\n", "", count * queries / seconds);
+  (void)matched;
+}
+
+// `producers` threads push `per_producer` events each; one consumer thread
+// sleeps until woken and drains like the JS thread does, checking that each
+// producer's events arrive in the order it pushed them. Returns how many did
+// not.
+size_t bench_bridge(size_t producers, size_t per_producer, size_t capacity = 64 * 1024) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool woken = false;
+
+  cpp_code::EventBridge<uint64_t> bridge(capacity, [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    woken = true;
+    cv.notify_one();
+  });
+
+  const size_t total = producers * per_producer;
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p]() {
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      for (size_t i = 0; i < per_producer; ++i) {
+        bridge.push(p * per_producer + i);
+      }
+    });
+  }
+
+  auto start = Clock::now();
+  go.store(true, std::memory_order_release);
+
+  size_t received = 0;
+  size_t out_of_order = 0;
+  std::vector<uint64_t> next(producers);
+  while (received < total) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&]() { return woken; });
+      woken = false;
+    }
+    received += bridge.drain([&](uint64_t event) {
+      size_t producer = event / per_producer;
+      if (event % per_producer != next[producer]) ++out_of_order;
+      next[producer] = event % per_producer + 1;
+    }, 4096);
+  }
+  double seconds = seconds_since(start);
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto stats = bridge.stats();
+  char name[64];
+  std::snprintf(name, sizeof(name), "bridge push, %zu producer%s%s", producers, producers == 1 ? "" : "s",
+                capacity < 1024 ? ", tiny ring" : "");
+  report(name, total, seconds);
+  std::printf("%-32s %12llu wakeups, %llu overflowed (%.2f%%), %zu out of order\n", "",
+              static_cast<unsigned long long>(stats.wakeups),
+              static_cast<unsigned long long>(stats.overflowed), 100.0 * stats.overflowed / stats.pushed,
+              out_of_order);
+  return out_of_order;
+}
+
+} // namespace
+
+int main() {
+  bench_store(1000000);
+
+  size_t out_of_order = 0;
+  for (size_t producers : {1, 2, 4, 8}) {
+    out_of_order += bench_bridge(producers, 2000000 / producers);
+  }
+  // A ring this small is full nearly all the time, so producers keep waiting
+  // for room while others still hold claimed but unwritten slots, the
+  // interleaving where an event overtaking its producer's older one would
+  // show up.
+  for (size_t producers : {2, 8}) {
+    out_of_order += bench_bridge(producers, 2000000 / producers, 16);
+  }
+  return out_of_order == 0 ? 0 : 1;
+}
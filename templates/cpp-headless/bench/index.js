@@ -0,0 +1,74 @@
+// JS-side throughput of the addon: sync calls, the promise API, and how fast
+// native events reach listeners. Run with `npm run bench`.
+const addon = require("../js/index.js");
+
+function report(name, ops, ms) {
+  const rate = Math.round((ops / ms) * 1000).toLocaleString();
+  console.log(
+    `${name.padEnd(32)} ${rate.padStart(12)} ops/s  (${ops} ops in ${ms.toFixed(1)} ms)`,
+  );
+}
+
+async function main() {
+  const count = 200000;
+  let received = 0;
+  let batches = 0;
+  let done;
+  const allReceived = new Promise((resolve) => (done = resolve));
+
+  addon.on("events", (events) => {
+    received += events.length;
+    batches += 1;
+    if (received >= count * 2) done();
+  });
+
+  let start = performance.now();
+  for (let i = 0; i < count; i++) {
+    addon.addTodo(`todo ${i}`, i);
+  }
+  report("addTodo (sync)", count, performance.now() - start);
+
+  const todos = Array.from({ length: count }, (_, i) => ({
+    text: `bulk ${i}`,
+    date: i,
+  }));
+  start = performance.now();
+  await addon.addTodos(todos);
+  report("addTodos (AsyncWorker)", count, performance.now() - start);
+
+  await allReceived;
+  console.log(
+    `${"events delivered".padEnd(32)} ${received} in ${batches} batches`,
+  );
+
+  const queries = 20;
+  start = performance.now();
+  for (let i = 0; i < queries; i++) {
+    await addon.query({ from: count / 4, to: count / 2, limit: 1000 });
+  }
+  report("query (AsyncWorker)", queries, performance.now() - start);
+
+  const latencies = [];
+  for (let i = 0; i < 1000; i++) {
+    const t = performance.now();
+    await addon.query({ prefix: "todo 1", limit: 1 });
+    latencies.push(performance.now() - t);
+  }
+  latencies.sort((a, b) => a - b);
+  const pct = (p) =>
+    latencies[Math.floor((latencies.length - 1) * p)].toFixed(3);
+  console.log(
+    `${"query latency (ms)".padEnd(32)} p50 ${pct(0.5)}  p99 ${pct(0.99)}`,
+  );
+
+  const bridge = addon.bridgeStats();
+  const overflowed = ((100 * bridge.overflowed) / bridge.pushed).toFixed(2);
+  console.log(
+    `${"bridge overflowed".padEnd(32)} ${overflowed}% of ${bridge.pushed} events, ${bridge.wakeups} wakeups`,
+  );
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
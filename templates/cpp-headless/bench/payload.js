@@ -0,0 +1,38 @@
+// helloWorld() throughput for payloads from 1 KB to 64 MB, passed as a
+// string versus as a Buffer. Run with `npm run bench`.
+const addon = require("../js/index.js");
+
+function time(fn, iterations) {
+  fn();
+  const start = performance.now();
+  for (let i = 0; i < iterations; i++) {
+    fn();
+  }
+  return (performance.now() - start) / iterations;
+}
+
+function formatSize(bytes) {
+  return bytes >= 1 << 20 ? `${bytes >> 20} MB` : `${bytes >> 10} KB`;
+}
+
+console.log(
+  `${"payload".padEnd(8)} ${"string ms".padStart(12)} ${"Buffer ms".padStart(12)} ${"Buffer GB/s".padStart(12)}`,
+);
+
+for (let size = 1 << 10; size <= 64 << 20; size *= 4) {
+  const text = "x".repeat(size);
+  const buffer = Buffer.from(text);
+  // Keep the total work per size roughly constant.
+  const iterations = Math.max(
+    3,
+    Math.min(10000, Math.floor((256 << 20) / size)),
+  );
+
+  const stringMs = time(() => addon.helloWorld(text), iterations);
+  const bufferMs = time(() => addon.helloWorld(buffer), iterations);
+  const gbPerSecond = size / (bufferMs / 1000) / 1e9;
+
+  console.log(
+    `${formatSize(size).padEnd(8)} ${stringMs.toFixed(4).padStart(12)} ${bufferMs.toFixed(4).padStart(12)} ${gbPerSecond.toFixed(2).padStart(12)}`,
+  );
+}
@@ -0,0 +1,58 @@
+{
+  "target_defaults": {
+    "cflags!": ["-fno-exceptions"],
+    "cflags_cc!": ["-fno-exceptions"],
+    "cflags": [
+      "-fexceptions",
+      "-pthread"
+    ],
+    "cflags_cc": [
+      "-std=c++17",
+      "-O3",
+      "-fexceptions",
+      "-pthread"
+    ],
+    "ldflags": [
+      "-pthread"
+    ],
+    "include_dirs": [
+      "include"
+    ],
+    "libraries": [
+      "-luuid"
+    ]
+  },
+  "targets": [
+    {
+      "target_name": "cpp_addon",
+      "conditions": [
+        ['OS=="linux"', {
+          "sources": [
+            "src/cpp_addon.cc",
+            "src/cpp_code.cc",
+            "src/todo_store.cc"
+          ],
+          "include_dirs": [
+            "<!@(node -p \"require('node-addon-api').include\")"
+          ],
+          "defines": ["NODE_ADDON_API_CPP_EXCEPTIONS"],
+          "dependencies": [
+            "<!(node -p \"require('node-addon-api').gyp\")"
+          ]
+        }]
+      ]
+    },
+    {
+      "target_name": "cpp_bench",
+      "type": "executable",
+      "conditions": [
+        ['OS=="linux"', {
+          "sources": [
+            "bench/bench.cc",
+            "src/todo_store.cc"
+          ]
+        }]
+      ]
+    }
+  ]
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace cpp_code {
+
+// Takes a view so callers can pass borrowed memory (e.g. a Buffer's bytes)
+// without copying it into a std::string first.
+std::string hello_world(std::string_view input);
+
+} // namespace cpp_code
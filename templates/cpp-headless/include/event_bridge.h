@@ -0,0 +1,205 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace cpp_code {
+
+// Bounded multi-producer queue (Vyukov's ring). Every cell carries a
+// sequence number, so producers claim a slot with one CAS and the consumer
+// never locks. `capacity` is rounded up to a power of two.
+template <typename T>
+class EventRing {
+public:
+  explicit EventRing(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    mask_ = size - 1;
+    cells_ = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  bool try_push(T&& value) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells_[position & mask_];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          cell.value = std::move(value);
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // full
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Single consumer. False while a producer has claimed a slot but not yet
+  // written it, even if the slot is not at the head.
+  bool empty() const { return tail_.load(std::memory_order_acquire) == head_; }
+
+  // Single consumer.
+  bool try_pop(T& out) {
+    Cell& cell = cells_[head_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) return false;
+    out = std::move(cell.value);
+    cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+private:
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) size_t head_ = 0;
+};
+
+// Hands events from any thread to one consumer thread, normally the JS
+// thread. Construct it on the consumer thread.
+//
+// Producers push into an EventRing without locking. The first push after the
+// consumer has started draining calls `wake` once; later pushes ride along,
+// so a burst costs one wake-up, not one per event. When the ring is full,
+// producers on other threads wait for the consumer to make room, for up to
+// kMaxBackpressure, since one may hold a lock the consumer needs before it
+// can drain. Only events the consumer pushes itself, or that waited that
+// long, go to a locked overflow list. Each producer's events are always
+// delivered in the order it pushed them.
+template <typename T>
+class EventBridge {
+public:
+  struct Stats {
+    uint64_t pushed;
+    uint64_t overflowed;
+    uint64_t wakeups;
+  };
+
+  static constexpr std::chrono::milliseconds kMaxBackpressure{10};
+
+  EventBridge(size_t capacity, std::function<void()> wake)
+      : ring_(capacity), wake_(std::move(wake)), consumer_(std::this_thread::get_id()) {}
+
+  void push(T event) {
+    pushed_.fetch_add(1, std::memory_order_relaxed);
+    // Once anything has overflowed, later events must queue behind it.
+    bool queued = overflow_size_.load(std::memory_order_acquire) == 0 && ring_.try_push(std::move(event));
+    if (!queued && std::this_thread::get_id() != consumer_) {
+      queued = wait_for_room(event);
+    }
+    if (!queued) {
+      std::lock_guard<std::mutex> lock(overflow_mutex_);
+      overflow_.push_back(std::move(event));
+      overflow_size_.fetch_add(1, std::memory_order_release);
+      overflowed_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+      wakeups_.fetch_add(1, std::memory_order_relaxed);
+      wake_();
+    }
+  }
+
+  // Consumer thread only. Hands at most `max` events to `fn` and returns how
+  // many it handed over; if more are left it wakes itself again, so one
+  // drain never monopolizes the consumer.
+  template <typename Fn>
+  size_t drain(Fn&& fn, size_t max) {
+    wake_pending_.store(false, std::memory_order_seq_cst);
+
+    size_t count = 0;
+    T event;
+    while (count < max && ring_.try_pop(event)) {
+      fn(std::move(event));
+      ++count;
+    }
+
+    if (count < max && overflow_size_.load(std::memory_order_acquire) != 0) {
+      std::lock_guard<std::mutex> lock(overflow_mutex_);
+      // Events that reached the ring before the overflow list was seen
+      // empty are older than anything in it.
+      while (count < max && ring_.try_pop(event)) {
+        fn(std::move(event));
+        ++count;
+      }
+      // So is an event still being written into a claimed slot, and the
+      // ring may hold its producer's next one behind it. Leave the overflow
+      // list until the ring is empty; that producer wakes us once written.
+      while (count < max && ring_.empty() && !overflow_.empty()) {
+        fn(std::move(overflow_.front()));
+        overflow_.pop_front();
+        overflow_size_.fetch_sub(1, std::memory_order_release);
+        ++count;
+      }
+    }
+
+    // Pairs with the fence in wait_for_room(): either it sees the room made
+    // here or we see it waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (count > 0 && waiting_.load(std::memory_order_relaxed) != 0) {
+      std::lock_guard<std::mutex> lock(room_mutex_);
+      room_cv_.notify_all();
+    }
+
+    if (count == max && !wake_pending_.exchange(true, std::memory_order_acq_rel)) {
+      wakeups_.fetch_add(1, std::memory_order_relaxed);
+      wake_();
+    }
+    return count;
+  }
+
+  Stats stats() const {
+    return {pushed_.load(std::memory_order_relaxed), overflowed_.load(std::memory_order_relaxed),
+            wakeups_.load(std::memory_order_relaxed)};
+  }
+
+private:
+  // Earlier pushes already woke the consumer, which frees room as it drains.
+  bool wait_for_room(T& event) {
+    std::unique_lock<std::mutex> lock(room_mutex_);
+    waiting_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool queued = room_cv_.wait_for(lock, kMaxBackpressure, [&]() {
+      return overflow_size_.load(std::memory_order_acquire) == 0 && ring_.try_push(std::move(event));
+    });
+    waiting_.fetch_sub(1, std::memory_order_relaxed);
+    return queued;
+  }
+
+  EventRing<T> ring_;
+  std::function<void()> wake_;
+  std::atomic<bool> wake_pending_{false};
+  const std::thread::id consumer_;
+
+  std::mutex room_mutex_;
+  std::condition_variable room_cv_;
+  std::atomic<size_t> waiting_{0};
+
+  std::mutex overflow_mutex_;
+  std::deque<T> overflow_;
+  std::atomic<size_t> overflow_size_{0};
+
+  std::atomic<uint64_t> pushed_{0};
+  std::atomic<uint64_t> overflowed_{0};
+  std::atomic<uint64_t> wakeups_{0};
+};
+
+} // namespace cpp_code
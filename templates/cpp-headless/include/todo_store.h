@@ -0,0 +1,46 @@
+#pragma once
+#include <uuid/uuid.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace cpp_code {
+
+struct TodoItem {
+  uuid_t id;
+  std::string text;
+  int64_t date;
+};
+
+enum class TodoChange : uint8_t { Added, Updated, Deleted };
+
+struct TodoFilter {
+  int64_t from = std::numeric_limits<int64_t>::min();
+  int64_t to = std::numeric_limits<int64_t>::max();
+  std::string prefix;
+  size_t limit = std::numeric_limits<size_t>::max();
+};
+
+// The todo list. Every function may be called from any thread; reads run
+// concurrently with each other and mutations are serialized. Todos keep
+// insertion order, except that deleting one moves the last todo into its
+// place.
+TodoItem add_todo(const std::string& text, int64_t date);
+bool update_todo(const uuid_t id, const std::string& text, int64_t date);
+bool delete_todo(const uuid_t id);
+size_t todo_count();
+
+// Matches in list order, at most `filter.limit` of them.
+std::vector<TodoItem> query_todos(const TodoFilter& filter);
+
+// Called on the mutating thread after every mutation, in mutation order,
+// with the item as stored (or as it was before deletion). It must not mutate
+// the store. Replacing it waits for in-flight mutations, so once this returns
+// the previous listener is no longer running.
+using TodoListener = std::function<void(TodoChange, const TodoItem&)>;
+void set_todo_listener(TodoListener listener);
+
+} // namespace cpp_code
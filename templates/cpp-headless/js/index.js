@@ -0,0 +1,92 @@
+const EventEmitter = require("events");
+
+class CppHeadlessAddon extends EventEmitter {
+  constructor() {
+    super();
+
+    if (process.platform !== "linux") {
+      throw new Error("This module is only available on Linux");
+    }
+
+    const native = require("bindings")("cpp_addon");
+    this.addon = new native.CppHeadlessAddon();
+
+    // Native events arrive in batches, one call per wake-up of the JS thread.
+    // Listen to "events" to handle a batch at once, or to todoAdded,
+    // todoUpdated and todoDeleted for one event at a time.
+    this.addon.onEvents((events) => {
+      for (const event of events) {
+        event.date = new Date(event.date);
+      }
+
+      this.emit("events", events);
+
+      for (const { type, ...todo } of events) {
+        this.emit(type, todo);
+      }
+    });
+  }
+
+  // Pass a Buffer, Uint8Array or ArrayBuffer to get a Buffer back without
+  // the payload being transcoded or copied across the boundary.
+  helloWorld(input = "") {
+    return this.addon.helloWorld(input);
+  }
+
+  addTodo(text, date) {
+    return this.#parse(this.addon.addTodo(text, this.#time(date)));
+  }
+
+  updateTodo(id, text, date) {
+    return this.addon.updateTodo(id, text, this.#time(date));
+  }
+
+  deleteTodo(id) {
+    return this.addon.deleteTodo(id);
+  }
+
+  count() {
+    return this.addon.count();
+  }
+
+  // Inserts [{ text, date }, ...] on the libuv thread pool. Resolves with the
+  // number of todos added.
+  addTodos(todos) {
+    return this.addon.addTodos(
+      todos.map(({ text, date }) => ({ text, date: this.#time(date) })),
+    );
+  }
+
+  // Resolves with the todos dated in [from, to] whose text starts with
+  // prefix, at most limit of them. The filtering runs off the JS thread.
+  async query({ from, to, prefix, limit } = {}) {
+    const todos = await this.addon.query({
+      from: this.#time(from),
+      to: this.#time(to),
+      prefix,
+      limit,
+    });
+
+    return todos.map((todo) => this.#parse(todo));
+  }
+
+  // { pushed, overflowed, wakeups } of the native event bridge. overflowed
+  // counts events that found the ring full; wakeups counts JS-thread wakes.
+  bridgeStats() {
+    return this.addon.bridgeStats();
+  }
+
+  #time(date) {
+    return date instanceof Date ? date.getTime() : date;
+  }
+
+  #parse(todo) {
+    return { ...todo, date: new Date(todo.date) };
+  }
+}
+
+if (process.platform === "linux") {
+  module.exports = new CppHeadlessAddon();
+} else {
+  module.exports = {};
+}
@@ -0,0 +1,412 @@
+#include <napi.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cpp_code.h"
+#include "event_bridge.h"
+#include "todo_store.h"
+#include <uuid/uuid.h>
+
+namespace {
+
+struct TodoEvent {
+    cpp_code::TodoChange change;
+    cpp_code::TodoItem todo;
+};
+
+// Events handed to JS per wake-up; the rest wait for the next turn of the
+// event loop so a flood of events cannot starve other callbacks.
+constexpr size_t kMaxEventsPerDrain = 4096;
+
+const char* ChangeName(cpp_code::TodoChange change) {
+    switch (change) {
+    case cpp_code::TodoChange::Added:
+        return "todoAdded";
+    case cpp_code::TodoChange::Updated:
+        return "todoUpdated";
+    case cpp_code::TodoChange::Deleted:
+        break;
+    }
+    return "todoDeleted";
+}
+
+Napi::Object TodoToObject(Napi::Env env, const cpp_code::TodoItem& todo) {
+    char uuid_str[37];
+    uuid_unparse(todo.id, uuid_str);
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("id", Napi::String::New(env, uuid_str));
+    result.Set("text", Napi::String::New(env, todo.text));
+    result.Set("date", Napi::Number::New(env, static_cast<double>(todo.date)));
+    return result;
+}
+
+bool ParseId(const Napi::Value& value, uuid_t id) {
+    return value.IsString() && uuid_parse(value.As<Napi::String>().Utf8Value().c_str(), id) == 0;
+}
+
+// Hands `bytes` to JS as a Buffer without copying; the string is freed when
+// the Buffer is collected. Runtimes that forbid external buffers (Electron's
+// V8 memory cage) get a copy instead.
+Napi::Value ToExternalBuffer(Napi::Env env, std::string&& bytes) {
+    auto* owned = new std::string(std::move(bytes));
+    return Napi::Buffer<char>::NewOrCopy(
+        env, owned->data(), owned->size(),
+        [](Napi::Env, char*, std::string* owned) { delete owned; }, owned);
+}
+
+#if NAPI_VERSION >= 10
+// Below this, an external string costs more to set up than the copy saves.
+constexpr size_t kExternalStringMinBytes = 4096;
+
+bool IsAscii(const std::string& text) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    for (; end - p >= 8; p += 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        if (word & 0x8080808080808080ull) return false;
+    }
+    for (; p < end; ++p) {
+        if (static_cast<unsigned char>(*p) & 0x80) return false;
+    }
+    return true;
+}
+#endif
+
+// With Node-API 10 (Node 22.14+, enable with NAPI_VERSION=10) large ASCII
+// results become external strings that V8 reads from native memory, since
+// ASCII is valid Latin-1. Everything else is copied into a JS string.
+Napi::Value ToJsString(Napi::Env env, std::string&& text) {
+#if NAPI_VERSION >= 10
+    if (text.size() >= kExternalStringMinBytes && IsAscii(text)) {
+        auto* owned = new std::string(std::move(text));
+        napi_value result;
+        bool copied;
+        napi_status status = node_api_create_external_string_latin1(
+            env, owned->data(), owned->size(),
+            [](node_api_basic_env, void*, void* hint) { delete static_cast<std::string*>(hint); },
+            owned, &result, &copied);
+        if (status == napi_ok) {
+            // If V8 copied it, the finalizer has already freed `owned`.
+            return Napi::Value(env, result);
+        }
+        text = std::move(*owned);
+        delete owned;
+    }
+#endif
+    return Napi::String::New(env, text);
+}
+
+// Bulk insert on the libuv thread pool.
+class AddTodosWorker : public Napi::AsyncWorker {
+public:
+    AddTodosWorker(Napi::Env env, std::vector<std::pair<std::string, int64_t>> todos)
+        : Napi::AsyncWorker(env)
+        , deferred_(Napi::Promise::Deferred::New(env))
+        , todos_(std::move(todos)) {}
+
+    Napi::Promise Promise() { return deferred_.Promise(); }
+
+    void Execute() override {
+        for (auto& todo : todos_) {
+            cpp_code::add_todo(todo.first, todo.second);
+        }
+    }
+
+    void OnOK() override {
+        deferred_.Resolve(Napi::Number::New(Env(), static_cast<double>(todos_.size())));
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    std::vector<std::pair<std::string, int64_t>> todos_;
+};
+
+// Filtering runs on the libuv thread pool; only the JS objects for the
+// matches are built on the JS thread.
+class QueryWorker : public Napi::AsyncWorker {
+public:
+    QueryWorker(Napi::Env env, cpp_code::TodoFilter filter)
+        : Napi::AsyncWorker(env)
+        , deferred_(Napi::Promise::Deferred::New(env))
+        , filter_(std::move(filter)) {}
+
+    Napi::Promise Promise() { return deferred_.Promise(); }
+
+    void Execute() override {
+        matches_ = cpp_code::query_todos(filter_);
+    }
+
+    void OnOK() override {
+        Napi::Env env = Env();
+        Napi::Array result = Napi::Array::New(env, matches_.size());
+        for (size_t i = 0; i < matches_.size(); ++i) {
+            result.Set(static_cast<uint32_t>(i), TodoToObject(env, matches_[i]));
+        }
+        deferred_.Resolve(result);
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    cpp_code::TodoFilter filter_;
+    std::vector<cpp_code::TodoItem> matches_;
+};
+
+} // namespace
+
+class CppAddon : public Napi::ObjectWrap<CppAddon> {
+public:
+    static Napi::Object Init(Napi::Env env, Napi::Object exports) {
+        Napi::Function func = DefineClass(env, "CppHeadlessAddon", {
+            InstanceMethod("helloWorld", &CppAddon::HelloWorld),
+            InstanceMethod("addTodo", &CppAddon::AddTodo),
+            InstanceMethod("updateTodo", &CppAddon::UpdateTodo),
+            InstanceMethod("deleteTodo", &CppAddon::DeleteTodo),
+            InstanceMethod("count", &CppAddon::Count),
+            InstanceMethod("addTodos", &CppAddon::AddTodos),
+            InstanceMethod("query", &CppAddon::Query),
+            InstanceMethod("bridgeStats", &CppAddon::BridgeStats),
+            InstanceMethod("onEvents", &CppAddon::OnEvents)
+        });
+
+        Napi::FunctionReference* constructor = new Napi::FunctionReference();
+        *constructor = Napi::Persistent(func);
+        env.SetInstanceData(constructor);
+
+        exports.Set("CppHeadlessAddon", func);
+        return exports;
+    }
+
+    CppAddon(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<CppAddon>(info)
+        , tsfn_(nullptr) {
+        Napi::Env env = info.Env();
+
+        napi_status status = napi_create_threadsafe_function(
+            env,
+            nullptr,
+            nullptr,
+            Napi::String::New(env, "CppEventBridge"),
+            0,
+            1,
+            nullptr,
+            nullptr,
+            this,
+            [](napi_env env, napi_value, void* context, void*) {
+                if (env == nullptr) return;
+                static_cast<CppAddon*>(context)->DrainEvents(Napi::Env(env));
+            },
+            &tsfn_
+        );
+
+        if (status != napi_ok) {
+            Napi::Error::New(env, "Failed to create threadsafe function").ThrowAsJavaScriptException();
+            return;
+        }
+        // Pending events alone should not keep the process alive.
+        napi_unref_threadsafe_function(env, tsfn_);
+
+        bridge_ = std::make_unique<cpp_code::EventBridge<TodoEvent>>(64 * 1024, [this]() {
+            napi_call_threadsafe_function(tsfn_, nullptr, napi_tsfn_nonblocking);
+        });
+
+        cpp_code::set_todo_listener([this](cpp_code::TodoChange change, const cpp_code::TodoItem& todo) {
+            bridge_->push(TodoEvent{change, todo});
+        });
+    }
+
+    ~CppAddon() {
+        // Once the listener is replaced no producer can touch the bridge.
+        cpp_code::set_todo_listener(nullptr);
+        if (tsfn_ != nullptr) {
+            napi_release_threadsafe_function(tsfn_, napi_tsfn_abort);
+            tsfn_ = nullptr;
+        }
+    }
+
+private:
+    napi_threadsafe_function tsfn_;
+    std::unique_ptr<cpp_code::EventBridge<TodoEvent>> bridge_;
+    Napi::FunctionReference eventsCallback_;
+
+    // Delivers a batch as one call with an array of events.
+    void DrainEvents(Napi::Env env) {
+        Napi::HandleScope scope(env);
+        std::vector<TodoEvent> batch;
+        bridge_->drain([&batch](TodoEvent&& event) { batch.push_back(std::move(event)); },
+                       kMaxEventsPerDrain);
+        if (batch.empty() || eventsCallback_.IsEmpty()) return;
+
+        Napi::Array events = Napi::Array::New(env, batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Napi::Object event = TodoToObject(env, batch[i].todo);
+            event.Set("type", Napi::String::New(env, ChangeName(batch[i].change)));
+            events.Set(static_cast<uint32_t>(i), event);
+        }
+
+        try {
+            eventsCallback_.Call({events});
+        } catch (...) {}
+    }
+
+    // Strings are transcoded in and out as usual. A Buffer, Uint8Array or
+    // ArrayBuffer is read in place and answered with a Buffer that wraps the
+    // native result, so a large payload is copied once instead of three times.
+    Napi::Value HelloWorld(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() >= 1 && info[0].IsBuffer()) {
+            Napi::Buffer<char> input = info[0].As<Napi::Buffer<char>>();
+            return ToExternalBuffer(env, cpp_code::hello_world({input.Data(), input.Length()}));
+        }
+
+        if (info.Length() >= 1 && info[0].IsArrayBuffer()) {
+            Napi::ArrayBuffer input = info[0].As<Napi::ArrayBuffer>();
+            return ToExternalBuffer(env, cpp_code::hello_world(
+                {static_cast<const char*>(input.Data()), input.ByteLength()}));
+        }
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Expected string, Buffer or ArrayBuffer argument").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string input = info[0].As<Napi::String>();
+        return ToJsString(env, cpp_code::hello_world(input));
+    }
+
+    Napi::Value AddTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        cpp_code::TodoItem todo = cpp_code::add_todo(
+            info[0].As<Napi::String>(), info[1].As<Napi::Number>().Int64Value());
+        return TodoToObject(env, todo);
+    }
+
+    Napi::Value UpdateTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        uuid_t id;
+        if (info.Length() < 3 || !ParseId(info[0], id) || !info[1].IsString() || !info[2].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (id, string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        bool updated = cpp_code::update_todo(
+            id, info[1].As<Napi::String>(), info[2].As<Napi::Number>().Int64Value());
+        return Napi::Boolean::New(env, updated);
+    }
+
+    Napi::Value DeleteTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        uuid_t id;
+        if (info.Length() < 1 || !ParseId(info[0], id)) {
+            Napi::TypeError::New(env, "Expected a todo id").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return Napi::Boolean::New(env, cpp_code::delete_todo(id));
+    }
+
+    Napi::Value Count(const Napi::CallbackInfo& info) {
+        return Napi::Number::New(info.Env(), static_cast<double>(cpp_code::todo_count()));
+    }
+
+    Napi::Value AddTodos(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsArray()) {
+            Napi::TypeError::New(env, "Expected an array of { text, date }").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Array items = info[0].As<Napi::Array>();
+        std::vector<std::pair<std::string, int64_t>> todos;
+        todos.reserve(items.Length());
+        for (uint32_t i = 0; i < items.Length(); ++i) {
+            Napi::Value item = items.Get(i);
+            if (!item.IsObject()) continue;
+            Napi::Object todo = item.As<Napi::Object>();
+            if (!todo.Get("text").IsString() || !todo.Get("date").IsNumber()) continue;
+            todos.emplace_back(todo.Get("text").As<Napi::String>().Utf8Value(),
+                               todo.Get("date").As<Napi::Number>().Int64Value());
+        }
+
+        auto* worker = new AddTodosWorker(env, std::move(todos));
+        Napi::Promise promise = worker->Promise();
+        worker->Queue();
+        return promise;
+    }
+
+    Napi::Value Query(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoFilter filter;
+        if (info.Length() > 0 && info[0].IsObject()) {
+            Napi::Object options = info[0].As<Napi::Object>();
+            if (options.Get("from").IsNumber()) {
+                filter.from = options.Get("from").As<Napi::Number>().Int64Value();
+            }
+            if (options.Get("to").IsNumber()) {
+                filter.to = options.Get("to").As<Napi::Number>().Int64Value();
+            }
+            if (options.Get("prefix").IsString()) {
+                filter.prefix = options.Get("prefix").As<Napi::String>().Utf8Value();
+            }
+            Napi::Value limit = options.Get("limit");
+            if (limit.IsNumber() && limit.As<Napi::Number>().Int64Value() >= 0) {
+                filter.limit = static_cast<size_t>(limit.As<Napi::Number>().Int64Value());
+            }
+        }
+
+        auto* worker = new QueryWorker(env, std::move(filter));
+        Napi::Promise promise = worker->Promise();
+        worker->Queue();
+        return promise;
+    }
+
+    Napi::Value BridgeStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        auto stats = bridge_->stats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("pushed", Napi::Number::New(env, static_cast<double>(stats.pushed)));
+        result.Set("overflowed", Napi::Number::New(env, static_cast<double>(stats.overflowed)));
+        result.Set("wakeups", Napi::Number::New(env, static_cast<double>(stats.wakeups)));
+        return result;
+    }
+
+    Napi::Value OnEvents(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsFunction()) {
+            Napi::TypeError::New(env, "Expected a function").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        eventsCallback_ = Napi::Persistent(info[0].As<Napi::Function>());
+        return env.Undefined();
+    }
+};
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    return CppAddon::Init(env, exports);
+}
+
+NODE_API_MODULE(cpp_addon, Init)
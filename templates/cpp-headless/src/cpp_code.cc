@@ -0,0 +1,18 @@
+#include "cpp_code.h"
+
+namespace cpp_code
+{
+
+  // Basic functions
+  std::string hello_world(std::string_view input)
+  {
+    static constexpr std::string_view prefix = "Hello from C++! You said: ";
+
+    std::string result;
+    result.reserve(prefix.size() + input.size());
+    result.append(prefix);
+    result.append(input);
+    return result;
+  }
+
+} // namespace cpp_code
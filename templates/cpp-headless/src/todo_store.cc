@@ -0,0 +1,121 @@
+#include "todo_store.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    struct IdHash
+    {
+      size_t operator()(const std::string &key) const
+      {
+        // Ids are random, so any eight of their bytes are a good hash.
+        size_t hash;
+        memcpy(&hash, key.data(), sizeof(hash));
+        return hash;
+      }
+    };
+
+    std::shared_mutex g_mutex;
+    std::vector<TodoItem> g_todos;
+    // Id -> position in g_todos, so updates and deletes do not scan.
+    std::unordered_map<std::string, size_t, IdHash> g_index;
+    TodoListener g_listener;
+
+    std::string key_of(const uuid_t id)
+    {
+      return std::string(reinterpret_cast<const char *>(id), sizeof(uuid_t));
+    }
+
+    void notify(TodoChange change, const TodoItem &todo)
+    {
+      if (g_listener)
+        g_listener(change, todo);
+    }
+  }
+
+  TodoItem add_todo(const std::string &text, int64_t date)
+  {
+    TodoItem todo;
+    uuid_generate(todo.id);
+    todo.text = text;
+    todo.date = date;
+
+    std::unique_lock<std::shared_mutex> lock(g_mutex);
+    g_index.emplace(key_of(todo.id), g_todos.size());
+    g_todos.push_back(todo);
+    notify(TodoChange::Added, todo);
+    return todo;
+  }
+
+  bool update_todo(const uuid_t id, const std::string &text, int64_t date)
+  {
+    std::unique_lock<std::shared_mutex> lock(g_mutex);
+    auto it = g_index.find(key_of(id));
+    if (it == g_index.end())
+      return false;
+
+    TodoItem &todo = g_todos[it->second];
+    todo.text = text;
+    todo.date = date;
+    notify(TodoChange::Updated, todo);
+    return true;
+  }
+
+  bool delete_todo(const uuid_t id)
+  {
+    std::unique_lock<std::shared_mutex> lock(g_mutex);
+    auto it = g_index.find(key_of(id));
+    if (it == g_index.end())
+      return false;
+
+    // Swap with the last todo so a delete is O(1) instead of shifting and
+    // reindexing the tail.
+    size_t position = it->second;
+    g_index.erase(it);
+    TodoItem deleted = std::move(g_todos[position]);
+    if (position + 1 != g_todos.size())
+    {
+      g_todos[position] = std::move(g_todos.back());
+      g_index[key_of(g_todos[position].id)] = position;
+    }
+    g_todos.pop_back();
+    notify(TodoChange::Deleted, deleted);
+    return true;
+  }
+
+  size_t todo_count()
+  {
+    std::shared_lock<std::shared_mutex> lock(g_mutex);
+    return g_todos.size();
+  }
+
+  std::vector<TodoItem> query_todos(const TodoFilter &filter)
+  {
+    std::shared_lock<std::shared_mutex> lock(g_mutex);
+    std::vector<TodoItem> matches;
+    for (auto &todo : g_todos)
+    {
+      if (matches.size() >= filter.limit)
+        break;
+      if (todo.date < filter.from || todo.date > filter.to)
+        continue;
+      if (todo.text.compare(0, filter.prefix.size(), filter.prefix) != 0)
+        continue;
+      matches.push_back(todo);
+    }
+    return matches;
+  }
+
+  void set_todo_listener(TodoListener listener)
+  {
+    std::unique_lock<std::shared_mutex> lock(g_mutex);
+    g_listener = std::move(listener);
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,77 @@
+// Write throughput of the sharded multi-list store (todo_lists.h) as writer
+// threads are added, against the same store with a single shard, which
+// behaves like one global lock. Run with `npm run bench`.
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "todo_lists.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kOpsPerThread = 200000;
+constexpr size_t kListsPerThread = 64;
+
+// Each writer owns its own lists, as users editing their own lists would:
+// three adds, then an update and, every other time, a delete.
+void writer(cpp_code::TodoLists& lists, size_t thread) {
+  std::vector<std::string> names;
+  for (size_t i = 0; i < kListsPerThread; ++i) {
+    names.push_back("user-" + std::to_string(thread) + "-list-" + std::to_string(i));
+  }
+  std::vector<std::vector<cpp_code::TodoItem>> added(kListsPerThread);
+  const std::string text = "Review the quarterly report";
+
+  for (size_t op = 0; op < kOpsPerThread; ++op) {
+    size_t list = (op * 7 + thread) % kListsPerThread;
+    auto& todos = added[list];
+    switch (op % 5) {
+    case 3:
+      if (!todos.empty()) {
+        lists.update(names[list], todos[op % todos.size()].id, text, static_cast<int64_t>(op));
+        break;
+      }
+      [[fallthrough]];
+    case 4:
+      if (op % 10 == 4 && !todos.empty()) {
+        lists.remove(names[list], todos.back().id);
+        todos.pop_back();
+        break;
+      }
+      [[fallthrough]];
+    default:
+      todos.push_back(lists.add(names[list], text, static_cast<int64_t>(op)));
+    }
+  }
+}
+
+double run(size_t shards, size_t threads) {
+  cpp_code::TodoLists lists(shards);
+  // An observer makes every mutation build its event, as the addon's does.
+  lists.set_observer([](const cpp_code::TodoListEvent&) {});
+
+  auto start = Clock::now();
+  std::vector<std::thread> writers;
+  for (size_t t = 0; t < threads; ++t) {
+    writers.emplace_back([&lists, t] { writer(lists, t); });
+  }
+  for (auto& thread : writers) thread.join();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  return threads * kOpsPerThread / seconds;
+}
+
+} // namespace
+
+int main() {
+  std::printf("%8s %16s %16s %8s\n", "writers", "1 shard ops/s", "sharded ops/s", "speedup");
+  for (size_t threads : {1, 2, 4, 8, 16, 32}) {
+    double single = run(1, threads);
+    double sharded = run(cpp_code::TodoLists::kDefaultShards, threads);
+    std::printf("%8zu %16.0f %16.0f %7.2fx\n", threads, single, sharded, sharded / single);
+  }
+  std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+  return 0;
+}
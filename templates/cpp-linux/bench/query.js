@@ -0,0 +1,100 @@
+// query() against the same filter and sort written with Array.filter() and
+// Array.sort() over plain objects, on the same todos. Run with
+// `npm run bench:query`.
+const addon = require("../js/index.js");
+
+const count = 200000;
+const repeats = 15;
+const words = ["Buy", "Call", "Email", "Fix", "Plan", "Read", "Write"];
+const hourMs = 3600 * 1000;
+const monthMs = 30 * 24 * hourMs;
+
+function median(values) {
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.floor(sorted.length / 2)];
+}
+
+function time(fn) {
+  const samples = [];
+  let result;
+  for (let i = 0; i < repeats; i++) {
+    const start = performance.now();
+    result = fn();
+    samples.push(performance.now() - start);
+  }
+  return { ms: median(samples), result };
+}
+
+// Texts compare by code unit, like the native byte order for ASCII.
+function byText(a, b) {
+  return a.text < b.text ? -1 : a.text > b.text ? 1 : 0;
+}
+
+function jsQuery(todos, { filter = {}, sortBy, limit = Infinity }) {
+  const { from = -Infinity, to = Infinity, prefix = "" } = filter;
+  const matches = todos.filter(
+    (todo) =>
+      todo.date >= from && todo.date <= to && todo.text.startsWith(prefix),
+  );
+  if (sortBy === "date") matches.sort((a, b) => a.date - b.date);
+  if (sortBy === "-date") matches.sort((a, b) => b.date - a.date);
+  if (sortBy === "text") matches.sort(byText);
+  return matches.slice(0, limit).map((todo) => todo.id);
+}
+
+async function main() {
+  // Kept in insertion order, which is also the store's list order, so both
+  // sides break ties the same way.
+  const todos = [];
+  const base = Date.UTC(2026, 0, 1);
+  for (let i = 0; i < count; i += 1000) {
+    const batch = [];
+    for (let j = i; j < Math.min(i + 1000, count); j++) {
+      const text = `${words[j % words.length]} item ${(j * 7919) % count}`;
+      const hour = (j * 104729) % (365 * 24);
+      batch.push(addon.addTodo(text, base + hour * hourMs));
+    }
+    for (const todo of await Promise.all(batch)) {
+      todos.push({ id: todo.id, text: todo.text, date: todo.date.getTime() });
+    }
+  }
+
+  const month = { from: base, to: base + monthMs };
+  const half = { from: base, to: base + 6 * monthMs };
+  const cases = [
+    ["month", { filter: month }],
+    ["month, -date, top 100", { filter: month, sortBy: "-date", limit: 100 }],
+    ["six months, date", { filter: half, sortBy: "date" }],
+    ['prefix "Fix", text', { filter: { prefix: "Fix" }, sortBy: "text" }],
+    ["everything, -date, top 10", { sortBy: "-date", limit: 10 }],
+  ];
+
+  console.log(`${count} todos, median of ${repeats} runs\n`);
+  console.log(
+    `${"query".padEnd(28)} ${"matches".padStart(8)} ` +
+      `${"query() ms".padStart(11)} ${"JS ms".padStart(8)} ` +
+      `${"speedup".padStart(8)}  same`,
+  );
+  for (const [name, options] of cases) {
+    const native = time(() => addon.query(options));
+    const js = time(() => jsQuery(todos, options));
+    const same =
+      native.result.length === js.result.length &&
+      native.result.every((id, i) => id === js.result[i]);
+    const matches = String(js.result.length).padStart(8);
+    const nativeMs = native.ms.toFixed(2).padStart(11);
+    const jsMs = js.ms.toFixed(2).padStart(8);
+    const speedup = `${(js.ms / native.ms).toFixed(1)}x`.padStart(8);
+    console.log(
+      `${name.padEnd(28)} ${matches} ${nativeMs} ${jsMs} ${speedup}  ` +
+        (same ? "yes" : "NO"),
+    );
+  }
+
+  addon.dispose();
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
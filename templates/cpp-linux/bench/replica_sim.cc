@@ -0,0 +1,160 @@
+// Simulated replicas of todo_replica.h in one process: random edits on
+// skewed clocks, syncs that are lost or arrive late, then a check that every
+// replica converged; and the cost of a sync as the list grows while the
+// divergence stays fixed. Run with `npm run sim:replicas`.
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "todo_replica.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kReplicas = 5;
+constexpr size_t kRounds = 200;
+constexpr size_t kEditsPerRound = 20;
+constexpr size_t kSyncsPerRound = 6;
+
+struct Batch {
+  size_t to;
+  std::string deltas;
+  size_t due; // round it is delivered in
+};
+
+void random_edit(cpp_code::TodoReplica& replica, std::mt19937_64& rng, size_t round) {
+  std::vector<cpp_code::TodoItem> items = replica.items();
+  size_t kind = rng() % 10;
+  if (items.empty() || kind < 4) {
+    replica.add("todo " + std::to_string(rng() % 100000), static_cast<int64_t>(round));
+    return;
+  }
+  const cpp_code::TodoItem& target = items[rng() % items.size()];
+  if (kind < 6) {
+    replica.update(target.id, "edited " + std::to_string(rng() % 1000), std::nullopt);
+  } else if (kind < 8) {
+    replica.update(target.id, std::nullopt, static_cast<int64_t>(rng() % 1000));
+  } else {
+    replica.remove(target.id);
+  }
+}
+
+bool same(const std::vector<cpp_code::TodoItem>& a, const std::vector<cpp_code::TodoItem>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (uuid_compare(a[i].id, b[i].id) != 0 || a[i].text != b[i].text || a[i].date != b[i].date) return false;
+  }
+  return true;
+}
+
+bool converge() {
+  std::mt19937_64 rng(42);
+  // Wall clocks up to two seconds apart, so stamps from different replicas
+  // regularly disagree with the order edits were made in.
+  auto start = std::chrono::system_clock::now();
+  std::vector<std::unique_ptr<cpp_code::TodoReplica>> replicas;
+  for (size_t i = 0; i < kReplicas; ++i) {
+    int64_t skew = static_cast<int64_t>(rng() % 4000) - 2000;
+    replicas.push_back(std::make_unique<cpp_code::TodoReplica>(i + 1, [start, skew]() {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(start.time_since_epoch()).count() + skew;
+    }));
+  }
+
+  std::deque<Batch> in_flight;
+  cpp_code::TodoMergeResult totals{};
+  size_t lost = 0;
+  for (size_t round = 0; round < kRounds; ++round) {
+    for (size_t e = 0; e < kEditsPerRound; ++e) {
+      random_edit(*replicas[rng() % kReplicas], rng, round);
+    }
+    for (size_t s = 0; s < kSyncsPerRound; ++s) {
+      size_t from = rng() % kReplicas;
+      size_t to = (from + 1 + rng() % (kReplicas - 1)) % kReplicas;
+      std::string deltas = replicas[from]->deltas_since(replicas[to]->summary());
+      if (rng() % 10 == 0) {
+        ++lost;
+        continue;
+      }
+      in_flight.push_back({to, std::move(deltas), round + rng() % 3});
+    }
+    for (size_t n = in_flight.size(); n > 0; --n) {
+      Batch batch = std::move(in_flight.front());
+      in_flight.pop_front();
+      if (batch.due > round) {
+        in_flight.push_back(std::move(batch));
+        continue;
+      }
+      cpp_code::TodoMergeResult result = replicas[batch.to]->merge(batch.deltas);
+      totals.applied += result.applied;
+      totals.duplicates += result.duplicates;
+      totals.deferred += result.deferred;
+    }
+  }
+
+  // Anti-entropy: every pair syncs until nothing is missing.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (auto& from : replicas) {
+      for (auto& to : replicas) {
+        if (from != to) to->merge(from->deltas_since(to->summary()));
+      }
+    }
+  }
+
+  std::vector<cpp_code::TodoItem> expected = replicas[0]->items();
+  bool converged = true;
+  for (auto& replica : replicas) {
+    converged = converged && same(replica->items(), expected) &&
+                replica->operation_count() == replicas[0]->operation_count();
+  }
+  std::printf("%zu replicas, %llu operations, %zu todos: %s\n", kReplicas,
+              static_cast<unsigned long long>(replicas[0]->operation_count()), expected.size(),
+              converged ? "converged" : "DIVERGED");
+  std::printf("while partitioned: %llu applied, %llu duplicates, %llu deferred, %zu batches lost\n\n",
+              static_cast<unsigned long long>(totals.applied), static_cast<unsigned long long>(totals.duplicates),
+              static_cast<unsigned long long>(totals.deferred), lost);
+  return converged;
+}
+
+// A replica that already has the list receives 100 edits.
+void sync_cost() {
+  std::printf("%10s %14s %16s %12s\n", "todos", "full sync ms", "100 edits us", "delta bytes");
+  for (size_t size : {1000, 10000, 100000, 500000}) {
+    cpp_code::TodoReplica a(1);
+    cpp_code::TodoReplica b(2);
+    std::vector<cpp_code::TodoItem> added;
+    for (size_t i = 0; i < size; ++i) {
+      added.push_back(a.add("Review the quarterly report", static_cast<int64_t>(i)));
+    }
+
+    auto start = Clock::now();
+    b.merge(a.deltas_since(b.summary()));
+    double full_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    constexpr int kRepeats = 20;
+    double edit_us = 0;
+    size_t bytes = 0;
+    for (int r = 0; r < kRepeats; ++r) {
+      for (size_t i = 0; i < 100; ++i) {
+        a.update(added[(r * 7919 + i * 104729) % size].id, std::nullopt, static_cast<int64_t>(i));
+      }
+      start = Clock::now();
+      std::string deltas = a.deltas_since(b.summary());
+      b.merge(deltas);
+      edit_us += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+      bytes = deltas.size();
+    }
+    std::printf("%10zu %14.1f %16.1f %12zu\n", size, full_ms, edit_us / kRepeats, bytes);
+  }
+}
+
+} // namespace
+
+int main() {
+  bool converged = converge();
+  sync_cost();
+  return converged ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// Checks that timing_wheel.h fires every timer on its own tick, in particular
+// timers due exactly where a higher level cascades (multiples of 64^k) and
+// timers scheduled from the overflow list. Run with `npm test`.
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "timing_wheel.h"
+
+namespace {
+
+using cpp_code::TimingWheel;
+
+struct Probe : TimingWheel::Timer {
+  uint64_t due;
+  uint64_t fired = 0;
+};
+
+// Schedules every probe from `start`, then advances one tick at a time.
+size_t run(uint64_t start, std::vector<Probe>& probes) {
+  TimingWheel wheel(start);
+  uint64_t last = start;
+  for (Probe& probe : probes) {
+    wheel.schedule(&probe, probe.due);
+    if (probe.due > last) last = probe.due;
+  }
+
+  std::vector<TimingWheel::Timer*> due;
+  while (wheel.now() < last) {
+    wheel.advance(wheel.now() + 1, due);
+    for (TimingWheel::Timer* timer : due) static_cast<Probe*>(timer)->fired = wheel.now();
+    due.clear();
+  }
+
+  size_t late = 0;
+  for (const Probe& probe : probes) {
+    if (probe.fired != probe.due) {
+      std::printf("  due %llu from %llu, fired %llu\n", static_cast<unsigned long long>(probe.due),
+                  static_cast<unsigned long long>(start), static_cast<unsigned long long>(probe.fired));
+      ++late;
+    }
+  }
+  return late;
+}
+
+size_t boundaries() {
+  size_t late = 0;
+  for (uint64_t start : {uint64_t(0), uint64_t(1), uint64_t(63), uint64_t(4000)}) {
+    std::vector<Probe> probes;
+    for (uint64_t span = TimingWheel::kSlots; span <= (uint64_t(1) << 24); span *= TimingWheel::kSlots) {
+      for (uint64_t multiple : {1, 2, 3}) {
+        for (int offset : {-1, 0, 1}) {
+          uint64_t due = span * multiple + offset;
+          if (due > start) probes.push_back({{}, due});
+        }
+      }
+    }
+    late += run(start, probes);
+  }
+  return late;
+}
+
+// Random due ticks, including past the top level's span, advanced in
+// random steps: each timer must come back from the first advance() that
+// reaches its tick.
+size_t random_steps() {
+  std::mt19937_64 rng(7);
+  TimingWheel wheel(0);
+  std::vector<Probe> probes(20000);
+  for (Probe& probe : probes) {
+    probe.due = 1 + rng() % ((uint64_t(1) << 31) + 1000);
+    wheel.schedule(&probe, probe.due);
+  }
+
+  size_t wrong = 0;
+  std::vector<TimingWheel::Timer*> due;
+  while (wheel.size() > 0) {
+    uint64_t before = wheel.now();
+    wheel.advance(before + 1 + rng() % 5000, due);
+    for (TimingWheel::Timer* timer : due) {
+      const Probe* probe = static_cast<Probe*>(timer);
+      if (probe->due <= before || probe->due > wheel.now()) ++wrong;
+    }
+    due.clear();
+  }
+  return wrong;
+}
+
+} // namespace
+
+int main() {
+  size_t late = boundaries();
+  size_t wrong = random_steps();
+  std::printf("boundary timers off their tick: %zu\nrandom timers from the wrong advance: %zu\n", late, wrong);
+  return late == 0 && wrong == 0 ? 0 : 1;
+}
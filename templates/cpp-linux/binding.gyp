@@ -6,23 +6,40 @@
         ['OS=="linux"', {
           "sources": [
             "src/cpp_addon.cc",
-            "src/cpp_code.cc"
+            "src/cpp_code.cc",
+            "src/epoch.cc",
+            "src/event_recorder.cc",
+            "src/feed_server.cc",
+            "src/js_executor.cc",
+            "src/json_escape.cc",
+            "src/lz_codec.cc",
+            "src/memory_accounting.cc",
+            "src/shm_publisher.cc",
+            "src/task_pool.cc",
+            "src/timing_wheel.cc",
+            "src/todo_aggregates.cc",
+            "src/todo_cold.cc",
+            "src/todo_cursor.cc",
+            "src/todo_due.cc",
+            "src/todo_lists.cc",
+            "src/todo_query.cc",
+            "src/todo_replica.cc",
+            "src/todo_store.cc",
+            "src/trace.cc"
           ],
           "include_dirs": [
             "<!@(node -p \"require('node-addon-api').include\")",
-            "include",
-            "<!@(pkg-config --cflags-only-I gtk+-3.0 | sed s/-I//g)"
+            "include"
           ],
           "cflags!": ["-fno-exceptions"],
           "cflags_cc!": ["-fno-exceptions"],
           "cflags": [
             "-fexceptions",
-            "<!@(pkg-config --cflags gtk+-3.0)",
             "-pthread"
           ],
           "cflags_cc": [
+            "-std=c++20",
             "-fexceptions",
-            "<!@(pkg-config --cflags gtk+-3.0)",
             "-pthread"
           ],
           "ldflags": [
@@ -30,17 +47,54 @@
           ],
           "defines": ["NODE_ADDON_API_CPP_EXCEPTIONS"],
           "libraries": [
-            "<!@(pkg-config --libs gtk+-3.0)",
-            "-luuid"
+            "-luuid",
+            "-ldl",
+            "-lrt"
           ],
           "dependencies": [
-            "<!(node -p \"require('node-addon-api').gyp\")"
+            "<!(node -p \"require('node-addon-api').gyp\")",
+            "cpp_gui"
           ],
           "xcode_settings": {
             "GCC_ENABLE_CPP_EXCEPTIONS": "YES"
           }
         }]
       ]
+    },
+    {
+      "target_name": "cpp_gui",
+      "type": "loadable_module",
+      "product_prefix": "",
+      "product_extension": "so",
+      "conditions": [
+        ['OS=="linux"', {
+          "sources": [
+            "src/gtk_frontend.cc"
+          ],
+          "include_dirs": [
+            "include",
+            "<!@(pkg-config --cflags-only-I gtk+-3.0 | sed s/-I//g)"
+          ],
+          "cflags!": ["-fno-exceptions"],
+          "cflags_cc!": ["-fno-exceptions"],
+          "cflags": [
+            "-fexceptions",
+            "<!@(pkg-config --cflags gtk+-3.0)",
+            "-pthread"
+          ],
+          "cflags_cc": [
+            "-fexceptions",
+            "<!@(pkg-config --cflags gtk+-3.0)",
+            "-pthread"
+          ],
+          "ldflags": [
+            "-pthread"
+          ],
+          "libraries": [
+            "<!@(pkg-config --libs gtk+-3.0)"
+          ]
+        }]
+      ]
     }
   ]
 }
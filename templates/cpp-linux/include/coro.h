@@ -0,0 +1,179 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "gui_plugin.h"
+#include "task_pool.h"
+
+namespace cpp_code {
+
+// Coroutines for sequencing native work across threads.
+//
+// A Task is lazy: it starts when it is awaited or handed to spawn(), and
+// resumes its awaiter by symmetric transfer when it finishes. The awaitables
+// below move the coroutine onto another thread. Those for the JS and GTK
+// threads keep their queue link inside the awaiter, which lives in the
+// coroutine frame, so they never allocate beyond the frame itself.
+// resume_on_pool() goes through the pool's queue, which may allocate, and
+// resume_on_new_thread() starts a thread.
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+  std::coroutine_handle<> continuation;
+  std::exception_ptr error;
+
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      std::coroutine_handle<> next = handle.promise().continuation;
+      return next ? next : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { error = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  Task<T> get_return_object() noexcept;
+  template <typename U>
+  void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+  T take() {
+    if (error) std::rethrow_exception(error);
+    return std::move(*value);
+  }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  Task<void> get_return_object() noexcept;
+  void return_void() noexcept {}
+
+  void take() {
+    if (error) std::rethrow_exception(error);
+  }
+};
+
+} // namespace detail
+
+template <typename T>
+class [[nodiscard]] Task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+
+  explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  Task& operator=(Task&&) = delete;
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+  // Rethrows an exception that escaped the task.
+  T await_resume() { return handle_.promise().take(); }
+
+private:
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+} // namespace detail
+
+// Runs `task` on the calling thread until its first suspension and lets it
+// finish on its own. The task must handle its own errors.
+inline detail::Detached spawn(Task<void> task) { co_await std::move(task); }
+
+// Continues on a worker of `pool`. A coroutine handle fits the small-object
+// buffer of TaskPool::Task; only the worker's queue may allocate.
+class ResumeOnPool {
+public:
+  explicit ResumeOnPool(TaskPool& pool) : pool_(pool) {}
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    pool_.submit([handle] { handle.resume(); });
+  }
+  void await_resume() const noexcept {}
+
+private:
+  TaskPool& pool_;
+};
+
+inline ResumeOnPool resume_on_pool(TaskPool& pool = TaskPool::shared()) { return ResumeOnPool(pool); }
+
+// Continues on a thread of its own, for long blocking work (such as a timed
+// replay) that should not occupy a pool worker. The thread ends when the
+// coroutine next suspends or finishes.
+struct ResumeOnNewThread {
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    std::thread([handle] { handle.resume(); }).detach();
+  }
+  void await_resume() const noexcept {}
+};
+
+inline ResumeOnNewThread resume_on_new_thread() { return ResumeOnNewThread(); }
+
+// Queues `task` on the GTK thread; false if the front end is not running.
+bool post_to_gui(cpp_gui_task* task);
+
+// Continues on the GTK thread. When the front end is not running there is no
+// GTK state to protect, and the coroutine continues on the current thread.
+class ResumeOnGui {
+public:
+  bool await_ready() const noexcept { return false; }
+  bool await_suspend(std::coroutine_handle<> handle) noexcept {
+    handle_ = handle;
+    task_.run = [](cpp_gui_task* task) {
+      reinterpret_cast<ResumeOnGui*>(task)->handle_.resume();
+    };
+    return post_to_gui(&task_);
+  }
+  void await_resume() const noexcept {}
+
+private:
+  cpp_gui_task task_{}; // must stay first
+  std::coroutine_handle<> handle_;
+};
+
+inline ResumeOnGui resume_on_gui() { return ResumeOnGui(); }
+
+} // namespace cpp_code
@@ -1,18 +1,41 @@
 #pragma once
 #include <string>
-#include <functional>
+#include <string_view>
+#include "inplace_function.h"
 
 namespace cpp_code {
 
-std::string hello_world(const std::string& input);
+// Takes a view so callers can pass borrowed memory (e.g. a Buffer's bytes)
+// without copying it into a std::string first.
+std::string hello_world(std::string_view input);
+// Loads the GTK front end on first use; throws std::runtime_error if it
+// cannot be loaded or started.
 void hello_gui();
+// Closes the window; the GTK thread stays up so the next hello_gui() is
+// fast. No-ops when the front end was never opened.
+void close_gui();
+// Stops the GTK application and joins its thread.
+void dispose_gui();
 
-// Callback function types
-using TodoCallback = std::function<void(const std::string&)>;
+// Callback function types. Callbacks are move-only with inline storage, so
+// installing one never allocates; the payload is only borrowed for the call.
+using TodoCallback = InplaceFunction<void(std::string_view), 32>;
 
 // Callback setters
 void setTodoAddedCallback(TodoCallback callback);
 void setTodoUpdatedCallback(TodoCallback callback); 
 void setTodoDeletedCallback(TodoCallback callback);
 
+// Receives a JSON array of every todo that fell due in the same tick. Setting
+// it starts the native due-date scheduler.
+void setTodoDueCallback(TodoCallback callback);
+
+// Receives the memory usage as JSON when shedding could not bring it back
+// under the soft limit (see set_memory_limit() in todo_cold.h).
+void setMemoryPressureCallback(TodoCallback callback);
+
+// Receives coalesced changes of the todo aggregates as JSON once they are
+// maintained (see todo_aggregates.h).
+void setAggregatesCallback(TodoCallback callback);
+
 } // namespace cpp_code 
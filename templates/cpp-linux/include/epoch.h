@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpp_code {
+
+// Epoch-based reclamation for read-mostly data.
+//
+// Readers enter a Guard, which publishes the global epoch in a per-thread
+// slot with a single store; they never take a lock. Writers swap in a new
+// version, then retire() the old one, which is freed once every reader that
+// could still see it has left its guard.
+class EpochDomain {
+public:
+  static constexpr size_t kMaxReaderThreads = 256;
+
+  class Guard {
+  public:
+    explicit Guard(EpochDomain& domain);
+    ~Guard();
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+  private:
+    EpochDomain& domain_;
+    int slot_;
+  };
+
+  EpochDomain();
+  ~EpochDomain();
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // Writer side; calls must be serialized by the caller. Must be called after
+  // `object` has been unpublished.
+  void retire(void* object, void (*deleter)(void*));
+
+  size_t pending() const { return retired_.size(); }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch{0}; // 0 when the thread is not reading
+    std::atomic<bool> owned{false};
+    uint32_t depth = 0;
+  };
+
+  struct Retired {
+    uint64_t epoch;
+    void* object;
+    void (*deleter)(void*);
+  };
+
+  int acquire_slot();
+  void reclaim();
+
+  std::atomic<uint64_t> epoch_{1};
+  Slot slots_[kMaxReaderThreads];
+  // Readers that found every slot taken; reclamation pauses while any exist.
+  std::atomic<uint64_t> overflow_readers_{0};
+  std::vector<Retired> retired_;
+};
+
+} // namespace cpp_code
@@ -0,0 +1,195 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_code {
+
+// Prioritized queue between native producers and the JS thread.
+//
+// Interactive events go to the high lane and bulk traffic to the low lane,
+// so a delete made during a large import is delivered ahead of the adds
+// still queued. The consumer drains in time slices: each round takes up to
+// its weight from every lane, the high lane first unless the low lane has
+// waited past its latency bound, and a slice ends after `slice_ns` so new
+// high-priority events never wait behind more than one slice.
+//
+// Events with the same nonzero key stay in order across lanes: pushing a
+// high-priority event promotes the queued low-priority events with its key
+// ahead of it.
+enum class EventLane { High, Low };
+constexpr int kEventLanes = 2;
+
+struct EventLaneOptions {
+  size_t weight;             // events taken per round
+  uint64_t latency_bound_ns; // deliveries slower than this count as late
+};
+
+struct EventLaneStats {
+  uint64_t delivered;
+  uint64_t pending;
+  uint64_t late;
+  uint64_t max_latency_ns; // since the previous stats() call
+};
+
+template <typename T>
+class EventLanes {
+public:
+  EventLanes(EventLaneOptions high, EventLaneOptions low) : lanes_{Lane(high), Lane(low)} {}
+
+  EventLanes(const EventLanes&) = delete;
+  EventLanes& operator=(const EventLanes&) = delete;
+
+  // Returns true when the caller has to wake the consumer: the first push
+  // after a drain that emptied both lanes.
+  bool push(EventLane lane, T value, uint64_t key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t now = now_ns();
+    Lane& target = lanes_[index(lane)];
+    if (lane == EventLane::High && key != 0 && low_keys_.count(key) != 0) promote(key);
+    target.entries.push_back({std::move(value), now, key, index(lane)});
+    if (lane == EventLane::Low && key != 0) ++low_keys_[key];
+
+    bool wake = !scheduled_;
+    scheduled_ = true;
+    return wake;
+  }
+
+  // Calls deliver(value) on the consumer thread until both lanes are empty
+  // or `slice_ns` has passed. Returns true if events remain, in which case
+  // the caller must schedule another drain.
+  template <typename Fn>
+  bool drain(uint64_t slice_ns, Fn&& deliver) {
+    const uint64_t start = now_ns();
+    std::vector<Entry> batch;
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t now = now_ns();
+        if (now - start >= slice_ns && !batch.empty()) {
+          bool more = !lanes_[0].entries.empty() || !lanes_[1].entries.empty();
+          scheduled_ = more;
+          return more;
+        }
+        batch.clear();
+
+        const int low = index(EventLane::Low);
+        bool low_first = !lanes_[low].entries.empty() &&
+                         now - lanes_[low].entries.front().enqueued > lanes_[low].options.latency_bound_ns;
+        for (int i = 0; i < kEventLanes; ++i) {
+          int lane = low_first ? kEventLanes - 1 - i : i;
+          take(lane, batch);
+        }
+        if (batch.empty()) {
+          scheduled_ = false;
+          return false;
+        }
+      }
+
+      for (auto& entry : batch) {
+        record(lanes_[entry.origin], now_ns() - entry.enqueued);
+        deliver(std::move(entry.value));
+      }
+    }
+  }
+
+  EventLaneStats stats(EventLane lane) {
+    Lane& target = lanes_[index(lane)];
+    std::lock_guard<std::mutex> lock(mutex_);
+    return {target.delivered.load(std::memory_order_relaxed), target.entries.size(),
+            target.late.load(std::memory_order_relaxed),
+            target.max_latency_ns.exchange(0, std::memory_order_relaxed)};
+  }
+
+  // Removes and returns every queued value, e.g. to free them on teardown.
+  std::vector<T> clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<T> values;
+    for (auto& lane : lanes_) {
+      for (auto& entry : lane.entries) values.push_back(std::move(entry.value));
+      lane.entries.clear();
+    }
+    low_keys_.clear();
+    scheduled_ = false;
+    return values;
+  }
+
+private:
+  struct Entry {
+    T value;
+    uint64_t enqueued;
+    uint64_t key;
+    // Lane it was pushed to; promoted events still count towards it.
+    int origin;
+  };
+
+  struct Lane {
+    explicit Lane(EventLaneOptions lane_options) : options(lane_options) {}
+
+    EventLaneOptions options;
+    std::deque<Entry> entries;
+    // Written by the consumer only; atomic so stats() may read them.
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> late{0};
+    std::atomic<uint64_t> max_latency_ns{0};
+  };
+
+  static uint64_t now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  static int index(EventLane lane) { return static_cast<int>(lane); }
+
+  void take(int lane, std::vector<Entry>& batch) {
+    auto& entries = lanes_[lane].entries;
+    for (size_t n = 0; n < lanes_[lane].options.weight && !entries.empty(); ++n) {
+      if (lane == index(EventLane::Low) && entries.front().key != 0) forget(entries.front().key);
+      batch.push_back(std::move(entries.front()));
+      entries.pop_front();
+    }
+  }
+
+  // Moves the low-lane events with `key` to the back of the high lane, in
+  // order. The one to move is usually the most recent add, so search from
+  // the back and stop once every counted event is found.
+  void promote(uint64_t key) {
+    auto found = low_keys_.find(key);
+    auto& low = lanes_[index(EventLane::Low)].entries;
+    auto& high = lanes_[index(EventLane::High)].entries;
+    std::vector<size_t> positions; // descending
+    for (size_t i = low.size(); i-- > 0 && positions.size() < found->second;) {
+      if (low[i].key == key) positions.push_back(i);
+    }
+    for (auto it = positions.rbegin(); it != positions.rend(); ++it) high.push_back(std::move(low[*it]));
+    for (size_t position : positions) low.erase(low.begin() + position);
+    low_keys_.erase(found);
+  }
+
+  void forget(uint64_t key) {
+    auto it = low_keys_.find(key);
+    if (it != low_keys_.end() && --it->second == 0) low_keys_.erase(it);
+  }
+
+  static void record(Lane& lane, uint64_t latency) {
+    lane.delivered.fetch_add(1, std::memory_order_relaxed);
+    if (latency > lane.options.latency_bound_ns) lane.late.fetch_add(1, std::memory_order_relaxed);
+    if (latency > lane.max_latency_ns.load(std::memory_order_relaxed)) {
+      lane.max_latency_ns.store(latency, std::memory_order_relaxed);
+    }
+  }
+
+  std::mutex mutex_;
+  Lane lanes_[kEventLanes];
+  // Keys with events in the low lane, and how many.
+  std::unordered_map<uint64_t, uint32_t> low_keys_;
+  // A drain is pending or running.
+  bool scheduled_ = false;
+};
+
+} // namespace cpp_code
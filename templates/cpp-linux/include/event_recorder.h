@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cpp_code {
+
+// Records the store's mutations with their timing so production load can be
+// replayed later, faster than real time.
+//
+// A recording is an 8-byte magic "TODOREC1" followed by one record per
+// mutation:
+//
+//   uint8  type         1 = added, 2 = updated, 3 = deleted
+//   varint delay_us     microseconds since the previous record
+//   uint8  id[16]
+//   and, unless deleted:
+//   varint date_delta   zigzag, milliseconds from the previous record's date
+//   varint text_length
+//   char   text[text_length]
+//
+// Varints are LEB128. The recording observer only appends to an in-memory
+// buffer; a writer thread hands full buffers to the file.
+struct RecorderStats {
+  uint64_t events;
+  uint64_t bytes;
+};
+
+// Starts recording to `path`, replacing a recording in progress. Throws
+// std::runtime_error if the file cannot be created.
+void start_event_recorder(const std::string& path);
+// Flushes and closes the file. Throws std::runtime_error if a write failed.
+RecorderStats stop_event_recorder();
+
+struct ReplayReport {
+  uint64_t events;
+  // Updates and deletes of todos created before the recording started.
+  uint64_t skipped;
+  double duration_ms;
+  double events_per_second;
+  // Time each mutation took in the store, including its observers and
+  // queueing its JS event.
+  double p50_us;
+  double p90_us;
+  double p99_us;
+  double p999_us;
+  double max_us;
+  // How far the replay fell behind the scaled schedule at worst.
+  double max_lag_ms;
+};
+
+// Applies a recording to the store, compressing its gaps by `speed` (1 for
+// real time, 100 for a hundred times faster). Todos get new ids; later
+// records follow them. Blocks until done. Throws std::runtime_error if the
+// file is not a readable recording, std::invalid_argument if speed <= 0.
+ReplayReport replay_events(const std::string& path, double speed);
+
+} // namespace cpp_code
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cpp_code {
+
+// Optional change feed for local tools, served on a Unix domain socket.
+//
+// Every store mutation is sent to every connected subscriber as one frame:
+//
+//   uint32 length      bytes that follow, little endian
+//   uint8  type        1 = todoAdded, 2 = todoUpdated, 3 = todoDeleted
+//   uint8  id[16]
+//   int64  date        milliseconds since the epoch, little endian
+//   uint32 text_length
+//   char   text[text_length]
+//
+// The server runs its own epoll thread. Mutating threads only append the
+// encoded frame to a queue and poke an eventfd, so neither the GTK nor the
+// JS thread ever waits on a socket. A subscriber whose unsent backlog
+// exceeds `max_buffered_bytes` is disconnected.
+struct FeedServerStats {
+  uint64_t subscribers;
+  uint64_t events;
+  uint64_t disconnected_slow;
+};
+
+// Replaces a socket left at `path` by an earlier run. Throws
+// std::runtime_error if `path` exists and is not a socket, or if the socket
+// or its epoll thread cannot be set up.
+void start_feed_server(const std::string& path, size_t max_buffered_bytes);
+void stop_feed_server();
+FeedServerStats feed_server_stats();
+
+} // namespace cpp_code
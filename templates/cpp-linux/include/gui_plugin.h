@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+
+// ABI between the core addon and the GTK front end (cpp_gui.so).
+//
+// The front end is a separate shared object that is only dlopen()ed on the
+// first helloGui() call, so requiring the addon never maps GTK, GDK, Pango or
+// Cairo. Only plain C types cross this boundary; the front end must not call
+// into the core addon other than through the host table it is handed.
+
+#define CPP_GUI_ABI_VERSION 4
+#define CPP_GUI_LIBRARY "cpp_gui.so"
+#define CPP_GUI_OPEN_SYMBOL "cpp_gui_open"
+#define CPP_GUI_CLOSE_SYMBOL "cpp_gui_close"
+#define CPP_GUI_DISPOSE_SYMBOL "cpp_gui_dispose"
+#define CPP_GUI_POST_SYMBOL "cpp_gui_post"
+#define CPP_GUI_TODO_CHANGED_SYMBOL "cpp_gui_todo_changed"
+
+#define CPP_GUI_TODO_ADDED 0
+#define CPP_GUI_TODO_UPDATED 1
+#define CPP_GUI_TODO_DELETED 2
+
+extern "C" {
+
+typedef void (*cpp_gui_todo_fn)(void* context, const unsigned char id[16],
+                                const char* text, int64_t date);
+
+typedef struct cpp_gui_host {
+  uint32_t abi_version;
+  void (*add_todo)(const char* text, int64_t date, unsigned char out_id[16]);
+  int (*update_todo)(const unsigned char id[16], const char* text, int64_t date);
+  int (*delete_todo)(const unsigned char id[16]);
+  // Calls `fn` for every todo of the current version, in list order.
+  void (*for_each_todo)(cpp_gui_todo_fn fn, void* context);
+  // Tracing. While trace_enabled() returns nonzero, the front end reports
+  // its handlers as spans stamped with trace_now(). `name` must stay valid
+  // for the life of the process (the front end is never unloaded).
+  int (*trace_enabled)(void);
+  uint64_t (*trace_now)(void);
+  void (*trace_span)(const char* name, uint64_t start_ns, uint64_t end_ns);
+} cpp_gui_host;
+
+// Work item for the GTK thread. The caller owns the storage and must keep it
+// alive until `run` has been called; the front end only links it into a list.
+typedef struct cpp_gui_task {
+  struct cpp_gui_task* next;
+  void (*run)(struct cpp_gui_task* task);
+} cpp_gui_task;
+
+// Lifecycle calls are made from one thread at a time.
+//
+// open starts the GTK application on its own thread, or shows the window of
+// an application that is already running. Returns 0 on success.
+typedef int (*cpp_gui_open_fn)(const cpp_gui_host* host);
+
+// close destroys the window and keeps the GTK thread running for a fast
+// reopen; dispose also stops the application and joins its thread. Both
+// return once the GTK thread has done so.
+typedef void (*cpp_gui_close_fn)(void);
+typedef void (*cpp_gui_dispose_fn)(void);
+
+// Queues `task` to run on the GTK thread. Returns 0 without queuing when the
+// GTK thread is not running. Callable from any thread.
+typedef int (*cpp_gui_post_fn)(cpp_gui_task* task);
+
+// Tells the front end about a store mutation so it can update its rows.
+// Called on the mutating thread, in mutation order.
+typedef void (*cpp_gui_todo_changed_fn)(int change, const unsigned char id[16],
+                                        const char* text, int64_t date);
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cpp_code {
+
+// Move-only type-erased callable with inline storage.
+//
+// Unlike std::function it never allocates: a callable that does not fit in
+// `Capacity` bytes is a compile error rather than a silent heap spill, and
+// it is never copied. Calling costs one indirect call.
+template <typename Signature, size_t Capacity = 32>
+class InplaceFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+  InplaceFunction() noexcept = default;
+  InplaceFunction(std::nullptr_t) noexcept {}
+
+  template <typename F, typename Fn = std::decay_t<F>,
+            typename = std::enable_if_t<!std::is_same<Fn, InplaceFunction>::value &&
+                                        std::is_invocable_r<R, Fn&, Args...>::value>>
+  InplaceFunction(F&& f) {
+    static_assert(sizeof(Fn) <= Capacity, "callable does not fit in InplaceFunction storage");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t), "callable is over-aligned");
+    static_assert(std::is_nothrow_move_constructible<Fn>::value, "callable must be nothrow movable");
+
+    new (storage_) Fn(std::forward<F>(f));
+    invoke_ = [](void* self, Args... args) -> R {
+      return (*static_cast<Fn*>(self))(std::forward<Args>(args)...);
+    };
+    manage_ = [](void* dst, void* src) noexcept {
+      if (dst) new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+      static_cast<Fn*>(src)->~Fn();
+    };
+  }
+
+  InplaceFunction(InplaceFunction&& other) noexcept { move_from(other); }
+
+  InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+    if (this != &other) {
+      reset();
+      move_from(other);
+    }
+    return *this;
+  }
+
+  InplaceFunction& operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  InplaceFunction(const InplaceFunction&) = delete;
+  InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+  ~InplaceFunction() { reset(); }
+
+  explicit operator bool() const noexcept { return invoke_ != nullptr; }
+
+  R operator()(Args... args) const {
+    return invoke_(const_cast<unsigned char*>(storage_), std::forward<Args>(args)...);
+  }
+
+private:
+  void reset() noexcept {
+    if (manage_) manage_(nullptr, storage_);
+    invoke_ = nullptr;
+    manage_ = nullptr;
+  }
+
+  // Moves the callable out of `other` and leaves it empty.
+  void move_from(InplaceFunction& other) noexcept {
+    if (!other.manage_) return;
+    other.manage_(storage_, other.storage_);
+    invoke_ = other.invoke_;
+    manage_ = other.manage_;
+    other.invoke_ = nullptr;
+    other.manage_ = nullptr;
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[Capacity];
+  R (*invoke_)(void*, Args...) = nullptr;
+  void (*manage_)(void*, void*) noexcept = nullptr;
+};
+
+} // namespace cpp_code
@@ -0,0 +1,64 @@
+#pragma once
+#include <napi.h>
+#include <uv.h>
+#include <coroutine>
+#include <mutex>
+
+namespace cpp_code {
+
+// Resumes coroutines on the JS thread, through a uv_async_t on the addon's
+// event loop. Resumptions run inside a callback scope, so promises the
+// coroutine settles run their reactions as they would from any other native
+// callback.
+//
+// Create and destroy it on the JS thread; schedule() may be awaited from any
+// thread. Queued awaiters are linked through the awaiter itself, which lives
+// in the coroutine frame.
+class JsExecutor {
+public:
+  class Awaiter {
+  public:
+    explicit Awaiter(JsExecutor& executor) : executor_(executor) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      handle_ = handle;
+      executor_.post(this);
+    }
+    void await_resume() const noexcept {}
+
+  private:
+    friend class JsExecutor;
+
+    JsExecutor& executor_;
+    Awaiter* next_ = nullptr;
+    std::coroutine_handle<> handle_;
+  };
+
+  explicit JsExecutor(Napi::Env env);
+  ~JsExecutor();
+  JsExecutor(const JsExecutor&) = delete;
+  JsExecutor& operator=(const JsExecutor&) = delete;
+
+  Awaiter schedule() { return Awaiter(*this); }
+
+  // Keeps the event loop alive while operations are in flight, so Node does
+  // not exit before a pending operation can come back. JS thread only.
+  void hold();
+  void release();
+
+private:
+  static void on_async(uv_async_t* async);
+  void post(Awaiter* awaiter);
+
+  Napi::Env env_;
+  Napi::AsyncContext context_;
+  uv_async_t* async_;
+  size_t held_ = 0;
+
+  std::mutex mutex_;
+  Awaiter* head_ = nullptr;
+  Awaiter* tail_ = nullptr;
+};
+
+} // namespace cpp_code
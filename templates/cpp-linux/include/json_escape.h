@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace cpp_code {
+
+// Appends `text` to `out` as the inside of a JSON string literal: quotes and
+// backslashes are escaped, and control characters are written as \n, \t or
+// \u00XX.
+void append_json_escaped(std::string& out, std::string_view text);
+
+} // namespace cpp_code
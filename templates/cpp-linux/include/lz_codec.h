@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace cpp_code {
+namespace lz {
+
+// Byte-oriented LZ77 codec in the style of the LZ4 block format: a token
+// byte holds the literal and match lengths, followed by the literals and a
+// two-byte offset. There is no entropy stage, so decoding is a tight copy
+// loop.
+//
+// Both directions take an optional dictionary that acts as if it preceded
+// the input, so short texts that share words with it compress well. Matches
+// reach back at most kMaxOffset bytes, and only the last kMaxOffset bytes of
+// a dictionary are used.
+constexpr size_t kMaxOffset = 65535;
+
+size_t compress_bound(size_t size);
+
+// Compresses `input` into `output`, which must hold compress_bound(size)
+// bytes, and returns the compressed size.
+size_t compress(const uint8_t* dict, size_t dict_size, const uint8_t* input, size_t size,
+                uint8_t* output);
+
+// Decompresses exactly `output_size` bytes. Returns false on malformed input
+// instead of reading or writing out of bounds.
+bool decompress(const uint8_t* dict, size_t dict_size, const uint8_t* input, size_t size,
+                uint8_t* output, size_t output_size);
+
+} // namespace lz
+} // namespace cpp_code
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+namespace cpp_code {
+namespace memory {
+
+// Bytes of native memory held by each part of the addon, so the process can
+// report it to V8 and react before it outgrows its container.
+//
+// Counts are maintained by the owners of the memory (store versions, cold
+// blocks, query columns, queued events) and are approximate: they include
+// container capacity but not allocator overhead.
+enum class Component {
+  Items,       // hot-tier todo records
+  Text,        // heap-allocated todo text of the hot tier
+  Indexes,     // snapshot directories, query columns, cold-tier id indexes
+  EventQueues, // events waiting for JS or feed subscribers
+  ColdTier,    // compressed cold-tier blocks and their dictionaries
+};
+constexpr int kComponents = 5;
+
+// Adds `bytes` (negative to release) to a component: two relaxed atomic
+// adds, plus a sum of the components while a soft limit is set.
+void add(Component component, int64_t bytes);
+
+struct Usage {
+  int64_t bytes[kComponents];
+
+  int64_t operator[](Component component) const { return bytes[static_cast<int>(component)]; }
+  int64_t total() const;
+};
+Usage usage();
+
+// Change since the last call that returned nonzero, once it has reached
+// `min_bytes` in either direction; otherwise 0 and it stays pending.
+int64_t take_unreported(int64_t min_bytes);
+
+// Called (from whichever thread allocated) when at least kReportBytes are
+// unreported, at most once until take_unreported() drains them. Must not
+// block. Replacing it waits for a running call to return.
+constexpr int64_t kReportBytes = 1 << 20;
+void set_report_callback(std::function<void()> callback);
+
+// Calls `on_exceeded` when the total rises above `bytes`, then not again
+// until it has fallen below 90% of it. Runs on the allocating thread, which
+// may hold store locks, so it must only hand work off. 0 disables.
+void set_soft_limit(int64_t bytes, std::function<void()> on_exceeded);
+int64_t soft_limit();
+
+} // namespace memory
+} // namespace cpp_code
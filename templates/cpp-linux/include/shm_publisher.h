@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace cpp_code {
+
+// Publishes the todo list into the POSIX shared-memory segment `name` (see
+// shm_todo_view.h for the layout) and keeps it current from a background
+// thread that coalesces bursts of mutations into one publication. Frozen
+// todos follow the hot ones; the cold tier is only decoded after it changed,
+// and otherwise its rows are copied from the previous publication. Each of
+// the two buffers holds at most `buffer_capacity` bytes, which must be below
+// 4 GiB since entries use 32-bit text offsets. The segment is created with
+// mode 0600, so readers must run as the same user; a stale segment of this
+// user is replaced. Throws std::runtime_error if the segment cannot be
+// created, including when `name` belongs to another user.
+void start_shm_publisher(const std::string& name, size_t buffer_capacity);
+
+// Stops publishing and unlinks the segment; mapped readers keep their view.
+void stop_shm_publisher();
+
+} // namespace cpp_code
@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read-only view of the todo list published into POSIX shared memory.
+//
+// This header is self-contained so other local processes can include it
+// without linking the addon. The segment holds two buffers; the publisher
+// always writes the one readers are not pointed at, bumping that buffer's
+// sequence to odd while it writes and back to even when done, then flips
+// `active`. A reader uses the buffer in place and only retries if that same
+// buffer was rewritten while it was looking at it.
+
+namespace cpp_code {
+namespace shm {
+
+constexpr uint32_t kMagic = 0x54444f31; // "TDO1"
+constexpr uint32_t kLayoutVersion = 2;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared seqlock needs lock-free 64-bit atomics");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared seqlock needs lock-free 32-bit atomics");
+
+struct Entry {
+  unsigned char id[16];
+  int64_t date;
+  uint32_t text_offset;
+  uint32_t text_length;
+};
+
+// Followed by `count` Entry records and then `text_bytes` bytes of text.
+struct BufferHeader {
+  std::atomic<uint64_t> sequence;
+  uint64_t store_version;
+  uint64_t count;
+  uint64_t text_bytes;
+};
+
+struct SegmentHeader {
+  uint32_t magic;
+  uint32_t layout_version;
+  uint64_t buffer_capacity;
+  uint64_t buffer_offsets[2];
+  std::atomic<uint32_t> active;
+  std::atomic<uint32_t> published;
+  // Zero while the published list is current. Otherwise the buffer capacity
+  // the current list needs: it did not fit, so readers keep seeing an older
+  // list until it fits again.
+  std::atomic<uint64_t> overflow_bytes;
+};
+
+inline size_t segment_size(size_t buffer_capacity) {
+  return 2 * buffer_capacity + ((sizeof(SegmentHeader) + 63) & ~size_t(63));
+}
+
+struct Snapshot {
+  uint64_t store_version;
+  size_t count;
+  const Entry* entries;
+  const char* text;
+  size_t text_bytes;
+
+  // Bounds-checked because fn may observe a torn buffer before Reader::read
+  // discards it.
+  std::string_view text_of(const Entry& entry) const {
+    if (entry.text_offset > text_bytes || entry.text_length > text_bytes - entry.text_offset) return {};
+    return std::string_view(text + entry.text_offset, entry.text_length);
+  }
+};
+
+class Reader {
+public:
+  Reader() = default;
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+  ~Reader() { close(); }
+
+  // Maps the segment published under `name` (e.g. "/my-todos").
+  bool open(const std::string& name) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SegmentHeader)) {
+      ::close(fd);
+      return false;
+    }
+
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+
+    base_ = static_cast<const char*>(base);
+    size_ = static_cast<size_t>(st.st_size);
+    auto* header = this->header();
+    if (header->magic != kMagic || header->layout_version != kLayoutVersion ||
+        header->buffer_capacity < sizeof(BufferHeader) || segment_size(header->buffer_capacity) > size_ ||
+        header->buffer_offsets[0] + header->buffer_capacity > size_ ||
+        header->buffer_offsets[1] + header->buffer_capacity > size_) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (base_) munmap(const_cast<char*>(base_), size_);
+    base_ = nullptr;
+    size_ = 0;
+  }
+
+  bool is_open() const { return base_ != nullptr; }
+
+  // Nonzero when the publisher's current list did not fit (see
+  // SegmentHeader::overflow_bytes), even if nothing was published yet.
+  uint64_t overflow_bytes() const {
+    return base_ ? header()->overflow_bytes.load(std::memory_order_acquire) : 0;
+  }
+
+  // Calls fn(const Snapshot&) on a consistent snapshot without copying it.
+  // fn may run more than once if the publisher lapped the reader, so it
+  // should only read. Returns false if nothing was published yet or no
+  // stable snapshot was seen within `max_attempts`.
+  template <typename Fn>
+  bool read(Fn&& fn, int max_attempts = 64) const {
+    if (!base_) return false;
+    auto* header = this->header();
+
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+      if (!header->published.load(std::memory_order_acquire)) return false;
+
+      uint32_t active = header->active.load(std::memory_order_acquire) & 1;
+      auto* buffer = reinterpret_cast<const BufferHeader*>(base_ + header->buffer_offsets[active]);
+      uint64_t before = buffer->sequence.load(std::memory_order_acquire);
+      if (before & 1) continue;
+
+      uint64_t count = buffer->count;
+      uint64_t text_bytes = buffer->text_bytes;
+      uint64_t capacity = header->buffer_capacity - sizeof(BufferHeader);
+      if (count > capacity / sizeof(Entry) || text_bytes > capacity - count * sizeof(Entry)) continue;
+
+      Snapshot snapshot;
+      snapshot.store_version = buffer->store_version;
+      snapshot.count = static_cast<size_t>(count);
+      snapshot.entries = reinterpret_cast<const Entry*>(buffer + 1);
+      snapshot.text = reinterpret_cast<const char*>(snapshot.entries + count);
+      snapshot.text_bytes = static_cast<size_t>(text_bytes);
+      fn(snapshot);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (buffer->sequence.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+  }
+
+private:
+  const SegmentHeader* header() const { return reinterpret_cast<const SegmentHeader*>(base_); }
+
+  const char* base_ = nullptr;
+  size_t size_ = 0;
+};
+
+} // namespace shm
+} // namespace cpp_code
@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpp_code {
+
+// Work-stealing task pool shared by every heavy native operation (sorting,
+// filtering, searching, index rebuilds and exports).
+//
+// Each worker owns a deque: it pushes and pops its own work at the back and
+// idle workers steal from the front of their peers. A thread that calls
+// parallel_for/parallel_reduce runs chunks of that call alongside the
+// workers, and nothing else, so the helpers below are safe to call from
+// inside a task and while holding locks other tasks may take.
+class TaskPool {
+public:
+  using Task = std::function<void()>;
+
+  struct WorkerStats {
+    uint64_t executed;
+    uint64_t stolen;
+  };
+
+  // Process-wide pool sized to std::thread::hardware_concurrency().
+  static TaskPool& shared();
+
+  explicit TaskPool(unsigned workers);
+  ~TaskPool();
+
+  TaskPool(const TaskPool&) = delete;
+  TaskPool& operator=(const TaskPool&) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+  void submit(Task task);
+  std::vector<WorkerStats> stats() const;
+
+  // Calls body(begin, end) over [0, n) in chunks of at most `grain` items
+  // and returns once every chunk has run.
+  void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+  // Maps every chunk of [0, n) with map(begin, end) -> T and folds the chunk
+  // results in index order with combine(T, T), so combine need not commute.
+  template <typename T, typename Map, typename Combine>
+  T parallel_reduce(size_t n, size_t grain, T identity, Map map, Combine combine) {
+    if (n == 0) return identity;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (n + grain - 1) / grain;
+    std::vector<T> partial(chunks, identity);
+    parallel_for(chunks, 1, [&](size_t first, size_t last) {
+      for (size_t c = first; c < last; ++c) {
+        partial[c] = map(c * grain, std::min(n, (c + 1) * grain));
+      }
+    });
+    T result = identity;
+    for (auto& value : partial) result = combine(std::move(result), std::move(value));
+    return result;
+  }
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::atomic<uint64_t> executed{0};
+    std::atomic<uint64_t> stolen{0};
+    std::thread thread;
+  };
+
+  void run_worker(unsigned index);
+  bool try_run_one(int self);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> pending_{0};
+  std::atomic<unsigned> next_queue_{0};
+  std::atomic<bool> stopping_{false};
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+};
+
+namespace detail {
+
+// Merge-path split: the number of elements taken from [a, a + na) among the
+// first `diag` outputs of merging it with [b, b + nb).
+template <typename It, typename Compare>
+size_t merge_split(It a, size_t na, It b, size_t nb, size_t diag, Compare& cmp) {
+  size_t lo = diag > nb ? diag - nb : 0;
+  size_t hi = std::min(diag, na);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (cmp(b[diag - mid - 1], a[mid])) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+} // namespace detail
+
+// Stable parallel merge sort: sorts one run per worker, then merges runs
+// pairwise with every merge itself split across the pool, so no phase is
+// left running on a single core.
+template <typename It, typename Compare>
+void parallel_sort(TaskPool& pool, It first, It last, Compare cmp) {
+  using T = typename std::iterator_traits<It>::value_type;
+  const size_t n = static_cast<size_t>(last - first);
+  const size_t runs = std::min<size_t>(pool.size() + 1, std::max<size_t>(n / 16384, 1));
+  if (runs < 2) {
+    std::stable_sort(first, last, cmp);
+    return;
+  }
+
+  std::vector<size_t> bounds(runs + 1);
+  for (size_t r = 0; r <= runs; ++r) bounds[r] = n * r / runs;
+
+  pool.parallel_for(runs, 1, [&](size_t begin, size_t end) {
+    for (size_t r = begin; r < end; ++r) {
+      std::stable_sort(first + bounds[r], first + bounds[r + 1], cmp);
+    }
+  });
+
+  std::vector<T> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+  std::vector<T> scratch(n);
+  const size_t pieces = pool.size() + 1;
+
+  while (bounds.size() > 2) {
+    std::vector<size_t> merged{0};
+    for (size_t r = 0; r + 1 < bounds.size(); r += 2) {
+      merged.push_back(r + 2 < bounds.size() ? bounds[r + 2] : bounds[r + 1]);
+    }
+
+    pool.parallel_for((bounds.size() / 2) * pieces, 1, [&](size_t begin, size_t end) {
+      for (size_t job = begin; job < end; ++job) {
+        size_t r = (job / pieces) * 2;
+        size_t piece = job % pieces;
+        auto a = buffer.begin() + bounds[r];
+        size_t na = bounds[r + 1] - bounds[r];
+        size_t nb = r + 2 < bounds.size() ? bounds[r + 2] - bounds[r + 1] : 0;
+        auto b = buffer.begin() + bounds[r + 1];
+
+        size_t d0 = (na + nb) * piece / pieces;
+        size_t d1 = (na + nb) * (piece + 1) / pieces;
+        size_t a0 = detail::merge_split(a, na, b, nb, d0, cmp);
+        size_t a1 = detail::merge_split(a, na, b, nb, d1, cmp);
+        std::merge(std::make_move_iterator(a + a0), std::make_move_iterator(a + a1),
+                   std::make_move_iterator(b + (d0 - a0)), std::make_move_iterator(b + (d1 - a1)),
+                   scratch.begin() + bounds[r] + d0, cmp);
+      }
+    });
+
+    buffer.swap(scratch);
+    bounds.swap(merged);
+  }
+
+  std::move(buffer.begin(), buffer.end(), first);
+}
+
+} // namespace cpp_code
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpp_code {
+
+// Hierarchical timing wheel with O(1) insert and cancel.
+//
+// Time is measured in ticks. Level 0 has one slot per tick; each higher level
+// covers 64 times the span of the one below, and its slots are cascaded
+// down as the lower level wraps. Timers are intrusive list nodes owned by
+// the caller, so scheduling never allocates.
+class TimingWheel {
+public:
+  struct Timer {
+    Timer* prev = nullptr;
+    Timer* next = nullptr;
+    uint64_t expires = 0;
+
+    bool scheduled() const { return prev != nullptr; }
+  };
+
+  static constexpr int kLevels = 5;
+  static constexpr int kSlotBits = 6;
+  static constexpr int kSlots = 1 << kSlotBits;
+
+  explicit TimingWheel(uint64_t now);
+  TimingWheel(const TimingWheel&) = delete;
+  TimingWheel& operator=(const TimingWheel&) = delete;
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+
+  // Schedules (or reschedules) `timer` for tick `expires`; ticks at or before
+  // now() fire on the next advance().
+  void schedule(Timer* timer, uint64_t expires);
+  void cancel(Timer* timer);
+
+  // Moves time forward to `now`, appending every timer that expired to
+  // `due`. Expired timers are unscheduled before they are returned.
+  void advance(uint64_t now, std::vector<Timer*>& due);
+
+private:
+  // Links `timer` into the slot for max(expires, earliest).
+  void place(Timer* timer, uint64_t earliest);
+  void cascade(int level);
+  static void link(Timer* head, Timer* timer);
+  static void unlink(Timer* timer);
+
+  // Sentinel heads of circular lists; timers beyond the top level's span
+  // wait in overflow_ and are re-placed whenever the top level wraps.
+  Timer slots_[kLevels][kSlots];
+  Timer overflow_;
+  uint64_t now_;
+  size_t size_ = 0;
+};
+
+} // namespace cpp_code
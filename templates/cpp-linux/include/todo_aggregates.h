@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpp_code {
+
+// Todo counts for dashboards, maintained as the store changes instead of
+// scanned on every request.
+//
+// A store observer keeps a Fenwick tree of todos per UTC day, plus an
+// order-statistics tree of the times of day within each day. Every add,
+// edit and delete is O(log n), even when all of them share one day, and so
+// is any count of todos dated before a moment (overdue), within a range or
+// within a run of days. Frozen todos are included.
+//
+// Nothing is maintained until the first todo_aggregates() call, which
+// builds the tree from the store once. From then on the aggregates callback
+// (setAggregatesCallback() in cpp_code.h) receives the changes as JSON,
+// coalesced on the task pool so a bulk import sends few events:
+//
+//   {"days":[{"day":<UTC midnight ms>,"delta":<n>},...],
+//    "total":<n>,"overdue":<n>}
+//
+// total and overdue are absolute, overdue as of the flush; an event is only
+// sent when a day count or overdue changed.
+struct TodoDayCount {
+  int64_t start; // UTC midnight, ms
+  int64_t count;
+};
+
+struct TodoAggregateReport {
+  int64_t total;
+  int64_t overdue;  // dated before `now`
+  int64_t in_range; // dated in [from, to)
+  // Consecutive buckets of `bucket_days` days from the UTC day of `from`
+  // through the day of `to - 1`; the last one may end after `to`.
+  std::vector<TodoDayCount> buckets;
+};
+
+constexpr int64_t kDayMs = 24 * 60 * 60 * 1000;
+
+// Empty buckets unless from < to and bucket_days > 0. Todos dated more than
+// about 5,700 years from the first one counted are binned on the nearest
+// day the tree covers.
+TodoAggregateReport todo_aggregates(int64_t from, int64_t to, int64_t bucket_days, int64_t now);
+
+} // namespace cpp_code
@@ -0,0 +1,117 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "todo_store.h"
+
+namespace cpp_code {
+
+// Cold tier for todos whose date is long past.
+//
+// Frozen todos leave the hot snapshot and live in immutable blocks of up to
+// 1024 todos, compressed with lz_codec. A freeze builds one text dictionary
+// that every block it writes shares, so even short texts compress. Each
+// block keeps a small uncompressed index: its date range, its ids in sorted
+// order and a Bloom filter over them. Point lookups and date scans only
+// decompress the blocks that can match.
+//
+// Frozen todos are not part of snapshots. Everything that reads the whole
+// list merges them back in: find_todo(), list_todos(), query_todos(),
+// cursors, aggregates and the shared memory view, so freezing never changes
+// what a reader sees. Updating a frozen todo thaws it back into the hot
+// tier. Deleting it only marks it in its block.
+struct ColdTierStats {
+  size_t blocks;
+  size_t items;          // live frozen todos
+  size_t text_bytes;     // their uncompressed text
+  size_t resident_bytes; // indexes, compressed payloads and dictionaries
+};
+
+// Moves every todo dated before `cutoff` into the cold tier and returns how
+// many moved. The todos themselves do not change, so no observer fires.
+size_t freeze_todos_before(int64_t cutoff);
+
+// Freezes todos older than `age_ms` every `interval_ms` on a background
+// thread until stop_cold_tier().
+void start_cold_tier(int64_t age_ms, int64_t interval_ms);
+void stop_cold_tier();
+
+// Sets the soft limit of memory::usage() (see memory_accounting.h); 0
+// removes it. When the total rises above it, the task pool freezes todos
+// older than `freeze_age_ms` and drops the query column cache, neither of
+// which changes what any reader sees; if that is not enough, the memory
+// pressure callback receives the usage as JSON.
+void set_memory_limit(int64_t bytes, int64_t freeze_age_ms);
+
+// Looks `id` up in both tiers.
+bool find_todo(const uuid_t id, TodoItem& out);
+
+// Calls `fn` for every frozen todo dated in [from, to]. `fn` must not
+// mutate the store.
+void scan_cold_todos(int64_t from, int64_t to, const std::function<void(const TodoItem&)>& fn);
+
+// The frozen todos as of one moment, in tier order, read back a block at a
+// time. It shares the compressed blocks with the tier and copies only their
+// deletion marks, so it stays small however many todos are frozen; later
+// freezes, thaws and deletes do not change it. Not thread-safe.
+class ColdTierView {
+public:
+  ColdTierView();
+  ~ColdTierView();
+  ColdTierView(ColdTierView&&) noexcept;
+  ColdTierView& operator=(ColdTierView&&) noexcept;
+
+  size_t size() const;
+  // Calls fn(todo) for up to `count` todos starting at index `first` and
+  // returns how many. Only the blocks they are in are decompressed; the
+  // last one stays decoded for the next call.
+  size_t for_each_from(size_t first, size_t count, const std::function<void(const TodoItem&)>& fn);
+
+private:
+  friend ColdTierView pin_cold_todos();
+  struct State;
+  std::unique_ptr<State> state_;
+};
+
+// Pins the cold tier. Pair it with the hot tier through read_changed_tiers().
+ColdTierView pin_cold_todos();
+
+// Calls pin(), which reads the hot tier (a snapshot or todo_columns()), and
+// then `fn` for every frozen todo dated in [from, to], so that the two hold
+// each todo exactly once. A freeze or thaw briefly holds a todo in both
+// tiers, or to a reader between them in neither; if one overlaps, both
+// calls are repeated, so pin() must also discard what `fn` collected. Must
+// not be called from a store observer.
+void read_both_tiers(const std::function<void()>& pin, int64_t from, int64_t to,
+                     const std::function<void(const TodoItem&)>& fn);
+
+// read_both_tiers() for readers that keep what they read of the cold tier:
+// calls pin(), and cold() only if the cold tier changed since
+// `cold_version`, which it then updates. Start from ~0 to always read it.
+// Returns whether cold() ran.
+bool read_changed_tiers(uint64_t& cold_version, const std::function<void()>& pin,
+                        const std::function<void()>& cold);
+
+ColdTierStats cold_tier_stats();
+
+// Store internals; only called with the store's write mutex held, apart
+// from build().
+namespace cold {
+
+// Compressed blocks that are not part of the tier yet.
+struct Batch;
+
+// Compresses `todos` into blocks without touching the tier, so it needs no
+// lock. A batch that is dropped instead of inserted frees its blocks.
+std::shared_ptr<Batch> build(const std::vector<TodoItem>& todos);
+void insert(std::shared_ptr<Batch> batch);
+bool find(const uuid_t id, TodoItem& out);
+// Removes the frozen todo `id` and returns it in `out`.
+bool take(const uuid_t id, TodoItem& out);
+void for_each(const std::function<void(const TodoItem&)>& fn);
+
+} // namespace cold
+
+} // namespace cpp_code
@@ -0,0 +1,77 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "todo_cold.h"
+#include "todo_store.h"
+
+namespace cpp_code {
+
+enum class TodoCursorOrder { List, DateAscending, DateDescending };
+
+struct TodoCursorOptions {
+  TodoCursorOrder order_by = TodoCursorOrder::List;
+  // Where the walk starts: a list position for List, the earliest date for
+  // DateAscending and the latest for DateDescending.
+  int64_t from = std::numeric_limits<int64_t>::min();
+};
+
+// Walks one pinned version of the store a page at a time, so a reader never
+// holds more than a page of todos outside the store. Mutations made after
+// the cursor was opened are not seen.
+//
+// Both tiers are pinned as they are. List order walks the hot chunks in
+// place and then the cold blocks, decompressing one block at a time as the
+// pages reach it. Date orders copy the frozen todos dated from `from` on out
+// of the cold tier and sort pointers to the matching items once, when the
+// cursor is opened; ties keep list order.
+class TodoCursor {
+public:
+  explicit TodoCursor(const TodoCursorOptions& options);
+  ~TodoCursor();
+
+  TodoCursor(const TodoCursor&) = delete;
+  TodoCursor& operator=(const TodoCursor&) = delete;
+
+  // Todos the cursor walks in total, and how many it has returned.
+  size_t size() const { return end_ - begin_; }
+  size_t position() const { return position_ - begin_; }
+  bool done() const { return position_ >= end_; }
+
+  // Calls fn(item) for the next `count` todos at most and returns how many.
+  template <typename Fn>
+  size_t next(size_t count, Fn&& fn) {
+    count = std::min(count, end_ - std::min(position_, end_));
+    if (order_.empty()) {
+      size_t hot = snapshot_ ? snapshot_->size() : 0;
+      size_t walked = position_ < hot ? snapshot_->for_each_from(position_, count, fn) : 0;
+      if (walked < count) {
+        cold_.for_each_from(position_ + walked - hot, count - walked, [&fn](const TodoItem& todo) { fn(todo); });
+      }
+    } else {
+      for (size_t i = 0; i < count; ++i) fn(*order_[position_ + i]);
+    }
+    position_ += count;
+    return count;
+  }
+
+  // Releases the pinned version before the cursor itself is destroyed.
+  void close();
+
+private:
+  std::shared_ptr<const TodoSnapshot> snapshot_;
+  ColdTierView cold_;             // List order
+  std::vector<TodoItem> frozen_;  // date orders
+  std::vector<const TodoItem*> order_; // date orders only
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  size_t position_ = 0;
+  int64_t accounted_ = 0;       // order_
+  int64_t accounted_items_ = 0; // frozen_
+  int64_t accounted_text_ = 0;
+};
+
+} // namespace cpp_code
@@ -0,0 +1,75 @@
+#pragma once
+#include <uuid/uuid.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "todo_store.h"
+
+namespace cpp_code {
+
+// Many independent todo lists (one per user or project) keyed by list id,
+// next to the single list of todo_store.h.
+//
+// Lists are partitioned into shards by a hash of their id. Each shard has
+// its own lock, its own id indexes and its own event sequence, so mutations
+// of lists in different shards run in parallel and never wait for each
+// other. Within a list, todos keep insertion order; lookups by id are O(1)
+// and deletions are amortized O(1).
+//
+// The lists are separate from the global store: todos added here are not
+// seen by queries, cursors, aggregates, the cold tier, the change feed or
+// the shared-memory publisher, all of which cover todo_store.h only.
+struct TodoListEvent {
+  std::string_view list;
+  TodoChange change;
+  const TodoItem& item; // as stored, or as it was before deletion
+  uint32_t shard;
+  // Per shard and gapless: consumers can tell that they missed an event of
+  // a shard, and order the events of one list by it.
+  uint64_t sequence;
+};
+
+class TodoLists {
+public:
+  // Runs on the mutating thread with the list's shard locked, so the events
+  // of a shard arrive in sequence order. Must not mutate the lists.
+  using Observer = std::function<void(const TodoListEvent&)>;
+
+  // Process-wide instance with kDefaultShards shards.
+  static TodoLists& shared();
+  static constexpr size_t kDefaultShards = 64;
+
+  explicit TodoLists(size_t shards);
+  ~TodoLists();
+
+  TodoLists(const TodoLists&) = delete;
+  TodoLists& operator=(const TodoLists&) = delete;
+
+  TodoItem add(std::string_view list, const std::string& text, int64_t date);
+  bool update(std::string_view list, const uuid_t id, const std::string& text, int64_t date);
+  bool remove(std::string_view list, const uuid_t id);
+
+  // Copies of the todos of `list` in order; empty for an unknown list.
+  std::vector<TodoItem> items(std::string_view list) const;
+  size_t size(std::string_view list) const;
+  size_t list_count() const;
+  size_t shard_count() const { return shard_count_; }
+
+  // Replacing the observer waits for notifications in progress.
+  void set_observer(Observer observer);
+
+private:
+  struct Shard;
+
+  Shard& shard_of(std::string_view list) const;
+  void notify(Shard& shard, std::string_view list, TodoChange change, const TodoItem& item);
+
+  size_t shard_count_;
+  std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace cpp_code
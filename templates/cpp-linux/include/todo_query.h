@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_code {
+
+// Structure-of-arrays view of the todo list used by the query engine. Row i
+// is described by ids[16 * i .. 16 * i + 16), dates[i] and the text bytes
+// [text_offsets[i], text_offsets[i + 1]) of `text`.
+struct TodoColumns {
+  uint64_t version = 0;
+  std::vector<unsigned char> ids;
+  std::vector<int64_t> dates;
+  std::vector<uint64_t> text_offsets; // 64-bit: the text may pass 4 GiB
+  std::string text;
+
+  size_t size() const { return dates.size(); }
+  std::string_view text_at(size_t row) const {
+    return std::string_view(text).substr(text_offsets[row], text_offsets[row + 1] - text_offsets[row]);
+  }
+};
+
+enum class TodoSortBy { None, DateAscending, DateDescending, Text };
+
+struct TodoQuery {
+  int64_t from = std::numeric_limits<int64_t>::min();
+  int64_t to = std::numeric_limits<int64_t>::max();
+  std::string prefix;
+  TodoSortBy sort_by = TodoSortBy::None;
+  size_t limit = std::numeric_limits<size_t>::max();
+};
+
+// Columns for the hot tier (see todo_cold.h). The view is rebuilt only when
+// the store has changed since the last call and is shared between callers.
+std::shared_ptr<const TodoColumns> todo_columns();
+// Drops the cached view; it is freed once no query still holds it.
+void release_todo_columns();
+
+// Returns the matching row numbers of `columns`, sorted and truncated as the
+// query asks. Large inputs are filtered and sorted on the shared TaskPool.
+std::vector<uint32_t> run_query(const TodoColumns& columns, const TodoQuery& query);
+
+struct TodoQueryResult {
+  std::shared_ptr<const TodoColumns> columns;
+  std::vector<uint32_t> rows; // of `columns`
+};
+
+// Runs `query` over the whole store. Columns only hold the hot tier, so the
+// frozen todos dated in [from, to] are found through the cold tier's block
+// date ranges; when any match, they are ordered together with the matching
+// hot rows in a copy of just those rows. Frozen todos sort after hot ones
+// with an equal key.
+TodoQueryResult query_todos(const TodoQuery& query);
+
+} // namespace cpp_code
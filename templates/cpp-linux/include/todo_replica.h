@@ -0,0 +1,151 @@
+#pragma once
+#include <uuid/uuid.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "todo_store.h"
+
+namespace cpp_code {
+
+// A todo list replicated between processes or machines without a server.
+//
+// Every local mutation is an operation stamped with a hybrid logical clock
+// (HLC) and numbered per replica (1, 2, 3, ...). Each todo keeps the stamp
+// of the operation that last set each of its fields, and an operation only
+// overwrites the fields whose stamp it beats, so replicas that have applied
+// the same operations hold the same list in whatever order they arrived.
+// Deletion is final: a delete beats every edit.
+//
+// Syncing is two messages. The receiver sends summary(), its version vector
+// (the highest operation number it has applied per replica); the sender
+// answers with deltas_since(summary), exactly the operations missing from
+// it, which the receiver passes to merge(). Both the deltas and the merge
+// cost O(replicas + missing operations), independent of the list size.
+//
+// A replica is a list of its own: the todos of the store (todo_store.h)
+// carry no stamps and are not replicated. To sync them, keep them in a
+// replica and apply what merge() changes to the store.
+//
+// Nothing is ever collected: the operation log and deleted todos (kept as
+// tombstones so a late edit cannot revive them) grow with every mutation.
+// Dropping either safely needs every peer to have acknowledged it, which
+// a replica without a server cannot know, so memory grows with the edit
+// history rather than with the list.
+//
+// A replica is not thread-safe; use it from one thread at a time.
+struct TodoMergeResult {
+  uint64_t applied;
+  uint64_t duplicates; // already applied before
+  // Operations that came after a gap in their replica's numbering, e.g.
+  // when a batch was lost; the next exchange sends them again.
+  uint64_t deferred;
+};
+
+class TodoReplica {
+public:
+  // Milliseconds since the Unix epoch; replaceable to simulate clock skew.
+  using WallClock = std::function<int64_t()>;
+
+  // A replica id of 0 picks a random one. Ids must be unique among the
+  // replicas that sync with each other.
+  explicit TodoReplica(uint64_t replica_id = 0, WallClock clock = nullptr);
+  ~TodoReplica();
+
+  TodoReplica(const TodoReplica&) = delete;
+  TodoReplica& operator=(const TodoReplica&) = delete;
+
+  uint64_t id() const { return id_; }
+
+  TodoItem add(const std::string& text, int64_t date);
+  // Sets only the fields given; false for an unknown or deleted todo.
+  bool update(const uuid_t id, const std::optional<std::string>& text, std::optional<int64_t> date);
+  bool remove(const uuid_t id);
+
+  // Live todos in creation order (by the stamp of the add), which is the
+  // same on every replica.
+  std::vector<TodoItem> items() const;
+  size_t size() const { return live_; }
+  // Operations known to this replica, its own and merged ones.
+  uint64_t operation_count() const { return operations_; }
+
+  // The version vector: a varint count, then per replica its id (fixed64)
+  // and the number of operations applied from it (varint).
+  std::string summary() const;
+
+  // The operations missing from a replica with `summary`, grouped by origin
+  // replica: a varint group count, then per group the origin (fixed64), the
+  // number of its first operation and the operation count (varints), and
+  // the operations:
+  //
+  //   uint8  fields       1 = text, 2 = date, 4 = deleted, 8 = created
+  //   varint stamp_delta  HLC minus the previous operation's in the group
+  //   uint8  id[16]
+  //   varint text_length, char text[text_length]   if fields & 1
+  //   varint date                                  if fields & 2, zigzag
+  //
+  // Throws std::runtime_error if the summary is malformed.
+  std::string deltas_since(std::string_view summary) const;
+
+  // Applies a deltas_since() batch from any replica. Throws
+  // std::runtime_error if the batch is malformed; operations before the
+  // malformed one stay applied.
+  TodoMergeResult merge(std::string_view deltas);
+
+private:
+  using TodoId = std::array<unsigned char, sizeof(uuid_t)>;
+  struct TodoIdHash {
+    size_t operator()(const TodoId& id) const;
+  };
+
+  // HLC time (wall milliseconds << 16 | logical counter), then replica id:
+  // a total order on operations. Zero means never set.
+  struct Stamp {
+    uint64_t time = 0;
+    uint64_t replica = 0;
+
+    bool operator<(const Stamp& other) const {
+      return time != other.time ? time < other.time : replica < other.replica;
+    }
+    explicit operator bool() const { return time != 0; }
+  };
+
+  struct Operation {
+    uint64_t origin;
+    uint64_t time;
+    TodoId id;
+    uint8_t fields;
+    std::string text;
+    int64_t date = 0;
+  };
+
+  struct Todo {
+    TodoItem item;
+    Stamp created, text, date, deleted;
+  };
+
+  uint64_t tick();
+  void record(Operation op);
+  // Sets the fields of the targeted todo whose stamps the operation beats.
+  void apply(const Operation& op);
+  void account(const Operation& op, int64_t sign);
+
+  uint64_t id_;
+  WallClock clock_;
+  uint64_t last_stamp_ = 0;
+
+  // Operations by origin replica; the operation numbered n is at n - 1.
+  // Deques, so appending never moves a long history.
+  std::unordered_map<uint64_t, std::deque<Operation>> log_;
+  std::unordered_map<TodoId, Todo, TodoIdHash> todos_;
+  uint64_t operations_ = 0;
+  size_t live_ = 0;
+};
+
+} // namespace cpp_code
@@ -0,0 +1,127 @@
+#pragma once
+#include <uuid/uuid.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "epoch.h"
+
+namespace cpp_code {
+
+struct TodoItem {
+  uuid_t id;
+  std::string text;
+  int64_t date;
+
+  std::string toJson() const;
+};
+
+// Immutable run of consecutive todos. Versions share every chunk that a
+// mutation did not touch.
+struct TodoChunk {
+  std::vector<TodoItem> items;
+
+  TodoChunk() = default;
+  // A copy is a new chunk that has not been accounted yet.
+  TodoChunk(const TodoChunk& other) : items(other.items) {}
+  TodoChunk& operator=(const TodoChunk&) = delete;
+  ~TodoChunk();
+
+  // Bytes added to memory accounting when the chunk was first published.
+  mutable int64_t accounted_items = 0;
+  mutable int64_t accounted_text = 0;
+};
+
+// One immutable version of the todo list.
+class TodoSnapshot {
+public:
+  TodoSnapshot() = default;
+  TodoSnapshot(const TodoSnapshot& other);
+  TodoSnapshot& operator=(const TodoSnapshot&) = delete;
+  ~TodoSnapshot();
+
+  uint64_t version() const { return version_; }
+  size_t size() const { return size_; }
+  const TodoItem& operator[](size_t index) const;
+
+  template <typename Fn>
+  void for_each(Fn&& fn) const {
+    for (auto& chunk : chunks_) {
+      for (auto& item : chunk->items) fn(item);
+    }
+  }
+
+  // Calls fn(item) for up to `count` items starting at index `first` and
+  // returns how many it visited.
+  template <typename Fn>
+  size_t for_each_from(size_t first, size_t count, Fn&& fn) const {
+    if (first >= size_) return 0;
+    size_t chunk = chunk_of(first);
+    size_t offset = first - starts_[chunk];
+    size_t visited = 0;
+    for (; chunk < chunks_.size() && visited < count; ++chunk, offset = 0) {
+      auto& items = chunks_[chunk]->items;
+      for (; offset < items.size() && visited < count; ++offset, ++visited) fn(items[offset]);
+    }
+    return visited;
+  }
+
+private:
+  friend class TodoStoreWriter;
+
+  size_t chunk_of(size_t index) const;
+
+  uint64_t version_ = 0;
+  size_t size_ = 0;
+  std::vector<std::shared_ptr<const TodoChunk>> chunks_;
+  std::vector<size_t> starts_; // index of the first item of each chunk
+  int64_t accounted_ = 0;       // bytes of the directory above
+};
+
+// The todo list is owned by the core addon so that it is usable without the
+// GTK front end. Every function here may be called from any thread.
+//
+// Reads are lock-free: they see the latest published version and never wait
+// for a mutation. Mutations are serialized against each other, publish a new
+// version that copies only the chunk they touch, and then fire the observers
+// and the matching todo callback in mutation order.
+TodoItem add_todo(const std::string& text, int64_t date);
+bool update_todo(const uuid_t id, const std::string& text, int64_t date);
+bool delete_todo(const uuid_t id);
+// Every todo: the hot tier in list order, then any frozen ones (see
+// todo_cold.h).
+std::vector<TodoItem> list_todos();
+
+// Pins the current version for the lifetime of the guard without locking.
+// Keep guards short: versions retired while a guard is held are only freed
+// after it is released.
+class TodoReadGuard {
+public:
+  TodoReadGuard();
+  const TodoSnapshot& operator*() const { return *snapshot_; }
+  const TodoSnapshot* operator->() const { return snapshot_; }
+
+private:
+  EpochDomain::Guard guard_;
+  const TodoSnapshot* snapshot_;
+};
+
+// A version that stays valid for as long as the caller holds it, for long
+// running readers such as cursors. Costs one pointer copy per chunk.
+std::shared_ptr<const TodoSnapshot> pin_todos();
+
+enum class TodoChange { Added, Updated, Deleted };
+
+// Native observers see every mutation with the item as it was stored (or as
+// it was before deletion). They run on the mutating thread in mutation order,
+// after the new version is visible to readers and before the JS callbacks
+// are queued. Observers must not mutate the store.
+using TodoObserver = std::function<void(TodoChange, const TodoItem&)>;
+int add_todo_observer(TodoObserver observer);
+// Waits for a notification in progress, so once it returns the observer is
+// not running and is never called again. Must not be called from an
+// observer, or while holding a lock that an observer takes.
+void remove_todo_observer(int id);
+
+} // namespace cpp_code
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cpp_code {
+namespace trace {
+
+// Opt-in tracing of the event pipeline, written out as Chrome trace-event
+// JSON (loads in Perfetto and chrome://tracing).
+//
+// Each thread records into its own fixed-size ring, so recording takes no
+// lock and never allocates after the thread's first event; when a ring is
+// full the oldest events are overwritten. While tracing is off, every
+// instrumentation point costs one relaxed load and a well-predicted branch.
+
+extern std::atomic<bool> g_enabled;
+
+inline bool enabled()
+{
+  return g_enabled.load(std::memory_order_relaxed);
+}
+
+// CLOCK_MONOTONIC in nanoseconds, the clock every event is stamped with.
+uint64_t now_ns();
+
+// Discards what earlier sessions recorded and starts recording.
+void start();
+void stop();
+
+// Writes every recorded event to `path`. Returns the number of events
+// written; throws std::runtime_error if the file cannot be written. Safe to
+// call while other threads keep recording.
+size_t dump(const std::string& path);
+
+// Recording, for enabled() callers. `name` must be a string literal (or
+// otherwise outlive the session).
+void record_span(const char* name, uint64_t start_ns, uint64_t end_ns);
+// Flows draw an arrow from the slice enclosing flow_begin to the one
+// enclosing flow_end, e.g. from a native enqueue to the JS delivery.
+uint64_t new_flow_id();
+void flow_begin(const char* name, uint64_t id);
+void flow_end(const char* name, uint64_t id);
+
+// Records the enclosing scope as a span named `name`.
+class Span {
+public:
+  explicit Span(const char* name)
+      : name_(enabled() ? name : nullptr)
+      , start_(name_ ? now_ns() : 0) {}
+
+  ~Span()
+  {
+    if (name_)
+      record_span(name_, start_, now_ns());
+  }
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+
+private:
+  const char* name_;
+  uint64_t start_;
+};
+
+} // namespace trace
+} // namespace cpp_code
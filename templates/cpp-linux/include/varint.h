@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace cpp_code {
+
+// LEB128 varints and zigzag signed values, as used by the compact binary
+// formats (event recordings, replica deltas).
+inline void put_varint(std::string& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+// Fixed-width little-endian, for values that are random rather than small.
+inline void put_fixed64(std::string& out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+inline uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+inline int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+// Reads what put_varint(), put_fixed64() and plain appends wrote. Throws
+// std::runtime_error with `what` when the data ends early or a varint is
+// malformed.
+class ByteReader {
+public:
+  ByteReader(std::string_view data, const char* what) : data_(data), what_(what) {}
+
+  bool done() const { return pos_ == data_.size(); }
+
+  uint8_t byte() {
+    need(1);
+    return static_cast<uint8_t>(data_[pos_++]);
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t b = byte();
+      value |= static_cast<uint64_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) return value;
+    }
+    throw std::runtime_error(what_);
+  }
+
+  uint64_t fixed64() {
+    std::string_view b = bytes(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) value |= static_cast<uint64_t>(static_cast<uint8_t>(b[i])) << (8 * i);
+    return value;
+  }
+
+  std::string_view bytes(size_t count) {
+    need(count);
+    std::string_view result = data_.substr(pos_, count);
+    pos_ += count;
+    return result;
+  }
+
+private:
+  void need(size_t count) const {
+    if (data_.size() - pos_ < count) throw std::runtime_error(what_);
+  }
+
+  std::string_view data_;
+  const char* what_;
+  size_t pos_ = 0;
+};
+
+} // namespace cpp_code
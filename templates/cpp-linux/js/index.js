@@ -1,5 +1,103 @@
 const EventEmitter = require("events");
 
+// Pages through one version of the todo list; see openCursor().
+class TodoCursor {
+  #addon;
+  #handle;
+  #select;
+
+  constructor(addon, { handle, size }, select) {
+    this.#addon = addon;
+    this.#handle = handle;
+    this.#select = select;
+    this.size = size;
+  }
+
+  // The next pageSize todos, or null when there are no more.
+  next(pageSize = 1000) {
+    const page = this.#addon.cursorNext(this.#handle, pageSize, this.#select);
+
+    if (page && this.#select !== "columns") {
+      for (const todo of page) {
+        todo.date = new Date(todo.date);
+      }
+    }
+    return page;
+  }
+
+  // Lets the store free the version early; otherwise that happens when the
+  // cursor is garbage collected.
+  close() {
+    this.#addon.closeCursor(this.#handle);
+  }
+
+  *pages(pageSize = 1000) {
+    for (let page = this.next(pageSize); page; page = this.next(pageSize)) {
+      yield page;
+    }
+  }
+}
+
+// One replica of a todo list synced without a server; see createReplica().
+class TodoReplica {
+  #addon;
+  #handle;
+
+  constructor(addon, { handle, id }) {
+    this.#addon = addon;
+    this.#handle = handle;
+    this.id = id;
+  }
+
+  add(text, date) {
+    return toTodo(
+      this.#addon.replicaAdd(
+        this.#handle,
+        text,
+        date instanceof Date ? date.getTime() : date,
+      ),
+    );
+  }
+
+  // Writes only the fields given, e.g. update(id, { date }).
+  update(id, { text, date } = {}) {
+    return this.#addon.replicaUpdate(
+      this.#handle,
+      id,
+      text,
+      date instanceof Date ? date.getTime() : date,
+    );
+  }
+
+  delete(id) {
+    return this.#addon.replicaDelete(this.#handle, id);
+  }
+
+  items() {
+    return this.#addon.replicaItems(this.#handle).map(toTodo);
+  }
+
+  // What this replica has seen, as a compact version vector.
+  summary() {
+    return this.#addon.replicaSummary(this.#handle);
+  }
+
+  // The operations missing from the replica that sent `summary`.
+  deltasSince(summary) {
+    return this.#addon.replicaDeltasSince(this.#handle, summary);
+  }
+
+  // Returns { applied, duplicates, deferred }; deferred operations came
+  // after a lost batch and arrive again with the next sync.
+  merge(deltas) {
+    return this.#addon.replicaMerge(this.#handle, deltas);
+  }
+}
+
+function toTodo(todo) {
+  return { ...todo, date: new Date(todo.date) };
+}
+
 class CppLinuxAddon extends EventEmitter {
   constructor() {
     super();
@@ -22,8 +120,49 @@ class CppLinuxAddon extends EventEmitter {
     this.addon.on("todoDeleted", (payload) => {
       this.emit("todoDeleted", this.#parse(payload));
     });
+
+    // Every todo that fell due in the same tick arrives as one array.
+    this.addon.on("todoDue", (payload) => {
+      this.emit(
+        "todoDue",
+        JSON.parse(payload).map((todo) => ({
+          ...todo,
+          date: new Date(todo.date),
+        })),
+      );
+    });
+
+    // Native memory stayed above the soft limit after shedding.
+    this.addon.on("memoryPressure", (payload) => {
+      this.emit("memoryPressure", JSON.parse(payload));
+    });
+
+    // Todo counts changed: { days: [{ day: Date, delta }], total, overdue }.
+    // Coalesced; overdue is as of the event.
+    this.addon.on("aggregatesChanged", (payload) => {
+      const event = JSON.parse(payload);
+      this.emit("aggregatesChanged", {
+        ...event,
+        days: event.days.map(({ day, delta }) => ({
+          day: new Date(day),
+          delta,
+        })),
+      });
+    });
+
+    // A todo of a named list changed: { list, shard, sequence, type, todo }.
+    // sequence counts up without gaps per shard.
+    this.addon.on("listChanged", (payload) => {
+      const event = JSON.parse(payload);
+      this.emit("listChanged", {
+        ...event,
+        todo: { ...event.todo, date: new Date(event.todo.date) },
+      });
+    });
   }
 
+  // Pass a Buffer, Uint8Array or ArrayBuffer to get a Buffer back without
+  // the payload being transcoded or copied across the boundary.
   helloWorld(input = "") {
     return this.addon.helloWorld(input);
   }
@@ -32,6 +171,278 @@ class CppLinuxAddon extends EventEmitter {
     return this.addon.helloGui();
   }
 
+  // Closes the window. The GTK thread stays up, so the next helloGui() only
+  // has to build a window.
+  closeGui() {
+    return this.addon.closeGui();
+  }
+
+  // Stops the GTK thread and the native event callbacks. No further events
+  // are emitted; events that were still queued are dropped.
+  dispose() {
+    return this.addon.dispose();
+  }
+
+  // Adds a todo on the GTK thread when the front end is running, so it lands
+  // in order with edits made in the window. Resolves with the stored todo.
+  async addTodo(text, date) {
+    const todo = await this.addon.addTodo(
+      text,
+      date instanceof Date ? date.getTime() : date,
+    );
+
+    return this.#parse(todo);
+  }
+
+  // Runs a native query over the todo list, e.g.
+  // query({ filter: { from, to, prefix }, sortBy: "-date", limit: 10 }).
+  // Returns matching ids, or { ids: Uint8Array, dates: Float64Array } when
+  // select is "columns".
+  query({ filter = {}, sortBy, limit, select } = {}) {
+    const { from, to, prefix } = filter;
+
+    return this.addon.query({
+      filter: {
+        from: from instanceof Date ? from.getTime() : from,
+        to: to instanceof Date ? to.getTime() : to,
+        prefix,
+      },
+      sortBy,
+      limit,
+      select,
+    });
+  }
+
+  // Publishes the todo list into the POSIX shared-memory segment `name` so
+  // other local processes can read it without IPC (see shm_todo_view.h).
+  publishShared(name, { capacity } = {}) {
+    return this.addon.publishShared(name, capacity);
+  }
+
+  stopPublishing() {
+    return this.addon.stopPublishing();
+  }
+
+  // Reads a snapshot published by another process as
+  // { todos, stale, neededBytes }, or null if unavailable. stale is true when
+  // the current list outgrew the segment: todos is then the last list that
+  // fit (empty if none did), and neededBytes is the capacity it would take.
+  readShared(name) {
+    const shared = this.addon.readShared(name);
+    if (!shared) {
+      return null;
+    }
+
+    const todos = shared.todos.map((todo) => ({
+      ...todo,
+      date: new Date(todo.date),
+    }));
+    return { ...shared, todos };
+  }
+
+  // Serves todoAdded/todoUpdated/todoDeleted to local tools over a Unix
+  // domain socket (frame format in feed_server.h). Subscribers with more
+  // than maxBufferedBytes unsent are disconnected.
+  startFeedServer(path, { maxBufferedBytes } = {}) {
+    return this.addon.startFeedServer(path, maxBufferedBytes);
+  }
+
+  stopFeedServer() {
+    return this.addon.stopFeedServer();
+  }
+
+  feedServerStats() {
+    return this.addon.feedServerStats();
+  }
+
+  // Tasks executed and stolen by each worker of the native task pool.
+  poolStats() {
+    return this.addon.poolStats();
+  }
+
+  // Moves todos dated more than ageMs ago into compressed in-memory blocks
+  // and returns how many moved. Frozen todos stay in getTodo(), query(),
+  // cursors and readShared(); scanCold() reads only them, and updating one
+  // moves it back.
+  freezeColdTodos(ageMs) {
+    return this.addon.freezeColdTodos(ageMs);
+  }
+
+  // Freezes todos older than ageMs every intervalMs (default: hourly).
+  startColdTier({ ageMs, intervalMs } = {}) {
+    return this.addon.startColdTier(ageMs, intervalMs);
+  }
+
+  stopColdTier() {
+    return this.addon.stopColdTier();
+  }
+
+  // Looks up a todo by id in both tiers; null if there is none.
+  getTodo(id) {
+    const todo = this.addon.getTodo(id);
+
+    return todo && { ...todo, date: new Date(todo.date) };
+  }
+
+  // Frozen todos dated in [from, to]; only the blocks that overlap the range
+  // are decompressed.
+  scanCold({ from, to } = {}) {
+    return this.addon
+      .scanCold(
+        from instanceof Date ? from.getTime() : from,
+        to instanceof Date ? to.getTime() : to,
+      )
+      .map((todo) => ({ ...todo, date: new Date(todo.date) }));
+  }
+
+  // { blocks, items, textBytes, residentBytes } of the cold tier.
+  coldTierStats() {
+    return this.addon.coldTierStats();
+  }
+
+  // Records the native event pipeline (GTK handler, store mutation,
+  // serialization, enqueue, delivery on the JS thread and the listeners)
+  // until stopTrace(). Each thread keeps its most recent 32768 events.
+  startTrace() {
+    return this.addon.startTrace();
+  }
+
+  stopTrace() {
+    return this.addon.stopTrace();
+  }
+
+  // Writes the recorded events as Chrome trace-event JSON, which opens in
+  // https://ui.perfetto.dev. Returns the number of events written.
+  dumpTrace(path) {
+    return this.addon.dumpTrace(path);
+  }
+
+  // Native memory in bytes by component: { items, text, indexes,
+  // eventQueues, coldTier, total, softLimit }. The same totals are reported
+  // to V8 as external memory.
+  memoryUsage() {
+    return this.addon.memoryUsage();
+  }
+
+  // Above `bytes` of native memory, todos older than freezeAgeMs (default:
+  // 30 days) are frozen and the query cache is dropped, which leaves every
+  // result unchanged; if usage is still above the limit, "memoryPressure" is
+  // emitted with memoryUsage(). Not again until usage has fallen below 90%
+  // of the limit. 0 removes it.
+  setMemoryLimit(bytes, { freezeAgeMs } = {}) {
+    return this.addon.setMemoryLimit(bytes, freezeAgeMs);
+  }
+
+  // Delivery of native events by lane: edits, deletes and memory pressure
+  // take the high lane and overtake queued adds in the low one; todoDue
+  // stays in the low lane behind the adds of its todos. Each lane
+  // reports { delivered, pending, late, maxLatencyMs }; late counts
+  // deliveries past the lane's bound (2 ms high, 100 ms low) and
+  // maxLatencyMs restarts on every call.
+  eventLaneStats() {
+    return this.addon.eventLaneStats();
+  }
+
+  // Records every store mutation with its timing to a compact binary file
+  // (format in event_recorder.h) until stopRecording(), which closes the
+  // file and returns { events, bytes }.
+  startRecording(path) {
+    return this.addon.startRecording(path);
+  }
+
+  stopRecording() {
+    return this.addon.stopRecording();
+  }
+
+  // Replays a recording into the store, and so through the event lanes to
+  // the listeners, speed (1-100) times faster than it was recorded.
+  // Resolves with { events, skipped, durationMs, eventsPerSecond,
+  // latencyUs: { p50, p90, p99, p999, max }, maxLagMs }.
+  replay(path, { speed = 1 } = {}) {
+    return this.addon.replay(path, speed);
+  }
+
+  // Iterates the todo list as it is now, a page per next(): orderBy "list"
+  // (from is a position), "date" or "-date" (from is the first date to
+  // include). Pages are arrays of { id, text, date }, or { ids: Uint8Array,
+  // dates: Float64Array, texts } when select is "columns", so memory follows
+  // the page size rather than the list. Frozen todos come after the others
+  // in list order and are decompressed a block at a time as pages reach
+  // them; date orders copy the matching ones out when the cursor opens.
+  openCursor({ orderBy = "list", from, select } = {}) {
+    return new TodoCursor(
+      this.addon,
+      this.addon.openCursor(
+        orderBy,
+        from instanceof Date ? from.getTime() : from,
+      ),
+      select,
+    );
+  }
+
+  // Todos of independent named lists, e.g. one per user. Lists are spread
+  // over 64 shards with a lock each, so writes to different lists rarely
+  // wait for each other. A list exists while it has todos.
+  addListTodo(list, text, date) {
+    return toTodo(
+      this.addon.addListTodo(
+        list,
+        text,
+        date instanceof Date ? date.getTime() : date,
+      ),
+    );
+  }
+
+  updateListTodo(list, id, text, date) {
+    return this.addon.updateListTodo(
+      list,
+      id,
+      text,
+      date instanceof Date ? date.getTime() : date,
+    );
+  }
+
+  deleteListTodo(list, id) {
+    return this.addon.deleteListTodo(list, id);
+  }
+
+  getList(list) {
+    return this.addon.getList(list).map(toTodo);
+  }
+
+  // Todo counts from natively maintained aggregates: total, overdue (dated
+  // before now) and, for a range, inRange plus buckets of "day", "week" or
+  // a number of days, starting at the UTC day of from. Each count is
+  // O(log n). The first call builds the aggregates; from then on
+  // "aggregatesChanged" delivers their changes.
+  getAggregates({ from, to, bucket = "day" } = {}) {
+    const days = bucket === "week" ? 7 : bucket === "day" ? 1 : bucket;
+    const report = this.addon.getAggregates(
+      from instanceof Date ? from.getTime() : from,
+      to instanceof Date ? to.getTime() : to,
+      days,
+    );
+
+    return {
+      ...report,
+      buckets: report.buckets.map(({ start, count }) => ({
+        start: new Date(start),
+        count,
+      })),
+    };
+  }
+
+  // A todo list to keep in sync with replicas in other processes or on
+  // other machines, over any transport: send b.summary() to a, and merge
+  // a.deltasSince(summary) into b. Each field keeps a hybrid logical clock,
+  // so concurrent edits merge the same everywhere, and a sync costs the
+  // number of missing edits rather than the size of the list. A replica is
+  // separate from this store's todos, and its history of edits and
+  // deletions grows for as long as it lives.
+  createReplica() {
+    return new TodoReplica(this.addon, this.addon.createReplica());
+  }
+
   #parse(payload) {
     const parsed = JSON.parse(payload);
 
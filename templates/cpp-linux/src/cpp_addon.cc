@@ -1,6 +1,36 @@
 #include <napi.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <vector>
+#include "coro.h"
 #include "cpp_code.h"
+#include "event_lanes.h"
+#include "event_recorder.h"
+#include "feed_server.h"
+#include "js_executor.h"
+#include "json_escape.h"
+#include "memory_accounting.h"
+#include "shm_publisher.h"
+#include "shm_todo_view.h"
+#include "task_pool.h"
+#include "todo_aggregates.h"
+#include "todo_cold.h"
+#include "todo_cursor.h"
+#include "todo_lists.h"
+#include "todo_query.h"
+#include "todo_replica.h"
+#include "todo_store.h"
+#include "trace.h"
+#include <uuid/uuid.h>
 
 class CppAddon : public Napi::ObjectWrap<CppAddon> {
 public:
@@ -8,6 +38,48 @@ public:
         Napi::Function func = DefineClass(env, "CppLinuxAddon", {
             InstanceMethod("helloWorld", &CppAddon::HelloWorld),
             InstanceMethod("helloGui", &CppAddon::HelloGui),
+            InstanceMethod("closeGui", &CppAddon::CloseGui),
+            InstanceMethod("dispose", &CppAddon::Dispose),
+            InstanceMethod("addTodo", &CppAddon::AddTodo),
+            InstanceMethod("query", &CppAddon::Query),
+            InstanceMethod("publishShared", &CppAddon::PublishShared),
+            InstanceMethod("stopPublishing", &CppAddon::StopPublishing),
+            InstanceMethod("readShared", &CppAddon::ReadShared),
+            InstanceMethod("startFeedServer", &CppAddon::StartFeedServer),
+            InstanceMethod("stopFeedServer", &CppAddon::StopFeedServer),
+            InstanceMethod("feedServerStats", &CppAddon::FeedServerStats),
+            InstanceMethod("poolStats", &CppAddon::PoolStats),
+            InstanceMethod("freezeColdTodos", &CppAddon::FreezeColdTodos),
+            InstanceMethod("startColdTier", &CppAddon::StartColdTier),
+            InstanceMethod("stopColdTier", &CppAddon::StopColdTier),
+            InstanceMethod("getTodo", &CppAddon::GetTodo),
+            InstanceMethod("scanCold", &CppAddon::ScanCold),
+            InstanceMethod("coldTierStats", &CppAddon::ColdTierStats),
+            InstanceMethod("startTrace", &CppAddon::StartTrace),
+            InstanceMethod("stopTrace", &CppAddon::StopTrace),
+            InstanceMethod("dumpTrace", &CppAddon::DumpTrace),
+            InstanceMethod("memoryUsage", &CppAddon::MemoryUsage),
+            InstanceMethod("setMemoryLimit", &CppAddon::SetMemoryLimit),
+            InstanceMethod("eventLaneStats", &CppAddon::EventLaneStats),
+            InstanceMethod("startRecording", &CppAddon::StartRecording),
+            InstanceMethod("stopRecording", &CppAddon::StopRecording),
+            InstanceMethod("replay", &CppAddon::Replay),
+            InstanceMethod("openCursor", &CppAddon::OpenCursor),
+            InstanceMethod("cursorNext", &CppAddon::CursorNext),
+            InstanceMethod("closeCursor", &CppAddon::CloseCursor),
+            InstanceMethod("addListTodo", &CppAddon::AddListTodo),
+            InstanceMethod("updateListTodo", &CppAddon::UpdateListTodo),
+            InstanceMethod("deleteListTodo", &CppAddon::DeleteListTodo),
+            InstanceMethod("getList", &CppAddon::GetList),
+            InstanceMethod("getAggregates", &CppAddon::GetAggregates),
+            InstanceMethod("createReplica", &CppAddon::CreateReplica),
+            InstanceMethod("replicaAdd", &CppAddon::ReplicaAdd),
+            InstanceMethod("replicaUpdate", &CppAddon::ReplicaUpdate),
+            InstanceMethod("replicaDelete", &CppAddon::ReplicaDelete),
+            InstanceMethod("replicaItems", &CppAddon::ReplicaItems),
+            InstanceMethod("replicaSummary", &CppAddon::ReplicaSummary),
+            InstanceMethod("replicaDeltasSince", &CppAddon::ReplicaDeltasSince),
+            InstanceMethod("replicaMerge", &CppAddon::ReplicaMerge),
             InstanceMethod("on", &CppAddon::On)
         });
 
@@ -19,18 +91,39 @@ public:
         return exports;
     }
 
+    // An event on its way to JS.
     struct CallbackData {
-        std::string eventType;
+        const char* eventType;
         std::string payload;
-        CppAddon* addon;
+        // Links the enqueue to its delivery in traces; 0 when not tracing.
+        uint64_t flow;
+        // Event queue bytes counted for it until it is delivered or dropped.
+        int64_t accounted = 0;
+
+        ~CallbackData() {
+            cpp_code::memory::add(cpp_code::memory::Component::EventQueues, -accounted);
+        }
     };
 
+    // Changes smaller than this wait for a later delivery, so V8 sees a
+    // handful of adjustments per second at most rather than one per event.
+    static constexpr int64_t kReportBatchBytes = 64 * 1024;
+
+    // Edits, deletes and notifications take the high lane and adds the low
+    // one. A drain yields to the event loop after half the high lane's
+    // bound, so an edit made mid-import is delivered within about 2 ms.
+    static constexpr cpp_code::EventLaneOptions kHighLane{32, 2'000'000};
+    static constexpr cpp_code::EventLaneOptions kLowLane{8, 100'000'000};
+    static constexpr uint64_t kDrainSliceNs = kHighLane.latency_bound_ns / 2;
+
     CppAddon(const Napi::CallbackInfo& info)
         : Napi::ObjectWrap<CppAddon>(info)
         , env_(info.Env())
         , emitter(Napi::Persistent(Napi::Object::New(info.Env())))
         , callbacks(Napi::Persistent(Napi::Object::New(info.Env())))
-        , tsfn_(nullptr) {
+        , js_(info.Env())
+        , tsfn_(nullptr)
+        , lanes_(kHighLane, kLowLane) {
 
         napi_status status = napi_create_threadsafe_function(
             env_,
@@ -42,27 +135,14 @@ public:
             nullptr,
             nullptr,
             this,
+            // Each call is a wake-up that drains the lanes for one slice.
+            // Wake-ups still queued when the function is aborted arrive
+            // without an environment; the events stay in the lanes and are
+            // freed by Teardown().
             [](napi_env env, napi_value js_callback, void* context, void* data) {
-                auto* callbackData = static_cast<CallbackData*>(data);
-                if (!callbackData) return;
-
-                Napi::Env napi_env(env);
-                Napi::HandleScope scope(napi_env);
-
                 auto addon = static_cast<CppAddon*>(context);
-                if (!addon) {
-                    delete callbackData;
-                    return;
-                }
-
-                try {
-                    auto callback = addon->callbacks.Value().Get(callbackData->eventType).As<Napi::Function>();
-                    if (callback.IsFunction()) {
-                        callback.Call(addon->emitter.Value(), {Napi::String::New(napi_env, callbackData->payload)});
-                    }
-                } catch (...) {}
-
-                delete callbackData;
+                if (env == nullptr || !addon) return;
+                addon->Drain(env);
             },
             &tsfn_
         );
@@ -73,53 +153,1170 @@ public:
         }
 
         // Set up the callbacks here
-        auto makeCallback = [this](const std::string& eventType) {
-            return [this, eventType](const std::string& payload) {
-                if (tsfn_ != nullptr) {
-                    auto* data = new CallbackData{
-                        eventType,
-                        payload,
-                        this
-                    };
-                    napi_call_threadsafe_function(tsfn_, data, napi_tsfn_blocking);
-                }
+        // Event names are string literals, so each callback captures two
+        // pointers and a lane and fits the TodoCallback inline storage.
+        auto makeCallback = [this](const char* eventType, cpp_code::EventLane lane) {
+            return [this, eventType, lane](std::string_view payload) {
+                Enqueue(eventType, lane, payload, EventKey(payload));
             };
         };
 
-        cpp_code::setTodoAddedCallback(makeCallback("todoAdded"));
-        cpp_code::setTodoUpdatedCallback(makeCallback("todoUpdated"));
-        cpp_code::setTodoDeletedCallback(makeCallback("todoDeleted"));
+        // todoDue payloads batch several todos and so carry no key; they go
+        // to the low lane, behind the todoAdded events of those todos.
+        using cpp_code::EventLane;
+        cpp_code::setTodoAddedCallback(makeCallback("todoAdded", EventLane::Low));
+        cpp_code::setTodoUpdatedCallback(makeCallback("todoUpdated", EventLane::High));
+        cpp_code::setTodoDeletedCallback(makeCallback("todoDeleted", EventLane::High));
+        cpp_code::setTodoDueCallback(makeCallback("todoDue", EventLane::Low));
+        cpp_code::setMemoryPressureCallback(makeCallback("memoryPressure", EventLane::High));
+        cpp_code::setAggregatesCallback(makeCallback("aggregatesChanged", EventLane::Low));
+
+        cpp_code::TodoLists::shared().set_observer([this](const cpp_code::TodoListEvent& event) {
+            Enqueue("listChanged",
+                    event.change == cpp_code::TodoChange::Added ? EventLane::Low : EventLane::High,
+                    ListEventToJson(event),
+                    std::hash<std::string_view>()(std::string_view(
+                        reinterpret_cast<const char*>(event.item.id), sizeof(uuid_t))) | 1);
+        });
+
+        // Large changes between deliveries (a freeze, a bulk import with no
+        // listener) are reported without waiting for the next event.
+        cpp_code::memory::set_report_callback([this]() {
+            if (tsfn_ != nullptr) {
+                report_pending_.store(true, std::memory_order_relaxed);
+                Wake();
+            }
+        });
+        ReportMemory(env_, 0);
     }
 
     ~CppAddon() {
-        if (tsfn_ != nullptr) {
-            napi_release_threadsafe_function(tsfn_, napi_tsfn_release);
-            tsfn_ = nullptr;
-        }
+        Teardown();
     }
 
 private:
     Napi::Env env_;
     Napi::ObjectReference emitter;
     Napi::ObjectReference callbacks;
+    cpp_code::JsExecutor js_;
     napi_threadsafe_function tsfn_;
+    cpp_code::EventLanes<CallbackData*> lanes_;
+    std::atomic<bool> report_pending_{false};
+
+    // Keys todo events by id so an edit promoted to the high lane never
+    // overtakes the todoAdded of the same todo (see event_lanes.h).
+    static uint64_t EventKey(std::string_view payload) {
+        constexpr std::string_view prefix = "{\"id\":\"";
+        if (payload.size() < prefix.size() + 36 || payload.substr(0, prefix.size()) != prefix) {
+            return 0;
+        }
+        return std::hash<std::string_view>()(payload.substr(prefix.size(), 36)) | 1;
+    }
+
+    // Queues an event for the JS thread. Called by the native callbacks,
+    // which are detached before tsfn_ is released.
+    void Enqueue(const char* eventType, cpp_code::EventLane lane, std::string_view payload, uint64_t key) {
+        if (tsfn_ == nullptr) return;
+
+        cpp_code::trace::Span span("tsfn.enqueue");
+        auto* data = new CallbackData{
+            eventType,
+            std::string(payload),
+            0
+        };
+        data->accounted = static_cast<int64_t>(sizeof(CallbackData) + data->payload.capacity());
+        cpp_code::memory::add(cpp_code::memory::Component::EventQueues, data->accounted);
+        if (cpp_code::trace::enabled()) {
+            data->flow = cpp_code::trace::new_flow_id();
+            cpp_code::trace::flow_begin("todo event", data->flow);
+        }
+        if (lanes_.push(lane, data, key)) {
+            Wake();
+        }
+    }
+
+    static std::string ListEventToJson(const cpp_code::TodoListEvent& event) {
+        std::string json = "{\"list\":\"";
+        cpp_code::append_json_escaped(json, event.list);
+        json += "\",\"shard\":" + std::to_string(event.shard);
+        json += ",\"sequence\":" + std::to_string(event.sequence);
+        json += event.change == cpp_code::TodoChange::Added     ? ",\"type\":\"added\""
+              : event.change == cpp_code::TodoChange::Updated ? ",\"type\":\"updated\""
+                                                              : ",\"type\":\"deleted\"";
+        json += ",\"todo\":" + event.item.toJson() + "}";
+        return json;
+    }
+
+    void Wake() {
+        napi_call_threadsafe_function(tsfn_, nullptr, napi_tsfn_nonblocking);
+    }
+
+    // Delivers queued events for one slice on the JS thread, then yields to
+    // the event loop with another wake-up if any are left.
+    void Drain(napi_env env) {
+        cpp_code::trace::Span span("js.call_js");
+        Napi::Env napiEnv(env);
+        Napi::HandleScope scope(napiEnv);
+
+        bool more = lanes_.drain(kDrainSliceNs, [&](CallbackData* callbackData) {
+            // A listener disposed the addon. The events of this round were
+            // already taken from the lanes, so Teardown() could not free
+            // them; drop them here instead of calling listeners of a
+            // disposed addon.
+            if (tsfn_ == nullptr) {
+                delete callbackData;
+                return;
+            }
+            if (callbackData->flow != 0) {
+                cpp_code::trace::flow_end("todo event", callbackData->flow);
+            }
+
+            try {
+                auto callback = callbacks.Value().Get(callbackData->eventType).As<Napi::Function>();
+                if (callback.IsFunction()) {
+                    cpp_code::trace::Span listener("js.listener");
+                    callback.Call(emitter.Value(), {Napi::String::New(napiEnv, callbackData->payload)});
+                }
+            } catch (...) {}
+
+            delete callbackData;
+        });
+
+        bool reportNow = report_pending_.exchange(false, std::memory_order_relaxed);
+        ReportMemory(env, reportNow ? 0 : kReportBatchBytes);
+        if (more && tsfn_ != nullptr) {
+            Wake();
+        }
+    }
+
+    // Passes native allocations and frees on to V8 so that it collects
+    // sooner when the process as a whole is growing.
+    static void ReportMemory(napi_env env, int64_t minBytes) {
+        int64_t delta = cpp_code::memory::take_unreported(minBytes);
+        if (delta != 0) {
+            int64_t adjusted;
+            napi_adjust_external_memory(env, delta, &adjusted);
+        }
+    }
+
+    // Hands `bytes` to JS as a Buffer without copying; the string is freed
+    // when the Buffer is collected. Runtimes that forbid external buffers
+    // (Electron's V8 memory cage) get a copy instead.
+    static Napi::Value ToExternalBuffer(Napi::Env env, std::string&& bytes) {
+        auto* owned = new std::string(std::move(bytes));
+        return Napi::Buffer<char>::NewOrCopy(
+            env, owned->data(), owned->size(),
+            [](Napi::Env, char*, std::string* owned) { delete owned; }, owned);
+    }
+
+#if NAPI_VERSION >= 10
+    // Below this, an external string costs more to set up than the copy saves.
+    static constexpr size_t kExternalStringMinBytes = 4096;
+
+    static bool IsAscii(const std::string& text) {
+        const char* p = text.data();
+        const char* end = p + text.size();
+        for (; end - p >= 8; p += 8) {
+            uint64_t word;
+            memcpy(&word, p, sizeof(word));
+            if (word & 0x8080808080808080ull) return false;
+        }
+        for (; p < end; ++p) {
+            if (static_cast<unsigned char>(*p) & 0x80) return false;
+        }
+        return true;
+    }
+#endif
+
+    // With Node-API 10 (Node 22.14+, enable with NAPI_VERSION=10) large
+    // ASCII results become external strings that V8 reads from native
+    // memory, since ASCII is valid Latin-1. Everything else is copied.
+    static Napi::Value ToJsString(Napi::Env env, std::string&& text) {
+#if NAPI_VERSION >= 10
+        if (text.size() >= kExternalStringMinBytes && IsAscii(text)) {
+            auto* owned = new std::string(std::move(text));
+            napi_value result;
+            bool copied;
+            napi_status status = node_api_create_external_string_latin1(
+                env, owned->data(), owned->size(),
+                [](node_api_basic_env, void*, void* hint) { delete static_cast<std::string*>(hint); },
+                owned, &result, &copied);
+            if (status == napi_ok) {
+                // If V8 copied it, the finalizer has already freed `owned`.
+                return Napi::Value(env, result);
+            }
+            text = std::move(*owned);
+            delete owned;
+        }
+#endif
+        return Napi::String::New(env, text);
+    }
 
+    // Strings are transcoded in and out as usual. A Buffer, Uint8Array or
+    // ArrayBuffer is read in place and answered with a Buffer that wraps the
+    // native result, so a large payload is copied once instead of three times.
     Napi::Value HelloWorld(const Napi::CallbackInfo& info) {
         Napi::Env env = info.Env();
 
+        if (info.Length() >= 1 && info[0].IsBuffer()) {
+            Napi::Buffer<char> input = info[0].As<Napi::Buffer<char>>();
+            return ToExternalBuffer(env, cpp_code::hello_world({input.Data(), input.Length()}));
+        }
+
+        if (info.Length() >= 1 && info[0].IsArrayBuffer()) {
+            Napi::ArrayBuffer input = info[0].As<Napi::ArrayBuffer>();
+            return ToExternalBuffer(env, cpp_code::hello_world(
+                {static_cast<const char*>(input.Data()), input.ByteLength()}));
+        }
+
         if (info.Length() < 1 || !info[0].IsString()) {
-            Napi::TypeError::New(env, "Expected string argument").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Expected string, Buffer or ArrayBuffer argument").ThrowAsJavaScriptException();
             return env.Null();
         }
 
         std::string input = info[0].As<Napi::String>();
-        std::string result = cpp_code::hello_world(input);
-
-        return Napi::String::New(env, result);
+        return ToJsString(env, cpp_code::hello_world(input));
     }
 
     void HelloGui(const Napi::CallbackInfo& info) {
-        cpp_code::hello_gui();
+        try {
+            cpp_code::hello_gui();
+        } catch (const std::exception& e) {
+            Napi::Error::New(info.Env(), e.what()).ThrowAsJavaScriptException();
+        }
+    }
+
+    void CloseGui(const Napi::CallbackInfo& info) {
+        cpp_code::close_gui();
+    }
+
+    void Dispose(const Napi::CallbackInfo& info) {
+        cpp_code::dispose_gui();
+        Teardown();
+    }
+
+    // Detaches the native callbacks, which guarantees none is running or
+    // will run, then aborts the threadsafe function. Events that were queued
+    // but not yet delivered are freed rather than called into a dead object.
+    void Teardown() {
+        if (tsfn_ == nullptr) return;
+
+        cpp_code::setTodoAddedCallback(nullptr);
+        cpp_code::setTodoUpdatedCallback(nullptr);
+        cpp_code::setTodoDeletedCallback(nullptr);
+        cpp_code::setTodoDueCallback(nullptr);
+        cpp_code::setMemoryPressureCallback(nullptr);
+        cpp_code::setAggregatesCallback(nullptr);
+        cpp_code::memory::set_report_callback(nullptr);
+        cpp_code::TodoLists::shared().set_observer(nullptr);
+
+        napi_release_threadsafe_function(tsfn_, napi_tsfn_abort);
+        tsfn_ = nullptr;
+
+        for (CallbackData* data : lanes_.clear()) {
+            delete data;
+        }
+    }
+
+    Napi::Value AddTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::string text = info[0].As<Napi::String>();
+        double date = info[1].As<Napi::Number>().DoubleValue();
+        if (text.empty() || !std::isfinite(date)) {
+            Napi::TypeError::New(env, "Expected a non-empty text and a finite date").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto deferred = Napi::Promise::Deferred::New(env);
+        cpp_code::spawn(AddTodoFlow(deferred, std::move(text), static_cast<int64_t>(date)));
+        return deferred.Promise();
+    }
+
+    // Validated on the JS thread, inserted on the GTK thread so the front end
+    // sees it in order with its own edits, serialized on the pool and settled
+    // back on the JS thread. The object is kept alive until then.
+    cpp_code::Task<void> AddTodoFlow(Napi::Promise::Deferred deferred, std::string text, int64_t date) {
+        Ref();
+        js_.hold();
+
+        std::string json;
+        std::string error;
+        co_await cpp_code::resume_on_gui();
+        try {
+            cpp_code::TodoItem todo = cpp_code::add_todo(text, date);
+            co_await cpp_code::resume_on_pool();
+            json = todo.toJson();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        co_await js_.schedule();
+
+        Napi::Env env = deferred.Env();
+        if (error.empty()) {
+            deferred.Resolve(Napi::String::New(env, json));
+        } else {
+            deferred.Reject(Napi::Error::New(env, error).Value());
+        }
+
+        js_.release();
+        Unref();
+    }
+
+    Napi::Value Query(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsObject()) {
+            Napi::TypeError::New(env, "Expected an options object").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        Napi::Object options = info[0].As<Napi::Object>();
+        cpp_code::TodoQuery query;
+
+        if (options.Has("filter") && options.Get("filter").IsObject()) {
+            Napi::Object filter = options.Get("filter").As<Napi::Object>();
+            if (filter.Get("from").IsNumber()) {
+                query.from = filter.Get("from").As<Napi::Number>().Int64Value();
+            }
+            if (filter.Get("to").IsNumber()) {
+                query.to = filter.Get("to").As<Napi::Number>().Int64Value();
+            }
+            if (filter.Get("prefix").IsString()) {
+                query.prefix = filter.Get("prefix").As<Napi::String>().Utf8Value();
+            }
+        }
+
+        Napi::Value sortBy = options.Get("sortBy");
+        if (sortBy.IsString()) {
+            std::string key = sortBy.As<Napi::String>();
+            if (key == "date") {
+                query.sort_by = cpp_code::TodoSortBy::DateAscending;
+            } else if (key == "-date") {
+                query.sort_by = cpp_code::TodoSortBy::DateDescending;
+            } else if (key == "text") {
+                query.sort_by = cpp_code::TodoSortBy::Text;
+            } else {
+                Napi::TypeError::New(env, "sortBy must be 'date', '-date' or 'text'").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+        }
+
+        Napi::Value limit = options.Get("limit");
+        if (limit.IsNumber() && limit.As<Napi::Number>().Int64Value() >= 0) {
+            query.limit = static_cast<size_t>(limit.As<Napi::Number>().Int64Value());
+        }
+
+        cpp_code::TodoQueryResult found = cpp_code::query_todos(query);
+        const auto &columns = found.columns;
+        const std::vector<uint32_t> &rows = found.rows;
+
+        // select: "columns" projects the result into typed arrays instead of
+        // materializing one string per match.
+        Napi::Value select = options.Get("select");
+        if (select.IsString() && select.As<Napi::String>().Utf8Value() == "columns") {
+            Napi::Uint8Array ids = Napi::Uint8Array::New(env, rows.size() * sizeof(uuid_t));
+            Napi::Float64Array dates = Napi::Float64Array::New(env, rows.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                memcpy(ids.Data() + i * sizeof(uuid_t), &columns->ids[rows[i] * sizeof(uuid_t)], sizeof(uuid_t));
+                dates[i] = static_cast<double>(columns->dates[rows[i]]);
+            }
+
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("ids", ids);
+            result.Set("dates", dates);
+            return result;
+        }
+
+        Napi::Array result = Napi::Array::New(env, rows.size());
+        char uuid_str[37];
+        for (size_t i = 0; i < rows.size(); ++i) {
+            uuid_unparse(&columns->ids[rows[i] * sizeof(uuid_t)], uuid_str);
+            result.Set(static_cast<uint32_t>(i), Napi::String::New(env, uuid_str));
+        }
+        return result;
+    }
+
+    void PublishShared(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Expected a shared memory name").ThrowAsJavaScriptException();
+            return;
+        }
+
+        size_t capacity = 64 * 1024 * 1024;
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            capacity = static_cast<size_t>(info[1].As<Napi::Number>().Int64Value());
+        }
+
+        try {
+            cpp_code::start_shm_publisher(info[0].As<Napi::String>(), capacity);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        }
+    }
+
+    void StopPublishing(const Napi::CallbackInfo& info) {
+        cpp_code::stop_shm_publisher();
+    }
+
+    Napi::Value ReadShared(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Expected a shared memory name").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        struct Row {
+            char id[37];
+            std::string text;
+            int64_t date;
+        };
+
+        cpp_code::shm::Reader reader;
+        if (!reader.open(info[0].As<Napi::String>())) {
+            return env.Null();
+        }
+        std::vector<Row> rows;
+        bool ok = reader.read([&rows](const cpp_code::shm::Snapshot& snapshot) {
+            rows.resize(snapshot.count);
+            for (size_t i = 0; i < snapshot.count; ++i) {
+                uuid_unparse(snapshot.entries[i].id, rows[i].id);
+                rows[i].text = snapshot.text_of(snapshot.entries[i]);
+                rows[i].date = snapshot.entries[i].date;
+            }
+        });
+        uint64_t overflow = reader.overflow_bytes();
+        if (!ok && overflow == 0) {
+            return env.Null();
+        }
+
+        Napi::Array todos = Napi::Array::New(env, rows.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            Napi::Object todo = Napi::Object::New(env);
+            todo.Set("id", Napi::String::New(env, rows[i].id));
+            todo.Set("text", Napi::String::New(env, rows[i].text));
+            todo.Set("date", Napi::Number::New(env, static_cast<double>(rows[i].date)));
+            todos.Set(static_cast<uint32_t>(i), todo);
+        }
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("todos", todos);
+        result.Set("stale", Napi::Boolean::New(env, overflow != 0));
+        result.Set("neededBytes", Napi::Number::New(env, static_cast<double>(overflow)));
+        return result;
+    }
+
+    void StartFeedServer(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Expected a socket path").ThrowAsJavaScriptException();
+            return;
+        }
+
+        size_t maxBuffered = 4 * 1024 * 1024;
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            maxBuffered = static_cast<size_t>(info[1].As<Napi::Number>().Int64Value());
+        }
+
+        try {
+            cpp_code::start_feed_server(info[0].As<Napi::String>(), maxBuffered);
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        }
+    }
+
+    void StopFeedServer(const Napi::CallbackInfo& info) {
+        cpp_code::stop_feed_server();
+    }
+
+    Napi::Value FeedServerStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        auto stats = cpp_code::feed_server_stats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("subscribers", Napi::Number::New(env, static_cast<double>(stats.subscribers)));
+        result.Set("events", Napi::Number::New(env, static_cast<double>(stats.events)));
+        result.Set("disconnectedSlow", Napi::Number::New(env, static_cast<double>(stats.disconnected_slow)));
+        return result;
+    }
+
+    Napi::Value PoolStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        auto stats = cpp_code::TaskPool::shared().stats();
+
+        Napi::Array result = Napi::Array::New(env, stats.size());
+        for (size_t i = 0; i < stats.size(); ++i) {
+            Napi::Object worker = Napi::Object::New(env);
+            worker.Set("executed", Napi::Number::New(env, static_cast<double>(stats[i].executed)));
+            worker.Set("stolen", Napi::Number::New(env, static_cast<double>(stats[i].stolen)));
+            result.Set(static_cast<uint32_t>(i), worker);
+        }
+        return result;
+    }
+
+    static int64_t NowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static Napi::Object TodoToObject(Napi::Env env, const cpp_code::TodoItem& todo) {
+        char uuid_str[37];
+        uuid_unparse(todo.id, uuid_str);
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("id", Napi::String::New(env, uuid_str));
+        result.Set("text", Napi::String::New(env, todo.text));
+        result.Set("date", Napi::Number::New(env, static_cast<double>(todo.date)));
+        return result;
+    }
+
+    Napi::Value FreezeColdTodos(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Expected an age in milliseconds").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        int64_t age = info[0].As<Napi::Number>().Int64Value();
+        size_t moved = cpp_code::freeze_todos_before(NowMs() - age);
+        return Napi::Number::New(env, static_cast<double>(moved));
+    }
+
+    void StartColdTier(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Expected an age in milliseconds").ThrowAsJavaScriptException();
+            return;
+        }
+
+        int64_t interval = 60 * 60 * 1000;
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            interval = info[1].As<Napi::Number>().Int64Value();
+        }
+
+        cpp_code::start_cold_tier(info[0].As<Napi::Number>().Int64Value(), interval);
+    }
+
+    void StopColdTier(const Napi::CallbackInfo& info) {
+        cpp_code::stop_cold_tier();
+    }
+
+    Napi::Value GetTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        uuid_t id;
+        if (info.Length() < 1 || !info[0].IsString() ||
+            uuid_parse(info[0].As<Napi::String>().Utf8Value().c_str(), id) != 0) {
+            Napi::TypeError::New(env, "Expected a todo id").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        cpp_code::TodoItem todo;
+        if (!cpp_code::find_todo(id, todo)) {
+            return env.Null();
+        }
+        return TodoToObject(env, todo);
+    }
+
+    Napi::Value ScanCold(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        int64_t from = INT64_MIN;
+        int64_t to = INT64_MAX;
+        if (info.Length() > 0 && info[0].IsNumber()) {
+            from = info[0].As<Napi::Number>().Int64Value();
+        }
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            to = info[1].As<Napi::Number>().Int64Value();
+        }
+
+        std::vector<cpp_code::TodoItem> todos;
+        cpp_code::scan_cold_todos(from, to, [&todos](const cpp_code::TodoItem& todo) {
+            todos.push_back(todo);
+        });
+
+        Napi::Array result = Napi::Array::New(env, todos.size());
+        for (size_t i = 0; i < todos.size(); ++i) {
+            result.Set(static_cast<uint32_t>(i), TodoToObject(env, todos[i]));
+        }
+        return result;
+    }
+
+    Napi::Value ColdTierStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        auto stats = cpp_code::cold_tier_stats();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("blocks", Napi::Number::New(env, static_cast<double>(stats.blocks)));
+        result.Set("items", Napi::Number::New(env, static_cast<double>(stats.items)));
+        result.Set("textBytes", Napi::Number::New(env, static_cast<double>(stats.text_bytes)));
+        result.Set("residentBytes", Napi::Number::New(env, static_cast<double>(stats.resident_bytes)));
+        return result;
+    }
+
+    void StartTrace(const Napi::CallbackInfo& info) {
+        cpp_code::trace::start();
+    }
+
+    void StopTrace(const Napi::CallbackInfo& info) {
+        cpp_code::trace::stop();
+    }
+
+    Napi::Value DumpTrace(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Expected a file path").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            size_t events = cpp_code::trace::dump(info[0].As<Napi::String>());
+            return Napi::Number::New(env, static_cast<double>(events));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value MemoryUsage(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        using cpp_code::memory::Component;
+        auto usage = cpp_code::memory::usage();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("items", Napi::Number::New(env, static_cast<double>(usage[Component::Items])));
+        result.Set("text", Napi::Number::New(env, static_cast<double>(usage[Component::Text])));
+        result.Set("indexes", Napi::Number::New(env, static_cast<double>(usage[Component::Indexes])));
+        result.Set("eventQueues", Napi::Number::New(env, static_cast<double>(usage[Component::EventQueues])));
+        result.Set("coldTier", Napi::Number::New(env, static_cast<double>(usage[Component::ColdTier])));
+        result.Set("total", Napi::Number::New(env, static_cast<double>(usage.total())));
+        result.Set("softLimit", Napi::Number::New(env, static_cast<double>(cpp_code::memory::soft_limit())));
+        return result;
+    }
+
+    void SetMemoryLimit(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsNumber()) {
+            Napi::TypeError::New(env, "Expected a limit in bytes").ThrowAsJavaScriptException();
+            return;
+        }
+
+        int64_t freezeAge = 30LL * 24 * 60 * 60 * 1000;
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            freezeAge = info[1].As<Napi::Number>().Int64Value();
+        }
+
+        cpp_code::set_memory_limit(info[0].As<Napi::Number>().Int64Value(), freezeAge);
+    }
+
+    static Napi::Object LaneStatsToObject(Napi::Env env, const cpp_code::EventLaneStats& stats) {
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("delivered", Napi::Number::New(env, static_cast<double>(stats.delivered)));
+        result.Set("pending", Napi::Number::New(env, static_cast<double>(stats.pending)));
+        result.Set("late", Napi::Number::New(env, static_cast<double>(stats.late)));
+        result.Set("maxLatencyMs", Napi::Number::New(env, stats.max_latency_ns / 1e6));
+        return result;
+    }
+
+    Napi::Value EventLaneStats(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("high", LaneStatsToObject(env, lanes_.stats(cpp_code::EventLane::High)));
+        result.Set("low", LaneStatsToObject(env, lanes_.stats(cpp_code::EventLane::Low)));
+        return result;
+    }
+
+    void StartRecording(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 1 || !info[0].IsString()) {
+            Napi::TypeError::New(env, "Expected a file path").ThrowAsJavaScriptException();
+            return;
+        }
+
+        try {
+            cpp_code::start_event_recorder(info[0].As<Napi::String>());
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+        }
+    }
+
+    Napi::Value StopRecording(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        try {
+            auto stats = cpp_code::stop_event_recorder();
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("events", Napi::Number::New(env, static_cast<double>(stats.events)));
+            result.Set("bytes", Napi::Number::New(env, static_cast<double>(stats.bytes)));
+            return result;
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value Replay(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        double speed = info[1].As<Napi::Number>().DoubleValue();
+        if (!(speed >= 1 && speed <= 100)) {
+            Napi::RangeError::New(env, "speed must be between 1 and 100").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        auto deferred = Napi::Promise::Deferred::New(env);
+        cpp_code::spawn(ReplayFlow(deferred, info[0].As<Napi::String>(), speed));
+        return deferred.Promise();
+    }
+
+    // Replays on a thread of its own, since a replay at low speed mostly
+    // sleeps, and settles back on the JS thread.
+    cpp_code::Task<void> ReplayFlow(Napi::Promise::Deferred deferred, std::string path, double speed) {
+        Ref();
+        js_.hold();
+
+        cpp_code::ReplayReport report{};
+        std::string error;
+        co_await cpp_code::resume_on_new_thread();
+        try {
+            report = cpp_code::replay_events(path, speed);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        co_await js_.schedule();
+
+        Napi::Env env = deferred.Env();
+        if (error.empty()) {
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("events", Napi::Number::New(env, static_cast<double>(report.events)));
+            result.Set("skipped", Napi::Number::New(env, static_cast<double>(report.skipped)));
+            result.Set("durationMs", Napi::Number::New(env, report.duration_ms));
+            result.Set("eventsPerSecond", Napi::Number::New(env, report.events_per_second));
+            Napi::Object latency = Napi::Object::New(env);
+            latency.Set("p50", Napi::Number::New(env, report.p50_us));
+            latency.Set("p90", Napi::Number::New(env, report.p90_us));
+            latency.Set("p99", Napi::Number::New(env, report.p99_us));
+            latency.Set("p999", Napi::Number::New(env, report.p999_us));
+            latency.Set("max", Napi::Number::New(env, report.max_us));
+            result.Set("latencyUs", latency);
+            result.Set("maxLagMs", Napi::Number::New(env, report.max_lag_ms));
+            deferred.Resolve(result);
+        } else {
+            deferred.Reject(Napi::Error::New(env, error).Value());
+        }
+
+        js_.release();
+        Unref();
+    }
+
+    // Cursor and replica handles are Externals tagged with the type they
+    // wrap, so any other External passed in their place is rejected rather
+    // than reinterpreted.
+    static constexpr napi_type_tag kCursorTag = {0x3f6c1a9e52d84b07ULL, 0xa4e2c8d17b5f3960ULL};
+    static constexpr napi_type_tag kReplicaTag = {0x7b19e4c2a06d5f38ULL, 0xd5a83f6e2c1b7049ULL};
+
+    // A cursor with the key strings its object pages share, created once
+    // rather than per page.
+    struct CursorHandle {
+        CursorHandle(Napi::Env env, const cpp_code::TodoCursorOptions& options)
+            : cursor(options)
+            , idKey(Napi::Persistent(Napi::String::New(env, "id")))
+            , textKey(Napi::Persistent(Napi::String::New(env, "text")))
+            , dateKey(Napi::Persistent(Napi::String::New(env, "date"))) {}
+
+        cpp_code::TodoCursor cursor;
+        Napi::Reference<Napi::String> idKey;
+        Napi::Reference<Napi::String> textKey;
+        Napi::Reference<Napi::String> dateKey;
+    };
+
+    template <typename T>
+    static T* Unwrap(const Napi::Value& value, const napi_type_tag& tag) {
+        if (!value.IsExternal()) return nullptr;
+        auto handle = value.As<Napi::External<T>>();
+        return handle.CheckTypeTag(&tag) ? handle.Data() : nullptr;
+    }
+
+    Napi::Value OpenCursor(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        cpp_code::TodoCursorOptions options;
+
+        if (info.Length() > 0 && info[0].IsString()) {
+            std::string orderBy = info[0].As<Napi::String>();
+            if (orderBy == "date") {
+                options.order_by = cpp_code::TodoCursorOrder::DateAscending;
+            } else if (orderBy == "-date") {
+                options.order_by = cpp_code::TodoCursorOrder::DateDescending;
+                options.from = INT64_MAX;
+            } else if (orderBy != "list") {
+                Napi::TypeError::New(env, "orderBy must be 'list', 'date' or '-date'").ThrowAsJavaScriptException();
+                return env.Null();
+            }
+        }
+        if (info.Length() > 1 && info[1].IsNumber()) {
+            options.from = info[1].As<Napi::Number>().Int64Value();
+        }
+
+        auto* cursor = new CursorHandle(env, options);
+        auto handle = Napi::External<CursorHandle>::New(env, cursor,
+            [](Napi::Env, CursorHandle* cursor) { delete cursor; });
+        handle.TypeTag(&kCursorTag);
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("handle", handle);
+        result.Set("size", Napi::Number::New(env, static_cast<double>(cursor->cursor.size())));
+        return result;
+    }
+
+    // Builds one page straight from the pinned items: parallel typed arrays
+    // when select is "columns", otherwise objects that share the cursor's key
+    // strings, with dates as numbers like getTodo() and query(). Returns null
+    // once the cursor is exhausted.
+    Napi::Value CursorNext(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        auto* handle = info.Length() > 0 ? Unwrap<CursorHandle>(info[0], kCursorTag) : nullptr;
+        cpp_code::TodoCursor* cursor = handle ? &handle->cursor : nullptr;
+        if (!cursor || info.Length() < 2 || !info[1].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (cursor, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        int64_t requested = info[1].As<Napi::Number>().Int64Value();
+        size_t count = std::min(static_cast<size_t>(std::max<int64_t>(requested, 1)), cursor->size() - cursor->position());
+        if (cursor->done() || count == 0) {
+            return env.Null();
+        }
+
+        bool columns = info.Length() > 2 && info[2].IsString() && info[2].As<Napi::String>().Utf8Value() == "columns";
+        char uuid_str[37];
+
+        if (columns) {
+            Napi::Uint8Array ids = Napi::Uint8Array::New(env, count * sizeof(uuid_t));
+            Napi::Float64Array dates = Napi::Float64Array::New(env, count);
+            Napi::Array texts = Napi::Array::New(env, count);
+            uint32_t i = 0;
+            cursor->next(count, [&](const cpp_code::TodoItem& todo) {
+                memcpy(ids.Data() + i * sizeof(uuid_t), todo.id, sizeof(uuid_t));
+                dates[i] = static_cast<double>(todo.date);
+                texts.Set(i, Napi::String::New(env, todo.text));
+                ++i;
+            });
+
+            Napi::Object page = Napi::Object::New(env);
+            page.Set("ids", ids);
+            page.Set("dates", dates);
+            page.Set("texts", texts);
+            return page;
+        }
+
+        Napi::String idKey = handle->idKey.Value();
+        Napi::String textKey = handle->textKey.Value();
+        Napi::String dateKey = handle->dateKey.Value();
+        Napi::Array page = Napi::Array::New(env, count);
+        uint32_t i = 0;
+        cursor->next(count, [&](const cpp_code::TodoItem& todo) {
+            uuid_unparse(todo.id, uuid_str);
+            Napi::Object item = Napi::Object::New(env);
+            item.Set(idKey, Napi::String::New(env, uuid_str));
+            item.Set(textKey, Napi::String::New(env, todo.text));
+            item.Set(dateKey, Napi::Number::New(env, static_cast<double>(todo.date)));
+            page.Set(i++, item);
+        });
+        return page;
+    }
+
+    void CloseCursor(const Napi::CallbackInfo& info) {
+        auto* handle = info.Length() > 0 ? Unwrap<CursorHandle>(info[0], kCursorTag) : nullptr;
+        if (!handle) {
+            Napi::TypeError::New(info.Env(), "Expected a cursor").ThrowAsJavaScriptException();
+            return;
+        }
+        handle->cursor.close();
+    }
+
+    // List ids are non-empty strings; everything else about a list is
+    // created on its first todo and dropped with its last.
+    static bool GetListId(const Napi::CallbackInfo& info, std::string& list) {
+        if (info.Length() < 1 || !info[0].IsString()) return false;
+        list = info[0].As<Napi::String>().Utf8Value();
+        return !list.empty();
+    }
+
+    Napi::Value AddListTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::string list;
+        if (!GetListId(info, list) || info.Length() < 3 || !info[1].IsString() || !info[2].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (list, string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        cpp_code::TodoItem todo = cpp_code::TodoLists::shared().add(
+            list, info[1].As<Napi::String>(), info[2].As<Napi::Number>().Int64Value());
+        return TodoToObject(env, todo);
+    }
+
+    Napi::Value UpdateListTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::string list;
+        uuid_t id;
+        if (!GetListId(info, list) || info.Length() < 4 || !info[1].IsString() || !info[2].IsString() ||
+            !info[3].IsNumber() || uuid_parse(info[1].As<Napi::String>().Utf8Value().c_str(), id) != 0) {
+            Napi::TypeError::New(env, "Expected (list, id, string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        bool updated = cpp_code::TodoLists::shared().update(
+            list, id, info[2].As<Napi::String>(), info[3].As<Napi::Number>().Int64Value());
+        return Napi::Boolean::New(env, updated);
+    }
+
+    Napi::Value DeleteListTodo(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::string list;
+        uuid_t id;
+        if (!GetListId(info, list) || info.Length() < 2 || !info[1].IsString() ||
+            uuid_parse(info[1].As<Napi::String>().Utf8Value().c_str(), id) != 0) {
+            Napi::TypeError::New(env, "Expected (list, id) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return Napi::Boolean::New(env, cpp_code::TodoLists::shared().remove(list, id));
+    }
+
+    Napi::Value GetList(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        std::string list;
+        if (!GetListId(info, list)) {
+            Napi::TypeError::New(env, "Expected a list id").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::vector<cpp_code::TodoItem> todos = cpp_code::TodoLists::shared().items(list);
+        Napi::Array result = Napi::Array::New(env, todos.size());
+        for (size_t i = 0; i < todos.size(); ++i) {
+            result.Set(static_cast<uint32_t>(i), TodoToObject(env, todos[i]));
+        }
+        return result;
+    }
+
+    // getAggregates(from, to, bucketDays): counts stay O(log n) per bucket,
+    // so the bucket count is capped rather than the range.
+    Napi::Value GetAggregates(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+        constexpr int64_t kMaxBuckets = 100000;
+
+        int64_t from = 0, to = 0, bucketDays = 1;
+        if (info.Length() >= 2 && info[0].IsNumber() && info[1].IsNumber()) {
+            from = info[0].As<Napi::Number>().Int64Value();
+            to = info[1].As<Napi::Number>().Int64Value();
+        }
+        if (info.Length() >= 3 && info[2].IsNumber()) {
+            bucketDays = info[2].As<Napi::Number>().Int64Value();
+        }
+        // The span of two int64 dates can exceed int64, so it is taken in
+        // 128 bits.
+        __int128 span = static_cast<__int128>(to) - from;
+        if (bucketDays < 1 || (span > 0 && span / cpp_code::kDayMs / bucketDays >= kMaxBuckets)) {
+            Napi::RangeError::New(env, "Expected at most 100000 buckets of at least one day").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        cpp_code::TodoAggregateReport report = cpp_code::todo_aggregates(from, to, bucketDays, NowMs());
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("total", Napi::Number::New(env, static_cast<double>(report.total)));
+        result.Set("overdue", Napi::Number::New(env, static_cast<double>(report.overdue)));
+        result.Set("inRange", Napi::Number::New(env, static_cast<double>(report.in_range)));
+        Napi::Array buckets = Napi::Array::New(env, report.buckets.size());
+        for (size_t i = 0; i < report.buckets.size(); ++i) {
+            Napi::Object bucket = Napi::Object::New(env);
+            bucket.Set("start", Napi::Number::New(env, static_cast<double>(report.buckets[i].start)));
+            bucket.Set("count", Napi::Number::New(env, static_cast<double>(report.buckets[i].count)));
+            buckets.Set(static_cast<uint32_t>(i), bucket);
+        }
+        result.Set("buckets", buckets);
+        return result;
+    }
+
+    // Replicas are owned by their JS handle and freed when it is collected.
+    Napi::Value CreateReplica(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        auto* replica = new cpp_code::TodoReplica();
+        char id[17];
+        snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(replica->id()));
+
+        auto handle = Napi::External<cpp_code::TodoReplica>::New(env, replica,
+            [](Napi::Env, cpp_code::TodoReplica* replica) { delete replica; });
+        handle.TypeTag(&kReplicaTag);
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("handle", handle);
+        result.Set("id", Napi::String::New(env, id));
+        return result;
+    }
+
+    static cpp_code::TodoReplica* GetReplica(const Napi::CallbackInfo& info) {
+        return info.Length() > 0 ? Unwrap<cpp_code::TodoReplica>(info[0], kReplicaTag) : nullptr;
+    }
+
+    static bool GetReplicaTodoId(const Napi::CallbackInfo& info, uuid_t id) {
+        return info.Length() > 1 && info[1].IsString() &&
+               uuid_parse(info[1].As<Napi::String>().Utf8Value().c_str(), id) == 0;
+    }
+
+    Napi::Value ReplicaAdd(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        if (!replica || info.Length() < 3 || !info[1].IsString() || !info[2].IsNumber()) {
+            Napi::TypeError::New(env, "Expected (replica, string, number) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return TodoToObject(env, replica->add(info[1].As<Napi::String>(), info[2].As<Napi::Number>().Int64Value()));
+    }
+
+    // Text and date are each optional: only the fields given are written,
+    // so concurrent edits of different fields both survive a merge.
+    Napi::Value ReplicaUpdate(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        uuid_t id;
+        if (!replica || !GetReplicaTodoId(info, id)) {
+            Napi::TypeError::New(env, "Expected (replica, id, text?, date?) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::optional<std::string> text;
+        std::optional<int64_t> date;
+        if (info.Length() > 2 && info[2].IsString()) {
+            text = info[2].As<Napi::String>().Utf8Value();
+        }
+        if (info.Length() > 3 && info[3].IsNumber()) {
+            date = info[3].As<Napi::Number>().Int64Value();
+        }
+        return Napi::Boolean::New(env, replica->update(id, text, date));
+    }
+
+    Napi::Value ReplicaDelete(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        uuid_t id;
+        if (!replica || !GetReplicaTodoId(info, id)) {
+            Napi::TypeError::New(env, "Expected (replica, id) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return Napi::Boolean::New(env, replica->remove(id));
+    }
+
+    Napi::Value ReplicaItems(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        if (!replica) {
+            Napi::TypeError::New(env, "Expected a replica").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        std::vector<cpp_code::TodoItem> todos = replica->items();
+        Napi::Array result = Napi::Array::New(env, todos.size());
+        for (size_t i = 0; i < todos.size(); ++i) {
+            result.Set(static_cast<uint32_t>(i), TodoToObject(env, todos[i]));
+        }
+        return result;
+    }
+
+    static Napi::Uint8Array BytesToArray(Napi::Env env, const std::string& bytes) {
+        Napi::Uint8Array result = Napi::Uint8Array::New(env, bytes.size());
+        memcpy(result.Data(), bytes.data(), bytes.size());
+        return result;
+    }
+
+    static bool GetBytes(const Napi::CallbackInfo& info, std::string_view& bytes) {
+        if (info.Length() < 2 || !info[1].IsTypedArray()) return false;
+        Napi::TypedArray array = info[1].As<Napi::TypedArray>();
+        if (array.TypedArrayType() != napi_uint8_array) return false;
+        Napi::Uint8Array data = array.As<Napi::Uint8Array>();
+        bytes = std::string_view(reinterpret_cast<const char*>(data.Data()), data.ByteLength());
+        return true;
+    }
+
+    Napi::Value ReplicaSummary(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        if (!replica) {
+            Napi::TypeError::New(env, "Expected a replica").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        return BytesToArray(env, replica->summary());
+    }
+
+    Napi::Value ReplicaDeltasSince(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        std::string_view summary;
+        if (!replica || !GetBytes(info, summary)) {
+            Napi::TypeError::New(env, "Expected (replica, Uint8Array) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            return BytesToArray(env, replica->deltas_since(summary));
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
+    }
+
+    Napi::Value ReplicaMerge(const Napi::CallbackInfo& info) {
+        Napi::Env env = info.Env();
+
+        cpp_code::TodoReplica* replica = GetReplica(info);
+        std::string_view deltas;
+        if (!replica || !GetBytes(info, deltas)) {
+            Napi::TypeError::New(env, "Expected (replica, Uint8Array) arguments").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+
+        try {
+            cpp_code::TodoMergeResult merged = replica->merge(deltas);
+            Napi::Object result = Napi::Object::New(env);
+            result.Set("applied", Napi::Number::New(env, static_cast<double>(merged.applied)));
+            result.Set("duplicates", Napi::Number::New(env, static_cast<double>(merged.duplicates)));
+            result.Set("deferred", Napi::Number::New(env, static_cast<double>(merged.deferred)));
+            return result;
+        } catch (const std::exception& e) {
+            Napi::Error::New(env, e.what()).ThrowAsJavaScriptException();
+            return env.Null();
+        }
     }
 
     Napi::Value On(const Napi::CallbackInfo& info) {
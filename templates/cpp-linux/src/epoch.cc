@@ -0,0 +1,129 @@
+#include "epoch.h"
+#include <limits>
+#include <utility>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    // Slots this thread owns, one per domain it has read from. Slots are
+    // handed back when the thread exits; domains must outlive their readers.
+    struct ThreadSlots
+    {
+      std::vector<std::pair<const void *, std::atomic<bool> *>> owned;
+      std::vector<std::pair<const void *, int>> index;
+
+      ~ThreadSlots()
+      {
+        for (auto &entry : owned)
+        {
+          entry.second->store(false, std::memory_order_release);
+        }
+      }
+    };
+
+    thread_local ThreadSlots t_slots;
+  }
+
+  EpochDomain::EpochDomain() = default;
+
+  EpochDomain::~EpochDomain()
+  {
+    for (auto &retired : retired_)
+    {
+      retired.deleter(retired.object);
+    }
+  }
+
+  int EpochDomain::acquire_slot()
+  {
+    for (auto &entry : t_slots.index)
+    {
+      if (entry.first == this)
+        return entry.second;
+    }
+
+    for (size_t i = 0; i < kMaxReaderThreads; ++i)
+    {
+      bool expected = false;
+      if (!slots_[i].owned.load(std::memory_order_relaxed) &&
+          slots_[i].owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+      {
+        t_slots.index.emplace_back(this, static_cast<int>(i));
+        t_slots.owned.emplace_back(this, &slots_[i].owned);
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  EpochDomain::Guard::Guard(EpochDomain &domain)
+      : domain_(domain), slot_(domain.acquire_slot())
+  {
+    if (slot_ < 0)
+    {
+      domain_.overflow_readers_.fetch_add(1, std::memory_order_seq_cst);
+      return;
+    }
+
+    Slot &slot = domain_.slots_[slot_];
+    if (slot.depth++ == 0)
+    {
+      slot.epoch.store(domain_.epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+    }
+  }
+
+  EpochDomain::Guard::~Guard()
+  {
+    if (slot_ < 0)
+    {
+      domain_.overflow_readers_.fetch_sub(1, std::memory_order_release);
+      return;
+    }
+
+    Slot &slot = domain_.slots_[slot_];
+    if (--slot.depth == 0)
+    {
+      slot.epoch.store(0, std::memory_order_release);
+    }
+  }
+
+  void EpochDomain::retire(void *object, void (*deleter)(void *))
+  {
+    // A reader whose slot holds an epoch <= the returned value may have
+    // loaded `object` before it was unpublished; later readers cannot.
+    uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    retired_.push_back({epoch, object, deleter});
+    reclaim();
+  }
+
+  void EpochDomain::reclaim()
+  {
+    if (overflow_readers_.load(std::memory_order_seq_cst) != 0)
+      return;
+
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for (auto &slot : slots_)
+    {
+      uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+      if (epoch != 0 && epoch < oldest)
+        oldest = epoch;
+    }
+
+    size_t kept = 0;
+    for (auto &retired : retired_)
+    {
+      if (retired.epoch < oldest)
+      {
+        retired.deleter(retired.object);
+      }
+      else
+      {
+        retired_[kept++] = retired;
+      }
+    }
+    retired_.resize(kept);
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,328 @@
+#include "event_recorder.h"
+#include "todo_store.h"
+#include "varint.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    constexpr char kMagic[8] = {'T', 'O', 'D', 'O', 'R', 'E', 'C', '1'};
+
+    // The writer wakes when this much is buffered, or every kFlushInterval.
+    constexpr size_t kFlushBytes = 256 * 1024;
+    constexpr auto kFlushInterval = std::chrono::milliseconds(100);
+
+    enum RecordType : uint8_t
+    {
+      kAdded = 1,
+      kUpdated = 2,
+      kDeleted = 3
+    };
+
+    uint64_t now_us()
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    }
+
+    class EventRecorder
+    {
+    public:
+      explicit EventRecorder(FILE *file) : file_(file), last_us_(now_us())
+      {
+        if (fwrite(kMagic, 1, sizeof(kMagic), file_) != sizeof(kMagic))
+          failed_ = true;
+        bytes_ = sizeof(kMagic);
+        writer_ = std::thread([this]()
+                              { run(); });
+      }
+
+      // Runs on the mutating thread under the store's write mutex, so
+      // records are already in mutation order.
+      void append(TodoChange change, const TodoItem &todo)
+      {
+        uint64_t now = now_us();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_)
+          return;
+
+        active_.push_back(static_cast<char>(change == TodoChange::Added     ? kAdded
+                                            : change == TodoChange::Updated ? kUpdated
+                                                                            : kDeleted));
+        put_varint(active_, now - last_us_);
+        last_us_ = now;
+        active_.append(reinterpret_cast<const char *>(todo.id), sizeof(uuid_t));
+        if (change != TodoChange::Deleted)
+        {
+          put_varint(active_, zigzag(todo.date - last_date_));
+          last_date_ = todo.date;
+          put_varint(active_, todo.text.size());
+          active_.append(todo.text);
+        }
+        ++events_;
+        if (active_.size() >= kFlushBytes)
+          cv_.notify_one();
+      }
+
+      RecorderStats stop()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stopping_ = true;
+        }
+        cv_.notify_one();
+        writer_.join();
+
+        if (fclose(file_) != 0)
+          failed_ = true;
+        if (failed_)
+          throw std::runtime_error("Failed to write the event recording");
+        return {events_, bytes_};
+      }
+
+    private:
+      // Swaps the buffers under the lock and writes outside it, so appending
+      // never waits for the disk.
+      void run()
+      {
+        std::string writing;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+          cv_.wait_for(lock, kFlushInterval, [this]()
+                       { return stopping_ || active_.size() >= kFlushBytes; });
+          writing.swap(active_);
+          bool stopping = stopping_;
+          lock.unlock();
+
+          if (!writing.empty() && fwrite(writing.data(), 1, writing.size(), file_) != writing.size())
+            failed_ = true;
+          bytes_ += writing.size();
+          writing.clear();
+
+          lock.lock();
+          if (stopping)
+            return;
+        }
+      }
+
+      FILE *file_;
+      std::thread writer_;
+      std::mutex mutex_;
+      std::condition_variable cv_;
+      std::string active_;
+      bool stopping_ = false;
+      uint64_t last_us_;
+      int64_t last_date_ = 0;
+      uint64_t events_ = 0;
+      // Writer thread only until it has been joined.
+      uint64_t bytes_ = 0;
+      bool failed_ = false;
+    };
+
+    std::mutex g_recorder_mutex;
+    std::shared_ptr<EventRecorder> g_recorder;
+    int g_recorder_observer = 0;
+
+    RecorderStats stop_locked()
+    {
+      if (!g_recorder)
+        return {0, 0};
+      remove_todo_observer(g_recorder_observer);
+      auto recorder = std::move(g_recorder);
+      return recorder->stop();
+    }
+
+    struct Record
+    {
+      uint8_t type;
+      uint64_t at_us; // since the start of the recording
+      std::array<unsigned char, 16> id;
+      int64_t date;
+      std::string_view text;
+    };
+
+    std::string read_file(const std::string &path)
+    {
+      FILE *file = fopen(path.c_str(), "rb");
+      if (!file)
+        throw std::runtime_error("Cannot open " + path);
+      std::string data;
+      char buffer[64 * 1024];
+      size_t read;
+      while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, read);
+      bool failed = ferror(file) != 0;
+      fclose(file);
+      if (failed)
+        throw std::runtime_error("Failed to read " + path);
+      return data;
+    }
+
+    std::vector<Record> parse_records(std::string_view data)
+    {
+      if (data.size() < sizeof(kMagic) || memcmp(data.data(), kMagic, sizeof(kMagic)) != 0)
+        throw std::runtime_error("Not an event recording");
+
+      ByteReader reader(data.substr(sizeof(kMagic)), "Corrupt event recording");
+      std::vector<Record> records;
+      uint64_t at = 0;
+      int64_t date = 0;
+      while (!reader.done())
+      {
+        Record record{};
+        record.type = reader.byte();
+        if (record.type < kAdded || record.type > kDeleted)
+          throw std::runtime_error("Corrupt event recording");
+        at += reader.varint();
+        record.at_us = at;
+        memcpy(record.id.data(), reader.bytes(16).data(), 16);
+        if (record.type != kDeleted)
+        {
+          date += unzigzag(reader.varint());
+          record.date = date;
+          record.text = reader.bytes(reader.varint());
+        }
+        records.push_back(record);
+      }
+      return records;
+    }
+
+    // Ids are random, so their first eight bytes are a good hash.
+    struct IdHash
+    {
+      size_t operator()(const std::array<unsigned char, 16> &id) const
+      {
+        uint64_t hash;
+        memcpy(&hash, id.data(), sizeof(hash));
+        return static_cast<size_t>(hash);
+      }
+    };
+
+    double percentile_us(const std::vector<uint64_t> &sorted, double p)
+    {
+      if (sorted.empty())
+        return 0;
+      return sorted[static_cast<size_t>(p * (sorted.size() - 1))] / 1000.0;
+    }
+  }
+
+  void start_event_recorder(const std::string &path)
+  {
+    std::lock_guard<std::mutex> lock(g_recorder_mutex);
+    try
+    {
+      stop_locked();
+    }
+    catch (const std::exception &)
+    {
+      // The previous recording is being replaced; its error has no caller.
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+      throw std::runtime_error("Cannot open " + path + " for writing");
+
+    auto recorder = std::make_shared<EventRecorder>(file);
+    g_recorder_observer = add_todo_observer([recorder](TodoChange change, const TodoItem &todo)
+                                            { recorder->append(change, todo); });
+    g_recorder = std::move(recorder);
+  }
+
+  RecorderStats stop_event_recorder()
+  {
+    std::lock_guard<std::mutex> lock(g_recorder_mutex);
+    return stop_locked();
+  }
+
+  ReplayReport replay_events(const std::string &path, double speed)
+  {
+    if (!(speed > 0))
+      throw std::invalid_argument("Replay speed must be positive");
+
+    std::string data = read_file(path);
+    std::vector<Record> records = parse_records(data);
+
+    using Clock = std::chrono::steady_clock;
+    std::unordered_map<std::array<unsigned char, 16>, std::array<unsigned char, 16>, IdHash> ids;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(records.size());
+    ReplayReport report{};
+
+    const Clock::time_point start = Clock::now();
+    for (const Record &record : records)
+    {
+      auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(record.at_us * 1000 / speed));
+      Clock::time_point now = Clock::now();
+      if (now < due)
+      {
+        std::this_thread::sleep_until(due);
+        now = Clock::now();
+      }
+      report.max_lag_ms = std::max(report.max_lag_ms,
+                                   std::chrono::duration<double, std::milli>(now - due).count());
+
+      auto mapped = ids.find(record.id);
+      if (record.type != kAdded && mapped == ids.end())
+      {
+        ++report.skipped;
+        continue;
+      }
+
+      bool applied = true;
+      Clock::time_point begin = Clock::now();
+      switch (record.type)
+      {
+      case kAdded:
+      {
+        TodoItem todo = add_todo(std::string(record.text), record.date);
+        memcpy(ids[record.id].data(), todo.id, sizeof(uuid_t));
+        break;
+      }
+      case kUpdated:
+        applied = update_todo(mapped->second.data(), std::string(record.text), record.date);
+        break;
+      case kDeleted:
+        applied = delete_todo(mapped->second.data());
+        ids.erase(mapped);
+        break;
+      }
+      uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+      if (!applied)
+      {
+        ++report.skipped;
+        continue;
+      }
+      latencies.push_back(latency);
+    }
+
+    report.events = latencies.size();
+    report.duration_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    report.events_per_second = report.duration_ms > 0 ? report.events * 1000.0 / report.duration_ms : 0;
+
+    std::sort(latencies.begin(), latencies.end());
+    report.p50_us = percentile_us(latencies, 0.5);
+    report.p90_us = percentile_us(latencies, 0.9);
+    report.p99_us = percentile_us(latencies, 0.99);
+    report.p999_us = percentile_us(latencies, 0.999);
+    report.max_us = latencies.empty() ? 0 : latencies.back() / 1000.0;
+    return report;
+  }
+
+} // namespace cpp_code
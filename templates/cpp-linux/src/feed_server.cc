@@ -0,0 +1,448 @@
+#include "feed_server.h"
+#include "memory_accounting.h"
+#include "todo_store.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    using Frame = std::shared_ptr<const std::string>;
+
+    // Frames handed to a single vectored write.
+    constexpr int kMaxIovecs = 256;
+
+    void put_u32(std::string &out, uint32_t value)
+    {
+      for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    void put_u64(std::string &out, uint64_t value)
+    {
+      for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+
+    // Frames count as event queue memory until the last subscriber has sent
+    // them.
+    Frame encode_frame(TodoChange change, const TodoItem &todo)
+    {
+      auto frame = std::make_unique<std::string>();
+      uint32_t length = 1 + sizeof(todo.id) + 8 + 4 + static_cast<uint32_t>(todo.text.size());
+      frame->reserve(4 + length);
+      put_u32(*frame, length);
+      frame->push_back(static_cast<char>(change == TodoChange::Added     ? 1
+                                         : change == TodoChange::Updated ? 2
+                                                                         : 3));
+      frame->append(reinterpret_cast<const char *>(todo.id), sizeof(todo.id));
+      put_u64(*frame, static_cast<uint64_t>(todo.date));
+      put_u32(*frame, static_cast<uint32_t>(todo.text.size()));
+      frame->append(todo.text);
+
+      memory::add(memory::Component::EventQueues, sizeof(std::string) + frame->capacity());
+      return Frame(frame.release(), [](const std::string *owned)
+                   {
+        memory::add(memory::Component::EventQueues, -static_cast<int64_t>(sizeof(std::string) + owned->capacity()));
+        delete owned; });
+    }
+
+    struct Subscriber
+    {
+      int fd;
+      std::deque<Frame> queue;
+      size_t offset = 0; // bytes of queue.front() already sent
+      size_t buffered = 0;
+      bool want_write = false;
+    };
+
+    class FeedServer
+    {
+    public:
+      FeedServer(const std::string &path, size_t max_buffered_bytes)
+          : path_(path), max_buffered_(max_buffered_bytes)
+      {
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path))
+        {
+          throw std::runtime_error("Socket path is too long: " + path);
+        }
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0)
+        {
+          throw std::runtime_error(std::string("socket failed: ") + strerror(errno));
+        }
+
+        // Only replace a socket left behind by an earlier run, never a file.
+        struct stat existing;
+        if (lstat(path.c_str(), &existing) == 0)
+        {
+          if (!S_ISSOCK(existing.st_mode))
+          {
+            close(listen_fd_);
+            throw std::runtime_error("Not replacing " + path + ": it exists and is not a socket");
+          }
+          unlink(path.c_str());
+        }
+        if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+          int error = errno;
+          close(listen_fd_);
+          throw std::runtime_error("Failed to listen on " + path + ": " + strerror(error));
+        }
+        struct stat bound;
+        if (lstat(path.c_str(), &bound) == 0)
+        {
+          socket_dev_ = bound.st_dev;
+          socket_ino_ = bound.st_ino;
+        }
+
+        if (listen(listen_fd_, SOMAXCONN) != 0)
+          fail("Failed to listen on " + path);
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (event_fd_ < 0)
+          fail("eventfd failed");
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0)
+          fail("epoll_create1 failed");
+        if (!add_fd(listen_fd_, EPOLLIN) || !add_fd(event_fd_, EPOLLIN))
+          fail("epoll_ctl failed");
+
+        observer_ = add_todo_observer([this](TodoChange change, const TodoItem &todo)
+                                      { enqueue(encode_frame(change, todo)); });
+        thread_ = std::thread([this]()
+                              { run(); });
+      }
+
+      ~FeedServer()
+      {
+        remove_todo_observer(observer_);
+        stopping_ = true;
+        wake();
+        thread_.join();
+
+        for (auto &entry : subscribers_)
+        {
+          close(entry.first);
+        }
+        close(epoll_fd_);
+        close(event_fd_);
+        close(listen_fd_);
+        unlink_socket();
+      }
+
+      FeedServerStats stats() const
+      {
+        return {subscriber_count_.load(std::memory_order_relaxed),
+                events_.load(std::memory_order_relaxed),
+                disconnected_slow_.load(std::memory_order_relaxed)};
+      }
+
+    private:
+      // Releases what the constructor set up so far and throws.
+      [[noreturn]] void fail(const std::string &what)
+      {
+        int error = errno;
+        if (epoll_fd_ >= 0)
+          close(epoll_fd_);
+        if (event_fd_ >= 0)
+          close(event_fd_);
+        close(listen_fd_);
+        unlink_socket();
+        throw std::runtime_error(what + ": " + strerror(error));
+      }
+
+      // Removes the socket this server bound, unless something else has
+      // taken its path since.
+      void unlink_socket()
+      {
+        struct stat current;
+        if (lstat(path_.c_str(), &current) == 0 && S_ISSOCK(current.st_mode) &&
+            current.st_dev == socket_dev_ && current.st_ino == socket_ino_)
+        {
+          unlink(path_.c_str());
+        }
+      }
+
+      bool add_fd(int fd, uint32_t events)
+      {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+      }
+
+      void wake()
+      {
+        uint64_t one = 1;
+        ssize_t ignored = write(event_fd_, &one, sizeof(one));
+        (void)ignored;
+      }
+
+      // Called on mutating threads: a short critical section and, only when
+      // the queue was empty, a non-blocking eventfd write.
+      void enqueue(Frame frame)
+      {
+        bool was_empty;
+        {
+          std::lock_guard<std::mutex> lock(pending_mutex_);
+          was_empty = pending_.empty();
+          pending_.push_back(std::move(frame));
+        }
+        if (was_empty)
+          wake();
+      }
+
+      void run()
+      {
+        epoll_event events[64];
+        std::vector<Frame> batch;
+
+        while (!stopping_)
+        {
+          int ready = epoll_wait(epoll_fd_, events, 64, -1);
+          if (ready < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            return;
+          }
+
+          for (int i = 0; i < ready; ++i)
+          {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_)
+            {
+              accept_all();
+            }
+            else if (fd == event_fd_)
+            {
+              uint64_t count;
+              ssize_t ignored = read(event_fd_, &count, sizeof(count));
+              (void)ignored;
+              {
+                std::lock_guard<std::mutex> lock(pending_mutex_);
+                batch.swap(pending_);
+              }
+              broadcast(batch);
+              batch.clear();
+            }
+            else if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+            {
+              drop(fd);
+            }
+            else
+            {
+              if (events[i].events & EPOLLIN)
+                discard_input(fd);
+              if (events[i].events & EPOLLOUT)
+                flush(fd);
+            }
+          }
+        }
+      }
+
+      void accept_all()
+      {
+        while (true)
+        {
+          int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+          if (fd < 0)
+            return;
+          if (!add_fd(fd, EPOLLIN | EPOLLRDHUP))
+          {
+            close(fd);
+            continue;
+          }
+          subscribers_[fd].fd = fd;
+          subscriber_count_.store(subscribers_.size(), std::memory_order_relaxed);
+        }
+      }
+
+      void discard_input(int fd)
+      {
+        char buffer[256];
+        while (true)
+        {
+          ssize_t n = read(fd, buffer, sizeof(buffer));
+          if (n > 0)
+            continue;
+          if (n == 0 || (errno != EAGAIN && errno != EINTR))
+            drop(fd);
+          return;
+        }
+      }
+
+      void drop(int fd)
+      {
+        if (subscribers_.erase(fd))
+        {
+          epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+          close(fd);
+          subscriber_count_.store(subscribers_.size(), std::memory_order_relaxed);
+        }
+      }
+
+      void broadcast(const std::vector<Frame> &batch)
+      {
+        if (batch.empty())
+          return;
+        events_.fetch_add(batch.size(), std::memory_order_relaxed);
+
+        std::vector<int> slow;
+        for (auto &entry : subscribers_)
+        {
+          Subscriber &sub = entry.second;
+          for (auto &frame : batch)
+          {
+            sub.queue.push_back(frame);
+            sub.buffered += frame->size();
+          }
+          if (sub.buffered > max_buffered_)
+          {
+            slow.push_back(sub.fd);
+          }
+        }
+
+        for (int fd : slow)
+        {
+          disconnected_slow_.fetch_add(1, std::memory_order_relaxed);
+          drop(fd);
+        }
+
+        std::vector<int> fds;
+        fds.reserve(subscribers_.size());
+        for (auto &entry : subscribers_)
+          fds.push_back(entry.first);
+        for (int fd : fds)
+          flush(fd);
+      }
+
+      // Sends as much of the backlog as the socket accepts, many frames per
+      // vectored sendmsg(), and only asks epoll for EPOLLOUT while a backlog remains.
+      void flush(int fd)
+      {
+        auto it = subscribers_.find(fd);
+        if (it == subscribers_.end())
+          return;
+        Subscriber &sub = it->second;
+
+        while (!sub.queue.empty())
+        {
+          iovec iov[kMaxIovecs];
+          int count = 0;
+          for (auto frame = sub.queue.begin(); frame != sub.queue.end() && count < kMaxIovecs; ++frame, ++count)
+          {
+            size_t skip = count == 0 ? sub.offset : 0;
+            iov[count].iov_base = const_cast<char *>((*frame)->data()) + skip;
+            iov[count].iov_len = (*frame)->size() - skip;
+          }
+
+          msghdr msg{};
+          msg.msg_iov = iov;
+          msg.msg_iovlen = count;
+          ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+          if (sent < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            if (errno == EAGAIN)
+              break;
+            drop(fd);
+            return;
+          }
+
+          size_t remaining = static_cast<size_t>(sent);
+          sub.buffered -= remaining;
+          while (remaining > 0)
+          {
+            size_t left = sub.queue.front()->size() - sub.offset;
+            if (remaining < left)
+            {
+              sub.offset += remaining;
+              break;
+            }
+            remaining -= left;
+            sub.offset = 0;
+            sub.queue.pop_front();
+          }
+        }
+
+        bool want_write = !sub.queue.empty();
+        if (want_write != sub.want_write)
+        {
+          epoll_event ev{};
+          ev.events = EPOLLIN | EPOLLRDHUP | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+          ev.data.fd = fd;
+          epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+          sub.want_write = want_write;
+        }
+      }
+
+      std::string path_;
+      size_t max_buffered_;
+      int listen_fd_ = -1;
+      int event_fd_ = -1;
+      int epoll_fd_ = -1;
+      dev_t socket_dev_ = 0; // identify the socket file this server bound
+      ino_t socket_ino_ = 0;
+      int observer_ = 0;
+      std::atomic<bool> stopping_{false};
+      std::thread thread_;
+
+      std::mutex pending_mutex_;
+      std::vector<Frame> pending_;
+
+      // Only touched on the server thread.
+      std::unordered_map<int, Subscriber> subscribers_;
+
+      std::atomic<uint64_t> subscriber_count_{0};
+      std::atomic<uint64_t> events_{0};
+      std::atomic<uint64_t> disconnected_slow_{0};
+    };
+
+    std::mutex g_server_mutex;
+    std::unique_ptr<FeedServer> g_server;
+  }
+
+  void start_feed_server(const std::string &path, size_t max_buffered_bytes)
+  {
+    std::lock_guard<std::mutex> lock(g_server_mutex);
+    g_server.reset();
+    g_server = std::make_unique<FeedServer>(path, max_buffered_bytes);
+  }
+
+  void stop_feed_server()
+  {
+    std::lock_guard<std::mutex> lock(g_server_mutex);
+    g_server.reset();
+  }
+
+  FeedServerStats feed_server_stats()
+  {
+    std::lock_guard<std::mutex> lock(g_server_mutex);
+    return g_server ? g_server->stats() : FeedServerStats{0, 0, 0};
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,596 @@
+#include <gtk/gtk.h>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <uuid/uuid.h>
+#include <ctime>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <pthread.h>
+#include "gui_plugin.h"
+
+namespace cpp_code
+{
+
+  // The front end keeps its own copy of the rows it displays; the todo list
+  // itself lives in the core addon and is only mutated through g_host. Rows
+  // follow the store through cpp_gui_todo_changed, including changes made by
+  // the front end itself, so there is a single path that updates them.
+  struct TodoRow
+  {
+    uuid_t id;
+    std::string text;
+    int64_t date;
+
+    static std::string formatDate(int64_t timestamp)
+    {
+      char date_str[64];
+      time_t unix_time = timestamp / 1000;
+      strftime(date_str, sizeof(date_str), "%Y-%m-%d", localtime(&unix_time));
+      return date_str;
+    }
+  };
+
+  // Forward declarations
+  static void update_todo_row_label(GtkListBoxRow *row, const TodoRow &todo);
+  static GtkWidget *create_todo_dialog(GtkWindow *parent, const TodoRow *existing_todo);
+
+  // Global state
+  namespace
+  {
+    const cpp_gui_host *g_host = nullptr;
+    GMainContext *g_gtk_main_context = nullptr;
+    // Open, close and dispose are serialized by the host, which owns the
+    // thread's lifecycle. The application and window belong to the thread.
+    std::thread g_gtk_thread;
+    GtkApplication *g_app = nullptr;
+    GtkWindow *g_window = nullptr;
+    GtkListBox *g_list = nullptr;
+    std::vector<TodoRow> g_rows;
+
+    // Reports the enclosing handler to the host's tracer.
+    class HandlerSpan
+    {
+    public:
+      explicit HandlerSpan(const char *name)
+          : name_(g_host->trace_enabled() ? name : nullptr), start_(name_ ? g_host->trace_now() : 0) {}
+
+      ~HandlerSpan()
+      {
+        if (name_)
+          g_host->trace_span(name_, start_, g_host->trace_now());
+      }
+
+    private:
+      const char *name_;
+      uint64_t start_;
+    };
+
+    // Tasks posted to the GTK thread. The list is intrusive, so posting never
+    // allocates; the source is created once and woken by its ready time.
+    std::mutex g_task_mutex;
+    GSource *g_task_source = nullptr;
+    cpp_gui_task *g_task_head = nullptr;
+    cpp_gui_task *g_task_tail = nullptr;
+
+    void run_tasks(cpp_gui_task *task)
+    {
+      while (task)
+      {
+        // `run` may free the task, e.g. by finishing a coroutine.
+        cpp_gui_task *next = task->next;
+        task->run(task);
+        task = next;
+      }
+    }
+
+    cpp_gui_task *take_tasks()
+    {
+      std::lock_guard<std::mutex> lock(g_task_mutex);
+      cpp_gui_task *tasks = g_task_head;
+      g_task_head = g_task_tail = nullptr;
+      return tasks;
+    }
+
+    gboolean dispatch_tasks(GSource *source, GSourceFunc, gpointer)
+    {
+      g_source_set_ready_time(source, -1);
+      run_tasks(take_tasks());
+      return G_SOURCE_CONTINUE;
+    }
+
+    GSourceFuncs g_task_source_funcs = {nullptr, nullptr, dispatch_tasks, nullptr, nullptr, nullptr};
+
+    int post_task(cpp_gui_task *task)
+    {
+      std::lock_guard<std::mutex> lock(g_task_mutex);
+      if (!g_task_source)
+        return 0;
+
+      task->next = nullptr;
+      if (g_task_tail)
+        g_task_tail->next = task;
+      else
+        g_task_head = task;
+      g_task_tail = task;
+      g_source_set_ready_time(g_task_source, 0);
+      return 1;
+    }
+
+    // Called on the GTK thread once the application has returned; tasks that
+    // were still queued run here rather than being dropped.
+    void stop_tasks()
+    {
+      GSource *source;
+      {
+        std::lock_guard<std::mutex> lock(g_task_mutex);
+        source = g_task_source;
+        g_task_source = nullptr;
+      }
+      if (source)
+      {
+        g_source_destroy(source);
+        g_source_unref(source);
+      }
+      run_tasks(take_tasks());
+    }
+
+    struct TodoChangeTask
+    {
+      cpp_gui_task task; // must stay first
+      int change;
+      TodoRow todo;
+    };
+  }
+
+  static void update_todo_row_label(GtkListBoxRow *row, const TodoRow &todo)
+  {
+    auto *label = gtk_label_new((todo.text + " - " + TodoRow::formatDate(todo.date)).c_str());
+    auto *old_label = GTK_WIDGET(gtk_container_get_children(GTK_CONTAINER(row))->data);
+    gtk_container_remove(GTK_CONTAINER(row), old_label);
+    gtk_container_add(GTK_CONTAINER(row), label);
+    gtk_widget_show_all(GTK_WIDGET(row));
+  }
+
+  static void append_row_widget(const TodoRow &todo)
+  {
+    auto *row = gtk_list_box_row_new();
+    auto *label = gtk_label_new((todo.text + " - " + TodoRow::formatDate(todo.date)).c_str());
+    gtk_container_add(GTK_CONTAINER(row), label);
+    gtk_container_add(GTK_CONTAINER(g_list), row);
+    gtk_widget_show_all(row);
+  }
+
+  // Runs on the GTK thread. Changes are idempotent because the rows loaded
+  // when the window opens may already include changes that are still queued.
+  static void apply_todo_change(int change, const TodoRow &todo)
+  {
+    gint index = -1;
+    for (size_t i = 0; i < g_rows.size(); ++i)
+    {
+      if (memcmp(g_rows[i].id, todo.id, sizeof(uuid_t)) == 0)
+      {
+        index = static_cast<gint>(i);
+        break;
+      }
+    }
+
+    if (change == CPP_GUI_TODO_DELETED)
+    {
+      if (index < 0)
+        return;
+      if (g_list)
+        gtk_container_remove(GTK_CONTAINER(g_list), GTK_WIDGET(gtk_list_box_get_row_at_index(g_list, index)));
+      g_rows.erase(g_rows.begin() + index);
+      return;
+    }
+
+    if (index < 0)
+    {
+      g_rows.push_back(todo);
+      if (g_list)
+        append_row_widget(todo);
+      return;
+    }
+
+    g_rows[index].text = todo.text;
+    g_rows[index].date = todo.date;
+    if (g_list)
+      update_todo_row_label(gtk_list_box_get_row_at_index(g_list, index), g_rows[index]);
+  }
+
+  static GtkWidget *create_todo_dialog(GtkWindow *parent, const TodoRow *existing_todo = nullptr)
+  {
+    auto *dialog = gtk_dialog_new_with_buttons(
+        existing_todo ? "Edit Todo" : "Add Todo",
+        parent,
+        GTK_DIALOG_MODAL,
+        "_Cancel", GTK_RESPONSE_CANCEL,
+        "_Save", GTK_RESPONSE_ACCEPT,
+        nullptr);
+
+    auto *content_area = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
+    gtk_container_set_border_width(GTK_CONTAINER(content_area), 10);
+
+    auto *entry = gtk_entry_new();
+    if (existing_todo)
+    {
+      gtk_entry_set_text(GTK_ENTRY(entry), existing_todo->text.c_str());
+    }
+    gtk_container_add(GTK_CONTAINER(content_area), entry);
+
+    auto *calendar = gtk_calendar_new();
+    if (existing_todo)
+    {
+      time_t unix_time = existing_todo->date / 1000;
+      struct tm *timeinfo = localtime(&unix_time);
+      gtk_calendar_select_month(GTK_CALENDAR(calendar), timeinfo->tm_mon, timeinfo->tm_year + 1900);
+      gtk_calendar_select_day(GTK_CALENDAR(calendar), timeinfo->tm_mday);
+    }
+    gtk_container_add(GTK_CONTAINER(content_area), calendar);
+
+    gtk_widget_show_all(dialog);
+    return dialog;
+  }
+
+  static void edit_action(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+  {
+    if (!g_list)
+      return;
+    auto *row = gtk_list_box_get_selected_row(g_list);
+    if (!row)
+      return;
+
+    gint index = gtk_list_box_row_get_index(row);
+    auto size = static_cast<gint>(g_rows.size());
+    if (index < 0 || index >= size)
+      return;
+
+    // The dialog runs a nested main loop that may apply store changes, so
+    // work on a copy of the row.
+    TodoRow current = g_rows[index];
+    auto *dialog = create_todo_dialog(g_window, &current);
+    // Closing the window destroys the dialog while it runs; the extra
+    // reference keeps it valid until it is released below.
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(dialog), TRUE);
+    g_object_ref(dialog);
+
+    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+    {
+      auto *entry = GTK_ENTRY(gtk_container_get_children(
+                                  GTK_CONTAINER(gtk_dialog_get_content_area(GTK_DIALOG(dialog))))
+                                  ->data);
+      auto *calendar = GTK_CALENDAR(gtk_container_get_children(
+                                        GTK_CONTAINER(gtk_dialog_get_content_area(GTK_DIALOG(dialog))))
+                                        ->next->data);
+
+      const char *new_text = gtk_entry_get_text(entry);
+
+      guint year, month, day;
+      gtk_calendar_get_date(calendar, &year, &month, &day);
+      GDateTime *datetime = g_date_time_new_local(year, month + 1, day, 0, 0, 0);
+      gint64 new_date = g_date_time_to_unix(datetime) * 1000;
+      g_date_time_unref(datetime);
+
+      // Only the mutation; the time spent in the dialog is the user's.
+      HandlerSpan span("gtk.edit_action");
+      g_host->update_todo(current.id, new_text, new_date);
+    }
+
+    gtk_widget_destroy(dialog);
+    g_object_unref(dialog);
+  }
+
+  static void delete_action(GSimpleAction *action, GVariant *parameter, gpointer user_data)
+  {
+    HandlerSpan span("gtk.delete_action");
+    if (!g_list)
+      return;
+    auto *row = gtk_list_box_get_selected_row(g_list);
+    if (!row)
+      return;
+
+    gint index = gtk_list_box_row_get_index(row);
+    auto size = static_cast<gint>(g_rows.size());
+    if (index < 0 || index >= size)
+      return;
+
+    g_host->delete_todo(g_rows[index].id);
+  }
+
+  static void on_add_clicked(GtkButton *button, gpointer user_data)
+  {
+    HandlerSpan span("gtk.on_add_clicked");
+    auto *builder = static_cast<GtkBuilder *>(user_data);
+    auto *entry = GTK_ENTRY(gtk_builder_get_object(builder, "todo_entry"));
+    auto *calendar = GTK_CALENDAR(gtk_builder_get_object(builder, "todo_calendar"));
+
+    const char *text = gtk_entry_get_text(entry);
+    if (strlen(text) > 0)
+    {
+      TodoRow todo;
+      todo.text = text;
+
+      guint year, month, day;
+      gtk_calendar_get_date(calendar, &year, &month, &day);
+      GDateTime *datetime = g_date_time_new_local(year, month + 1, day, 0, 0, 0);
+      todo.date = g_date_time_to_unix(datetime) * 1000;
+      g_date_time_unref(datetime);
+
+      g_host->add_todo(todo.text.c_str(), todo.date, todo.id);
+      gtk_entry_set_text(entry, "");
+    }
+  }
+
+  static void on_row_activated(GtkListBox *list_box, GtkListBoxRow *row, gpointer user_data)
+  {
+    GMenu *menu = g_menu_new();
+    g_menu_append(menu, "Edit", "app.edit");
+    g_menu_append(menu, "Delete", "app.delete");
+
+    auto *popover = gtk_popover_new_from_model(GTK_WIDGET(row), G_MENU_MODEL(menu));
+    gtk_popover_set_position(GTK_POPOVER(popover), GTK_POS_RIGHT);
+    gtk_popover_popup(GTK_POPOVER(popover));
+
+    g_object_unref(menu);
+  }
+
+  static void startup_handler(GtkApplication *app, gpointer user_data)
+  {
+    const GActionEntry app_actions[] = {
+        {"edit", edit_action, nullptr, nullptr, nullptr, {0, 0, 0}},
+        {"delete", delete_action, nullptr, nullptr, nullptr, {0, 0, 0}}};
+    g_action_map_add_action_entries(G_ACTION_MAP(app), app_actions,
+                                    G_N_ELEMENTS(app_actions), nullptr);
+  }
+
+  // Runs on every helloGui(). The application outlives its windows, so a
+  // reopen only has to build a window, not start GTK.
+  static void activate_handler(GtkApplication *app, gpointer user_data)
+  {
+    if (g_window)
+    {
+      gtk_window_present(g_window);
+      return;
+    }
+
+    auto *builder = gtk_builder_new();
+
+    gtk_builder_add_from_string(builder,
+                                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+                                "<interface>"
+                                "  <object class=\"GtkWindow\" id=\"window\">"
+                                "    <property name=\"title\">Todo List</property>"
+                                "    <property name=\"default-width\">400</property>"
+                                "    <property name=\"default-height\">500</property>"
+                                "    <child>"
+                                "      <object class=\"GtkBox\">"
+                                "        <property name=\"visible\">true</property>"
+                                "        <property name=\"orientation\">vertical</property>"
+                                "        <property name=\"spacing\">6</property>"
+                                "        <property name=\"margin\">12</property>"
+                                "        <child>"
+                                "          <object class=\"GtkBox\">"
+                                "            <property name=\"visible\">true</property>"
+                                "            <property name=\"spacing\">6</property>"
+                                "            <child>"
+                                "              <object class=\"GtkEntry\" id=\"todo_entry\">"
+                                "                <property name=\"visible\">true</property>"
+                                "                <property name=\"hexpand\">true</property>"
+                                "                <property name=\"placeholder-text\">Enter todo item...</property>"
+                                "              </object>"
+                                "            </child>"
+                                "            <child>"
+                                "              <object class=\"GtkCalendar\" id=\"todo_calendar\">"
+                                "                <property name=\"visible\">true</property>"
+                                "              </object>"
+                                "            </child>"
+                                "            <child>"
+                                "              <object class=\"GtkButton\" id=\"add_button\">"
+                                "                <property name=\"visible\">true</property>"
+                                "                <property name=\"label\">Add</property>"
+                                "              </object>"
+                                "            </child>"
+                                "          </object>"
+                                "        </child>"
+                                "        <child>"
+                                "          <object class=\"GtkScrolledWindow\">"
+                                "            <property name=\"visible\">true</property>"
+                                "            <property name=\"vexpand\">true</property>"
+                                "            <child>"
+                                "              <object class=\"GtkListBox\" id=\"todo_list\">"
+                                "                <property name=\"visible\">true</property>"
+                                "                <property name=\"selection-mode\">single</property>"
+                                "              </object>"
+                                "            </child>"
+                                "          </object>"
+                                "        </child>"
+                                "      </object>"
+                                "    </child>"
+                                "  </object>"
+                                "</interface>",
+                                -1, nullptr);
+
+    auto *window = GTK_WINDOW(gtk_builder_get_object(builder, "window"));
+    auto *button = GTK_BUTTON(gtk_builder_get_object(builder, "add_button"));
+    auto *list = GTK_LIST_BOX(gtk_builder_get_object(builder, "todo_list"));
+
+    gtk_window_set_application(window, app);
+
+    g_window = window;
+    g_list = list;
+    g_signal_connect(window, "destroy", G_CALLBACK(+[](GtkWidget *, gpointer builder)
+                                                   {
+      g_window = nullptr;
+      g_list = nullptr;
+      g_object_unref(builder); }),
+                     builder);
+
+    g_rows.clear();
+    g_host->for_each_todo([](void *, const unsigned char id[16], const char *text, int64_t date)
+                          {
+      TodoRow todo;
+      memcpy(todo.id, id, sizeof(uuid_t));
+      todo.text = text;
+      todo.date = date;
+      g_rows.push_back(todo);
+      append_row_widget(todo); },
+                          nullptr);
+
+    g_signal_connect(button, "clicked", G_CALLBACK(on_add_clicked), builder);
+    g_signal_connect(list, "row-activated", G_CALLBACK(on_row_activated), nullptr);
+
+    gtk_widget_show_all(GTK_WIDGET(window));
+  }
+
+  // Runs `fn` on the GTK thread and waits for it. Returns false if the
+  // thread is no longer taking tasks.
+  static bool run_on_gtk_thread(void (*fn)())
+  {
+    struct SyncTask
+    {
+      cpp_gui_task task; // must stay first
+      void (*fn)();
+      std::promise<void> done;
+    } sync;
+    sync.task.run = [](cpp_gui_task *task)
+    {
+      auto *sync = reinterpret_cast<SyncTask *>(task);
+      sync->fn();
+      sync->done.set_value();
+    };
+    sync.fn = fn;
+
+    std::future<void> done = sync.done.get_future();
+    if (!post_task(&sync.task))
+      return false;
+    done.wait();
+    return true;
+  }
+
+  static int hello_gui(const cpp_gui_host *host)
+  {
+    if (host == nullptr || host->abi_version != CPP_GUI_ABI_VERSION)
+    {
+      g_print("GTK front end ABI mismatch.\n");
+      return 1;
+    }
+
+    if (g_gtk_thread.joinable())
+    {
+      // Warm reopen: the application is still running without a window.
+      return run_on_gtk_thread([]()
+                               { g_application_activate(G_APPLICATION(g_app)); })
+                 ? 0
+                 : 1;
+    }
+
+    if (!g_gtk_main_context)
+    {
+      if (!gtk_init_check(0, nullptr))
+      {
+        g_print("Failed to initialize GTK.\n");
+        return 1;
+      }
+      // GtkApplication iterates the default context, so that is where GTK
+      // events and posted tasks are dispatched once the thread is running.
+      g_gtk_main_context = g_main_context_ref(g_main_context_default());
+    }
+
+    g_host = host;
+    {
+      std::lock_guard<std::mutex> lock(g_task_mutex);
+      g_task_source = g_source_new(&g_task_source_funcs, sizeof(GSource));
+      g_source_attach(g_task_source, g_gtk_main_context);
+    }
+
+    g_app = gtk_application_new("com.example.todo", G_APPLICATION_NON_UNIQUE);
+    g_signal_connect(g_app, "startup", G_CALLBACK(startup_handler), nullptr);
+    g_signal_connect(g_app, "activate", G_CALLBACK(activate_handler), nullptr);
+    // Keeps the application, and with it the thread, alive after the last
+    // window closes, until dispose_gui() releases it.
+    g_application_hold(G_APPLICATION(g_app));
+
+    g_gtk_thread = std::thread([]()
+                               {
+        pthread_setname_np(pthread_self(), "cpp-gtk");
+        g_application_run(G_APPLICATION(g_app), 0, nullptr);
+        g_object_unref(g_app);
+        g_app = nullptr;
+        stop_tasks(); });
+    return 0;
+  }
+
+  // Closes the window but keeps the GTK thread warm for the next open.
+  static void close_gui()
+  {
+    if (!g_gtk_thread.joinable())
+      return;
+
+    run_on_gtk_thread([]()
+                      {
+      if (g_window)
+        gtk_widget_destroy(GTK_WIDGET(g_window)); });
+  }
+
+  // Stops the application and joins the GTK thread. Tasks still queued run
+  // on the GTK thread before it exits; nothing is left behind but the
+  // default main context, which GTK keeps for the life of the process.
+  static void dispose_gui()
+  {
+    if (!g_gtk_thread.joinable())
+      return;
+
+    run_on_gtk_thread([]()
+                      {
+      if (g_window)
+        gtk_widget_destroy(GTK_WIDGET(g_window));
+      g_application_release(G_APPLICATION(g_app));
+      g_application_quit(G_APPLICATION(g_app)); });
+    g_gtk_thread.join();
+
+    std::vector<TodoRow>().swap(g_rows);
+    g_host = nullptr;
+  }
+
+} // namespace cpp_code
+
+extern "C" __attribute__((visibility("default"))) int cpp_gui_open(const cpp_gui_host *host)
+{
+  return cpp_code::hello_gui(host);
+}
+
+extern "C" __attribute__((visibility("default"))) void cpp_gui_close()
+{
+  cpp_code::close_gui();
+}
+
+extern "C" __attribute__((visibility("default"))) void cpp_gui_dispose()
+{
+  cpp_code::dispose_gui();
+}
+
+extern "C" __attribute__((visibility("default"))) int cpp_gui_post(cpp_gui_task *task)
+{
+  return cpp_code::post_task(task);
+}
+
+// Always queued, even on the GTK thread, so rows see changes in store order.
+extern "C" __attribute__((visibility("default"))) void cpp_gui_todo_changed(
+    int change, const unsigned char id[16], const char *text, int64_t date)
+{
+  auto *pending = new cpp_code::TodoChangeTask();
+  pending->task.run = [](cpp_gui_task *task)
+  {
+    auto *pending = reinterpret_cast<cpp_code::TodoChangeTask *>(task);
+    cpp_code::apply_todo_change(pending->change, pending->todo);
+    delete pending;
+  };
+  pending->change = change;
+  memcpy(pending->todo.id, id, sizeof(uuid_t));
+  pending->todo.text = text;
+  pending->todo.date = date;
+  if (!cpp_code::post_task(&pending->task))
+    delete pending;
+}
@@ -0,0 +1,73 @@
+#include "js_executor.h"
+
+namespace cpp_code
+{
+
+  JsExecutor::JsExecutor(Napi::Env env)
+      : env_(env), context_(env, "CppCoroutine"), async_(new uv_async_t)
+  {
+    uv_loop_t *loop = nullptr;
+    napi_get_uv_event_loop(env, &loop);
+    uv_async_init(loop, async_, on_async);
+    async_->data = this;
+    uv_unref(reinterpret_cast<uv_handle_t *>(async_));
+  }
+
+  JsExecutor::~JsExecutor()
+  {
+    async_->data = nullptr;
+    uv_close(reinterpret_cast<uv_handle_t *>(async_), [](uv_handle_t *handle)
+             { delete reinterpret_cast<uv_async_t *>(handle); });
+  }
+
+  void JsExecutor::hold()
+  {
+    if (held_++ == 0)
+      uv_ref(reinterpret_cast<uv_handle_t *>(async_));
+  }
+
+  void JsExecutor::release()
+  {
+    if (--held_ == 0)
+      uv_unref(reinterpret_cast<uv_handle_t *>(async_));
+  }
+
+  void JsExecutor::post(Awaiter *awaiter)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      awaiter->next_ = nullptr;
+      if (tail_)
+        tail_->next_ = awaiter;
+      else
+        head_ = awaiter;
+      tail_ = awaiter;
+    }
+    uv_async_send(async_);
+  }
+
+  void JsExecutor::on_async(uv_async_t *async)
+  {
+    auto *self = static_cast<JsExecutor *>(async->data);
+    if (!self)
+      return;
+
+    Awaiter *awaiter;
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      awaiter = self->head_;
+      self->head_ = self->tail_ = nullptr;
+    }
+
+    Napi::HandleScope scope(self->env_);
+    Napi::CallbackScope callback_scope(self->env_, self->context_);
+    while (awaiter)
+    {
+      // Resuming may finish the coroutine and free the awaiter.
+      Awaiter *next = awaiter->next_;
+      awaiter->handle_.resume();
+      awaiter = next;
+    }
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,38 @@
+#include "json_escape.h"
+
+namespace cpp_code
+{
+
+  void append_json_escaped(std::string &out, std::string_view text)
+  {
+    static const char kHex[] = "0123456789abcdef";
+    for (char c : text)
+    {
+      unsigned char byte = static_cast<unsigned char>(c);
+      if (c == '"' || c == '\\')
+      {
+        out.push_back('\\');
+        out.push_back(c);
+      }
+      else if (c == '\n')
+      {
+        out += "\\n";
+      }
+      else if (c == '\t')
+      {
+        out += "\\t";
+      }
+      else if (byte < 0x20)
+      {
+        out += "\\u00";
+        out.push_back(kHex[byte >> 4]);
+        out.push_back(kHex[byte & 0xf]);
+      }
+      else
+      {
+        out.push_back(c);
+      }
+    }
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,200 @@
+#include "lz_codec.h"
+#include <cstring>
+#include <vector>
+
+namespace cpp_code
+{
+  namespace lz
+  {
+
+    namespace
+    {
+      constexpr size_t kMinMatch = 4;
+      constexpr int kHashBits = 14;
+
+      inline uint32_t read32(const uint8_t *p)
+      {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+      }
+
+      inline uint32_t hash(uint32_t sequence)
+      {
+        return (sequence * 2654435761u) >> (32 - kHashBits);
+      }
+
+      uint8_t *write_length(uint8_t *out, size_t length)
+      {
+        while (length >= 255)
+        {
+          *out++ = 255;
+          length -= 255;
+        }
+        *out++ = static_cast<uint8_t>(length);
+        return out;
+      }
+
+      uint8_t *write_sequence(uint8_t *out, const uint8_t *literals, size_t literal_length,
+                              size_t offset, size_t match_length)
+      {
+        uint8_t *token = out++;
+        size_t match_code = match_length ? match_length - kMinMatch : 0;
+        *token = static_cast<uint8_t>((literal_length < 15 ? literal_length : 15) << 4 |
+                                      (match_code < 15 ? match_code : 15));
+        if (literal_length >= 15)
+          out = write_length(out, literal_length - 15);
+        if (literal_length)
+          memcpy(out, literals, literal_length);
+        out += literal_length;
+
+        if (match_length)
+        {
+          *out++ = static_cast<uint8_t>(offset);
+          *out++ = static_cast<uint8_t>(offset >> 8);
+          if (match_code >= 15)
+            out = write_length(out, match_code - 15);
+        }
+        return out;
+      }
+
+      bool read_length(const uint8_t *&in, const uint8_t *end, size_t &length)
+      {
+        uint8_t byte;
+        do
+        {
+          if (in >= end)
+            return false;
+          byte = *in++;
+          length += byte;
+        } while (byte == 255);
+        return true;
+      }
+    }
+
+    size_t compress_bound(size_t size)
+    {
+      return size + size / 255 + 16;
+    }
+
+    size_t compress(const uint8_t *dict, size_t dict_size, const uint8_t *input, size_t size,
+                    uint8_t *output)
+    {
+      if (dict_size > kMaxOffset)
+      {
+        dict += dict_size - kMaxOffset;
+        dict_size = kMaxOffset;
+      }
+
+      // Matching runs over one window of dictionary + input so that matches
+      // may start in the dictionary and run into the input.
+      std::vector<uint8_t> window(dict_size + size);
+      if (dict_size)
+        memcpy(window.data(), dict, dict_size);
+      if (size)
+        memcpy(window.data() + dict_size, input, size);
+      const uint8_t *base = window.data();
+      const size_t end = window.size();
+
+      std::vector<uint32_t> table(size_t(1) << kHashBits, UINT32_MAX);
+      for (size_t pos = 0; pos + kMinMatch <= dict_size; ++pos)
+      {
+        table[hash(read32(base + pos))] = static_cast<uint32_t>(pos);
+      }
+
+      uint8_t *out = output;
+      size_t anchor = dict_size;
+      size_t pos = dict_size;
+      while (pos + kMinMatch <= end)
+      {
+        uint32_t sequence = read32(base + pos);
+        uint32_t &slot = table[hash(sequence)];
+        size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos);
+
+        if (candidate == UINT32_MAX || pos - candidate > kMaxOffset || read32(base + candidate) != sequence)
+        {
+          ++pos;
+          continue;
+        }
+
+        size_t length = kMinMatch;
+        while (pos + length < end && base[candidate + length] == base[pos + length])
+          ++length;
+
+        out = write_sequence(out, base + anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+      }
+
+      // The final sequence carries only literals; the decoder recognizes it
+      // by running out of input right after them.
+      out = write_sequence(out, base + anchor, end - anchor, 0, 0);
+      return static_cast<size_t>(out - output);
+    }
+
+    bool decompress(const uint8_t *dict, size_t dict_size, const uint8_t *input, size_t size,
+                    uint8_t *output, size_t output_size)
+    {
+      if (dict_size > kMaxOffset)
+      {
+        dict += dict_size - kMaxOffset;
+        dict_size = kMaxOffset;
+      }
+
+      const uint8_t *in = input;
+      const uint8_t *in_end = input + size;
+      size_t produced = 0;
+
+      while (in < in_end)
+      {
+        uint8_t token = *in++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !read_length(in, in_end, literal_length))
+          return false;
+        if (literal_length > static_cast<size_t>(in_end - in) || literal_length > output_size - produced)
+          return false;
+        if (literal_length)
+          memcpy(output + produced, in, literal_length);
+        in += literal_length;
+        produced += literal_length;
+
+        if (in == in_end)
+          break;
+
+        if (in_end - in < 2)
+          return false;
+        size_t offset = in[0] | (size_t(in[1]) << 8);
+        in += 2;
+        size_t match_length = token & 15;
+        if (match_length == 15 && !read_length(in, in_end, match_length))
+          return false;
+        match_length += kMinMatch;
+
+        if (offset == 0 || offset > produced + dict_size || match_length > output_size - produced)
+          return false;
+
+        if (offset <= produced && offset >= match_length)
+        {
+          memcpy(output + produced, output + produced - offset, match_length);
+          produced += match_length;
+          continue;
+        }
+
+        // Byte by byte: the source starts in the dictionary or overlaps the
+        // bytes being written.
+        for (size_t i = 0; i < match_length; ++i)
+        {
+          output[produced] = offset > produced
+                                 ? dict[dict_size - (offset - produced)]
+                                 : output[produced - offset];
+          ++produced;
+        }
+      }
+
+      return produced == output_size;
+    }
+
+  } // namespace lz
+} // namespace cpp_code
@@ -0,0 +1,105 @@
+#include "memory_accounting.h"
+#include <atomic>
+#include <mutex>
+
+namespace cpp_code
+{
+  namespace memory
+  {
+
+    namespace
+    {
+      std::atomic<int64_t> g_bytes[kComponents];
+      std::atomic<int64_t> g_unreported{0};
+      std::atomic<bool> g_report_requested{false};
+
+      std::atomic<int64_t> g_soft_limit{0};
+      std::atomic<bool> g_over_limit{false};
+
+      // Each held while its callback runs, so replacing one waits for it.
+      // They are separate so that one callback may allocate without
+      // deadlocking if that trips the other.
+      std::mutex g_report_mutex;
+      std::function<void()> g_report_callback;
+      std::mutex g_limit_mutex;
+      std::function<void()> g_limit_callback;
+
+      void invoke(std::mutex &mutex, const std::function<void()> &callback)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (callback)
+          callback();
+      }
+    }
+
+    void add(Component component, int64_t bytes)
+    {
+      g_bytes[static_cast<int>(component)].fetch_add(bytes, std::memory_order_relaxed);
+      int64_t unreported = g_unreported.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+      if ((unreported >= kReportBytes || unreported <= -kReportBytes) &&
+          !g_report_requested.exchange(true, std::memory_order_relaxed))
+        invoke(g_report_mutex, g_report_callback);
+
+      int64_t limit = g_soft_limit.load(std::memory_order_relaxed);
+      if (limit <= 0)
+        return;
+      if (bytes > 0 && !g_over_limit.load(std::memory_order_relaxed))
+      {
+        if (usage().total() > limit && !g_over_limit.exchange(true, std::memory_order_relaxed))
+          invoke(g_limit_mutex, g_limit_callback);
+      }
+      else if (bytes < 0 && g_over_limit.load(std::memory_order_relaxed))
+      {
+        if (usage().total() < limit / 10 * 9)
+          g_over_limit.store(false, std::memory_order_relaxed);
+      }
+    }
+
+    int64_t Usage::total() const
+    {
+      int64_t sum = 0;
+      for (int64_t component : bytes)
+        sum += component;
+      return sum;
+    }
+
+    Usage usage()
+    {
+      Usage result;
+      for (int i = 0; i < kComponents; ++i)
+        result.bytes[i] = g_bytes[i].load(std::memory_order_relaxed);
+      return result;
+    }
+
+    int64_t take_unreported(int64_t min_bytes)
+    {
+      int64_t pending = g_unreported.load(std::memory_order_relaxed);
+      if (pending == 0 || (pending < min_bytes && -pending < min_bytes))
+        return 0;
+      pending = g_unreported.exchange(0, std::memory_order_relaxed);
+      g_report_requested.store(false, std::memory_order_relaxed);
+      return pending;
+    }
+
+    void set_report_callback(std::function<void()> callback)
+    {
+      std::lock_guard<std::mutex> lock(g_report_mutex);
+      g_report_callback = std::move(callback);
+    }
+
+    void set_soft_limit(int64_t bytes, std::function<void()> on_exceeded)
+    {
+      std::lock_guard<std::mutex> lock(g_limit_mutex);
+      g_limit_callback = std::move(on_exceeded);
+      g_over_limit.store(false, std::memory_order_relaxed);
+      g_soft_limit.store(bytes, std::memory_order_relaxed);
+    }
+
+    int64_t soft_limit()
+    {
+      return g_soft_limit.load(std::memory_order_relaxed);
+    }
+
+  } // namespace memory
+} // namespace cpp_code
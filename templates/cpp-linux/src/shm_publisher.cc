@@ -0,0 +1,280 @@
+#include "shm_publisher.h"
+#include "shm_todo_view.h"
+#include "todo_cold.h"
+#include "todo_query.h"
+#include "todo_store.h"
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    // Creates the segment readable by this user only. A segment left behind
+    // by a publisher of the same user that did not stop is replaced; one of
+    // another user is never opened for writing.
+    int create_segment(const std::string &name)
+    {
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd >= 0 || errno != EEXIST)
+        return fd;
+
+      int stale = shm_open(name.c_str(), O_RDONLY, 0);
+      if (stale < 0)
+        return stale;
+      struct stat info;
+      int stat_result = fstat(stale, &info);
+      int stat_error = errno;
+      close(stale);
+      if (stat_result != 0)
+      {
+        errno = stat_error;
+        return -1;
+      }
+      if (info.st_uid != geteuid())
+      {
+        errno = EEXIST;
+        return -1;
+      }
+
+      shm_unlink(name.c_str());
+      return shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+
+    class ShmPublisher
+    {
+    public:
+      ShmPublisher(const std::string &name, size_t buffer_capacity)
+          : name_(name)
+      {
+        if (buffer_capacity < sizeof(shm::BufferHeader))
+        {
+          throw std::runtime_error("Shared memory capacity is too small");
+        }
+        // Entries address their text with 32-bit offsets.
+        if (buffer_capacity > UINT32_MAX)
+        {
+          throw std::runtime_error("Shared memory capacity is too large");
+        }
+
+        int fd = create_segment(name);
+        if (fd < 0)
+        {
+          throw std::runtime_error("shm_open failed for " + name + ": " + strerror(errno));
+        }
+
+        size_ = shm::segment_size(buffer_capacity);
+        if (ftruncate(fd, static_cast<off_t>(size_)) != 0)
+        {
+          int error = errno;
+          close(fd);
+          shm_unlink(name.c_str());
+          throw std::runtime_error(std::string("ftruncate failed: ") + strerror(error));
+        }
+
+        void *base = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+          shm_unlink(name.c_str());
+          throw std::runtime_error(std::string("mmap failed: ") + strerror(errno));
+        }
+
+        base_ = static_cast<char *>(base);
+        header_ = new (base_) shm::SegmentHeader();
+        header_->magic = shm::kMagic;
+        header_->layout_version = shm::kLayoutVersion;
+        header_->buffer_capacity = buffer_capacity;
+        header_->buffer_offsets[0] = size_ - 2 * buffer_capacity;
+        header_->buffer_offsets[1] = size_ - buffer_capacity;
+        header_->active.store(0, std::memory_order_relaxed);
+        header_->published.store(0, std::memory_order_relaxed);
+        header_->overflow_bytes.store(0, std::memory_order_relaxed);
+        for (auto offset : header_->buffer_offsets)
+        {
+          new (base_ + offset) shm::BufferHeader();
+        }
+
+        observer_ = add_todo_observer([this](TodoChange, const TodoItem &)
+                                      { mark_dirty(); });
+        thread_ = std::thread([this]()
+                              { run(); });
+      }
+
+      ~ShmPublisher()
+      {
+        remove_todo_observer(observer_);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+
+        munmap(base_, size_);
+        shm_unlink(name_.c_str());
+      }
+
+    private:
+      void mark_dirty()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          dirty_ = true;
+        }
+        cv_.notify_one();
+      }
+
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_)
+        {
+          dirty_ = false;
+          lock.unlock();
+          // The cold tier is only decoded when it changed since the active
+          // buffer was written; otherwise its frozen rows are reused.
+          std::shared_ptr<const TodoColumns> hot;
+          std::vector<TodoItem> frozen;
+          uint64_t cold_version = active_cold_;
+          bool cold_changed = read_changed_tiers(cold_version, [&]()
+                                                 { hot = todo_columns(); },
+                                                 [&]()
+                                                 {
+            frozen.clear();
+            scan_cold_todos(INT64_MIN, INT64_MAX, [&](const TodoItem &todo)
+                            { frozen.push_back(todo); }); });
+          publish(*hot, cold_changed ? &frozen : nullptr, cold_version);
+          lock.lock();
+          cv_.wait(lock, [this]()
+                   { return dirty_ || stopping_; });
+        }
+      }
+
+      // The hot rows, then the frozen todos: `frozen`, or if null those of
+      // the active buffer, which are still current.
+      void publish(const TodoColumns &columns, const std::vector<TodoItem> *frozen, uint64_t cold_version)
+      {
+        uint32_t active = header_->active.load(std::memory_order_relaxed) & 1;
+        auto *previous = reinterpret_cast<const shm::BufferHeader *>(base_ + header_->buffer_offsets[active]);
+        const size_t hot = columns.size();
+        size_t frozen_count = previous->count - active_hot_;
+        size_t frozen_text = previous->text_bytes - active_hot_text_;
+        if (frozen)
+        {
+          frozen_count = frozen->size();
+          frozen_text = 0;
+          for (const TodoItem &todo : *frozen)
+            frozen_text += todo.text.size();
+        }
+        const size_t count = hot + frozen_count;
+        const size_t text_bytes = columns.text.size() + frozen_text;
+        const size_t needed = sizeof(shm::BufferHeader) + count * sizeof(shm::Entry) + text_bytes;
+        if (needed > header_->buffer_capacity)
+        {
+          header_->overflow_bytes.store(needed, std::memory_order_release);
+          return;
+        }
+
+        uint32_t target = active ^ 1;
+        auto *buffer = reinterpret_cast<shm::BufferHeader *>(base_ + header_->buffer_offsets[target]);
+        uint64_t sequence = buffer->sequence.load(std::memory_order_relaxed);
+
+        buffer->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        auto *entries = reinterpret_cast<shm::Entry *>(buffer + 1);
+        for (size_t i = 0; i < hot; ++i)
+        {
+          memcpy(entries[i].id, &columns.ids[i * sizeof(entries[i].id)], sizeof(entries[i].id));
+          entries[i].date = columns.dates[i];
+          entries[i].text_offset = static_cast<uint32_t>(columns.text_offsets[i]);
+          entries[i].text_length = static_cast<uint32_t>(columns.text_offsets[i + 1] - columns.text_offsets[i]);
+        }
+        char *text = reinterpret_cast<char *>(entries + count);
+        memcpy(text, columns.text.data(), columns.text.size());
+        const size_t base = columns.text.size();
+        if (frozen)
+        {
+          size_t offset = base;
+          for (size_t i = 0; i < frozen_count; ++i)
+          {
+            const TodoItem &todo = (*frozen)[i];
+            shm::Entry &entry = entries[hot + i];
+            memcpy(entry.id, todo.id, sizeof(entry.id));
+            entry.date = todo.date;
+            entry.text_offset = static_cast<uint32_t>(offset);
+            entry.text_length = static_cast<uint32_t>(todo.text.size());
+            memcpy(text + offset, todo.text.data(), todo.text.size());
+            offset += todo.text.size();
+          }
+        }
+        else
+        {
+          auto *source = reinterpret_cast<const shm::Entry *>(previous + 1);
+          const char *source_text = reinterpret_cast<const char *>(source + previous->count);
+          for (size_t i = 0; i < frozen_count; ++i)
+          {
+            entries[hot + i] = source[active_hot_ + i];
+            entries[hot + i].text_offset = static_cast<uint32_t>(entries[hot + i].text_offset - active_hot_text_ + base);
+          }
+          memcpy(text + base, source_text + active_hot_text_, frozen_text);
+        }
+        buffer->store_version = columns.version;
+        buffer->count = count;
+        buffer->text_bytes = text_bytes;
+
+        buffer->sequence.store(sequence + 2, std::memory_order_release);
+        header_->active.store(target, std::memory_order_release);
+        header_->published.store(1, std::memory_order_release);
+        header_->overflow_bytes.store(0, std::memory_order_release);
+        active_cold_ = cold_version;
+        active_hot_ = hot;
+        active_hot_text_ = columns.text.size();
+      }
+
+      std::string name_;
+      char *base_ = nullptr;
+      size_t size_ = 0;
+      shm::SegmentHeader *header_ = nullptr;
+      int observer_ = 0;
+
+      // What the active buffer holds: the cold tier version its frozen rows
+      // come from (~0 before the first publication), and the number and
+      // text bytes of the hot rows in front of them.
+      uint64_t active_cold_ = ~uint64_t(0);
+      size_t active_hot_ = 0;
+      size_t active_hot_text_ = 0;
+
+      std::mutex mutex_;
+      std::condition_variable cv_;
+      bool dirty_ = false;
+      bool stopping_ = false;
+      std::thread thread_;
+    };
+
+    std::mutex g_publisher_mutex;
+    std::unique_ptr<ShmPublisher> g_publisher;
+  }
+
+  void start_shm_publisher(const std::string &name, size_t buffer_capacity)
+  {
+    std::lock_guard<std::mutex> lock(g_publisher_mutex);
+    g_publisher.reset();
+    g_publisher = std::make_unique<ShmPublisher>(name, buffer_capacity);
+  }
+
+  void stop_shm_publisher()
+  {
+    std::lock_guard<std::mutex> lock(g_publisher_mutex);
+    g_publisher.reset();
+  }
+
+} // namespace cpp_code
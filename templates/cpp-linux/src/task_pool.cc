@@ -0,0 +1,229 @@
+#include "task_pool.h"
+#include <pthread.h>
+#include <exception>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    // Index of the worker running on this thread, or -1 for threads that do
+    // not belong to a pool (the JS thread, the GTK thread, ...).
+    thread_local int t_worker_index = -1;
+    thread_local const TaskPool *t_worker_pool = nullptr;
+  }
+
+  TaskPool &TaskPool::shared()
+  {
+    static TaskPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+  }
+
+  TaskPool::TaskPool(unsigned workers)
+  {
+    workers = std::max(1u, workers);
+    for (unsigned i = 0; i < workers; ++i)
+    {
+      workers_.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned i = 0; i < workers; ++i)
+    {
+      workers_[i]->thread = std::thread([this, i]()
+                                        {
+        // Shown by debuggers and in traces.
+        pthread_setname_np(pthread_self(), "cpp-pool");
+        run_worker(i); });
+    }
+  }
+
+  TaskPool::~TaskPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+      stopping_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto &worker : workers_)
+    {
+      worker->thread.join();
+    }
+  }
+
+  void TaskPool::submit(Task task)
+  {
+    // Workers push onto their own deque; everyone else spreads new work
+    // round-robin so it can be stolen from there.
+    unsigned target = t_worker_pool == this
+                          ? static_cast<unsigned>(t_worker_index)
+                          : next_queue_.fetch_add(1, std::memory_order_relaxed) % size();
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(workers_[target]->mutex);
+      workers_[target]->tasks.push_back(std::move(task));
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+  }
+
+  std::vector<TaskPool::WorkerStats> TaskPool::stats() const
+  {
+    std::vector<WorkerStats> result;
+    result.reserve(workers_.size());
+    for (auto &worker : workers_)
+    {
+      result.push_back({worker->executed.load(std::memory_order_relaxed),
+                        worker->stolen.load(std::memory_order_relaxed)});
+    }
+    return result;
+  }
+
+  bool TaskPool::try_run_one(int self)
+  {
+    Task task;
+    bool stolen = false;
+    const unsigned count = size();
+
+    if (self >= 0)
+    {
+      auto &own = *workers_[self];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty())
+      {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+      }
+    }
+
+    if (!task)
+    {
+      unsigned start = self >= 0 ? static_cast<unsigned>(self) + 1
+                                 : next_queue_.load(std::memory_order_relaxed);
+      for (unsigned i = 0; i < count && !task; ++i)
+      {
+        unsigned victim = (start + i) % count;
+        if (static_cast<int>(victim) == self)
+          continue;
+
+        auto &other = *workers_[victim];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.tasks.empty())
+        {
+          task = std::move(other.tasks.front());
+          other.tasks.pop_front();
+          stolen = true;
+        }
+      }
+    }
+
+    if (!task)
+      return false;
+
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+    task();
+
+    if (self >= 0)
+    {
+      workers_[self]->executed.fetch_add(1, std::memory_order_relaxed);
+      if (stolen)
+        workers_[self]->stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  void TaskPool::run_worker(unsigned index)
+  {
+    t_worker_index = static_cast<int>(index);
+    t_worker_pool = this;
+
+    while (true)
+    {
+      if (try_run_one(static_cast<int>(index)))
+        continue;
+
+      std::unique_lock<std::mutex> lock(sleep_mutex_);
+      sleep_cv_.wait(lock, [this]()
+                     { return stopping_ || pending_.load(std::memory_order_acquire) > 0; });
+      if (stopping_ && pending_.load(std::memory_order_acquire) == 0)
+        return;
+    }
+  }
+
+  void TaskPool::parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)> &body)
+  {
+    if (n == 0)
+      return;
+
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (n + grain - 1) / grain;
+    if (chunks == 1)
+    {
+      body(0, n);
+      return;
+    }
+
+    // Chunks are claimed from a shared counter by the calling thread and by
+    // helper tasks queued on the pool. The caller only ever runs chunks of
+    // this call, never unrelated tasks, so it cannot re-enter code that
+    // needs the locks it holds; once none are left to claim it sleeps until
+    // the claimed ones finish. Helpers that start late find nothing to claim
+    // and return, which is why the state is shared rather than on the stack.
+    // The first exception thrown by any chunk is rethrown here.
+    struct State
+    {
+      const std::function<void(size_t, size_t)> *body;
+      size_t n, grain, chunks;
+      std::atomic<size_t> next{0};
+      std::mutex mutex;
+      std::condition_variable done_cv;
+      size_t done = 0;
+      std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->body = &body;
+    state->n = n;
+    state->grain = grain;
+    state->chunks = chunks;
+
+    auto run_chunks = [](State &state)
+    {
+      size_t c;
+      while ((c = state.next.fetch_add(1, std::memory_order_relaxed)) < state.chunks)
+      {
+        std::exception_ptr error;
+        try
+        {
+          (*state.body)(c * state.grain, std::min(state.n, (c + 1) * state.grain));
+        }
+        catch (...)
+        {
+          error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (error && !state.error)
+          state.error = error;
+        if (++state.done == state.chunks)
+          state.done_cv.notify_all();
+      }
+    };
+
+    size_t helpers = std::min<size_t>(chunks - 1, size());
+    for (size_t h = 0; h < helpers; ++h)
+    {
+      submit([state, run_chunks]()
+             { run_chunks(*state); });
+    }
+
+    run_chunks(*state);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done_cv.wait(lock, [&]()
+                        { return state->done == chunks; });
+
+    if (state->error)
+      std::rethrow_exception(state->error);
+  }
+
+} // namespace cpp_code
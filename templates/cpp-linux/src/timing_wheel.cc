@@ -0,0 +1,144 @@
+#include "timing_wheel.h"
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    constexpr uint64_t kSlotMask = TimingWheel::kSlots - 1;
+    constexpr uint64_t kWheelSpan = uint64_t(1) << (TimingWheel::kSlotBits * TimingWheel::kLevels);
+  }
+
+  TimingWheel::TimingWheel(uint64_t now)
+      : now_(now)
+  {
+    for (auto &level : slots_)
+    {
+      for (auto &head : level)
+      {
+        head.prev = head.next = &head;
+      }
+    }
+    overflow_.prev = overflow_.next = &overflow_;
+  }
+
+  void TimingWheel::link(Timer *head, Timer *timer)
+  {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+  }
+
+  void TimingWheel::unlink(Timer *timer)
+  {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = timer->next = nullptr;
+  }
+
+  void TimingWheel::place(Timer *timer, uint64_t earliest)
+  {
+    uint64_t expires = timer->expires > earliest ? timer->expires : earliest;
+    uint64_t delta = expires - now_;
+
+    if (delta >= kWheelSpan)
+    {
+      link(&overflow_, timer);
+      return;
+    }
+
+    int level = 0;
+    while (delta >= (uint64_t(1) << (kSlotBits * (level + 1))))
+    {
+      ++level;
+    }
+    link(&slots_[level][(expires >> (kSlotBits * level)) & kSlotMask], timer);
+  }
+
+  void TimingWheel::schedule(Timer *timer, uint64_t expires)
+  {
+    if (timer->scheduled())
+    {
+      unlink(timer);
+    }
+    else
+    {
+      ++size_;
+    }
+    timer->expires = expires;
+    // Anything already due fires on the next tick.
+    place(timer, now_ + 1);
+  }
+
+  void TimingWheel::cancel(Timer *timer)
+  {
+    if (timer->scheduled())
+    {
+      unlink(timer);
+      --size_;
+    }
+  }
+
+  // Runs after now_ has moved to the new tick but before its level-0 slot
+  // is collected, so a timer due on this very tick lands in that slot.
+  void TimingWheel::cascade(int level)
+  {
+    Timer *head = &slots_[level][(now_ >> (kSlotBits * level)) & kSlotMask];
+    while (head->next != head)
+    {
+      Timer *timer = head->next;
+      unlink(timer);
+      place(timer, now_);
+    }
+
+    if (level == kLevels - 1)
+    {
+      Timer pending;
+      pending.prev = pending.next = &pending;
+      while (overflow_.next != &overflow_)
+      {
+        Timer *timer = overflow_.next;
+        unlink(timer);
+        link(&pending, timer);
+      }
+      while (pending.next != &pending)
+      {
+        Timer *timer = pending.next;
+        unlink(timer);
+        place(timer, now_);
+      }
+    }
+  }
+
+  void TimingWheel::advance(uint64_t now, std::vector<Timer *> &due)
+  {
+    while (now_ < now)
+    {
+      // Skip whole empty stretches instead of stepping tick by tick.
+      if (size_ == 0)
+      {
+        now_ = now;
+        return;
+      }
+
+      ++now_;
+      for (int level = 1; level < kLevels; ++level)
+      {
+        if ((now_ >> (kSlotBits * (level - 1))) & kSlotMask)
+          break;
+        cascade(level);
+      }
+
+      Timer *head = &slots_[0][now_ & kSlotMask];
+      while (head->next != head)
+      {
+        Timer *timer = head->next;
+        unlink(timer);
+        --size_;
+        due.push_back(timer);
+      }
+    }
+  }
+
+} // namespace cpp_code
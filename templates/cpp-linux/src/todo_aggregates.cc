@@ -0,0 +1,376 @@
+#include "todo_aggregates.h"
+#include "cpp_code.h"
+#include "memory_accounting.h"
+#include "task_pool.h"
+#include "todo_cold.h"
+#include "todo_store.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <ext/pb_ds/assoc_container.hpp>
+#include <ext/pb_ds/tree_policy.hpp>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    constexpr size_t kInitialDays = 1024;
+    // About 5,700 years.
+    constexpr size_t kMaxDays = size_t(1) << 21;
+
+    // Node of an unordered container: the entry plus the bucket chain pointer.
+    constexpr int64_t kNodeBytes = 2 * sizeof(void *);
+
+    // Times of day within one day, ordered by time and then by a serial
+    // that keeps equal times distinct. Each node also counts its subtree, so
+    // inserts, erases and "how many before" are all O(log k).
+    using TimeKey = std::pair<int32_t, uint64_t>;
+    using DayTimes = __gnu_pbds::tree<TimeKey, __gnu_pbds::null_type, std::less<TimeKey>, __gnu_pbds::rb_tree_tag,
+                                      __gnu_pbds::tree_order_statistics_node_update>;
+    // A red-black node: key, three links, colour and subtree size.
+    constexpr int64_t kTimeNodeBytes = sizeof(TimeKey) + 4 * sizeof(void *) + sizeof(size_t);
+
+    using TodoId = std::array<unsigned char, sizeof(uuid_t)>;
+
+    // Ids are random, so their first eight bytes are a good hash.
+    struct TodoIdHash
+    {
+      size_t operator()(const TodoId &id) const
+      {
+        uint64_t hash;
+        memcpy(&hash, id.data(), sizeof(hash));
+        return static_cast<size_t>(hash);
+      }
+    };
+
+    TodoId to_key(const uuid_t id)
+    {
+      TodoId key;
+      memcpy(key.data(), id, key.size());
+      return key;
+    }
+
+    int64_t now_ms()
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+
+    int64_t day_of(int64_t date) { return date >= 0 ? date / kDayMs : -((-(date + 1)) / kDayMs) - 1; }
+    int32_t time_of_day(int64_t date) { return static_cast<int32_t>(date - day_of(date) * kDayMs); }
+
+    // Todos per day over a window of days that doubles, rebuilt in linear
+    // time, whenever a date falls outside it.
+    class DayTree
+    {
+    public:
+      size_t capacity() const { return counts_.capacity() + tree_.capacity(); }
+
+      void add(int64_t day, int64_t delta)
+      {
+        cover(day);
+        size_t slot = slot_of(day);
+        counts_[slot] += delta;
+        for (size_t i = slot + 1; i < tree_.size(); i += i & (~i + 1))
+          tree_[i] += delta;
+      }
+
+      // Todos dated on days before `day`.
+      int64_t before(int64_t day) const
+      {
+        if (counts_.empty() || day <= base_)
+          return 0;
+        size_t end = static_cast<size_t>(std::min<int64_t>(day - base_, counts_.size()));
+        int64_t sum = 0;
+        for (size_t i = end; i > 0; i -= i & (~i + 1))
+          sum += tree_[i];
+        return sum;
+      }
+
+    private:
+      void cover(int64_t day)
+      {
+        if (counts_.empty())
+        {
+          rebuild(day - static_cast<int64_t>(kInitialDays / 2), kInitialDays);
+          return;
+        }
+        while ((day < base_ || day >= base_ + static_cast<int64_t>(counts_.size())) && counts_.size() < kMaxDays)
+        {
+          int64_t size = static_cast<int64_t>(counts_.size());
+          rebuild(day < base_ ? base_ - size : base_, counts_.size() * 2);
+        }
+      }
+
+      size_t slot_of(int64_t day) const
+      {
+        return static_cast<size_t>(std::clamp<int64_t>(day - base_, 0, counts_.size() - 1));
+      }
+
+      void rebuild(int64_t base, size_t size)
+      {
+        std::vector<int64_t> counts(size);
+        for (size_t i = 0; i < counts_.size(); ++i)
+          counts[static_cast<size_t>(std::clamp<int64_t>(base_ + static_cast<int64_t>(i) - base, 0, size - 1))] += counts_[i];
+        counts_ = std::move(counts);
+        base_ = base;
+
+        tree_.assign(size + 1, 0);
+        for (size_t i = 1; i <= size; ++i)
+        {
+          tree_[i] += counts_[i - 1];
+          size_t parent = i + (i & (~i + 1));
+          if (parent <= size)
+            tree_[parent] += tree_[i];
+        }
+      }
+
+      int64_t base_ = 0;             // day of slot 0
+      std::vector<int64_t> counts_;  // per slot
+      std::vector<int64_t> tree_;    // Fenwick tree over counts_, 1-based
+    };
+
+    class Aggregator
+    {
+    public:
+      // Register before loading so no mutation can slip between the two;
+      // loading skips todos the observer has already seen.
+      Aggregator()
+      {
+        add_todo_observer([this](TodoChange change, const TodoItem &todo)
+                          { on_change(change, todo); });
+        std::shared_ptr<const TodoSnapshot> snapshot = pin_todos();
+        snapshot->for_each([this](const TodoItem &todo)
+                           { load(todo); });
+        snapshot.reset();
+        scan_cold_todos(INT64_MIN, INT64_MAX, [this](const TodoItem &todo)
+                        { load(todo); });
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        loading_ = false;
+        seen_ = {};
+        account();
+      }
+
+      TodoAggregateReport report(int64_t from, int64_t to, int64_t bucket_days, int64_t now)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        TodoAggregateReport report{static_cast<int64_t>(dates_.size()), before(now), 0, {}};
+        if (from >= to || bucket_days <= 0)
+          return report;
+
+        report.in_range = before(to) - before(from);
+        // Bucket ends saturate at the day after the last representable
+        // date, so a huge bucket_days cannot overflow.
+        const int64_t end_of_days = day_of(INT64_MAX) + 1;
+        int64_t last = day_of(to - 1);
+        for (int64_t day = day_of(from);;)
+        {
+          int64_t end = day > end_of_days - bucket_days ? end_of_days : day + bucket_days;
+          int64_t count = tree_.before(end) - tree_.before(day);
+          // The day of INT64_MIN starts before it.
+          int64_t start = day < INT64_MIN / kDayMs ? INT64_MIN : day * kDayMs;
+          report.buckets.push_back({start, count});
+          if (end > last)
+            break;
+          day = end;
+        }
+        return report;
+      }
+
+      void set_callback(TodoCallback callback)
+      {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        callback_ = std::move(callback);
+      }
+
+    private:
+      void load(const TodoItem &todo)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        TodoId key = to_key(todo.id);
+        if (seen_.count(key))
+          return;
+        auto it = dates_.find(key);
+        if (it != dates_.end())
+          count(it->second, -1);
+        dates_[key] = todo.date;
+        count(todo.date, 1);
+      }
+
+      void on_change(TodoChange change, const TodoItem &todo)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        TodoId key = to_key(todo.id);
+        if (loading_)
+          seen_.insert(key);
+
+        auto it = dates_.find(key);
+        if (it != dates_.end())
+        {
+          if (change != TodoChange::Deleted && it->second == todo.date)
+            return;
+          record(it->second, -1);
+          if (change == TodoChange::Deleted)
+            dates_.erase(it);
+          else
+            it->second = todo.date;
+        }
+        else if (change != TodoChange::Deleted)
+        {
+          dates_.emplace(key, todo.date);
+        }
+        else
+        {
+          return;
+        }
+        if (change != TodoChange::Deleted)
+          record(todo.date, 1);
+
+        if (!loading_)
+          account();
+        if (!flush_pending_)
+        {
+          flush_pending_ = true;
+          TaskPool::shared().submit([this]()
+                                    { flush(); });
+        }
+      }
+
+      // Caller holds mutex_. Adds or removes one todo dated `date`.
+      void count(int64_t date, int64_t delta)
+      {
+        int64_t day = day_of(date);
+        tree_.add(day, delta);
+        DayTimes &times = times_[day];
+        int32_t time = time_of_day(date);
+        if (delta > 0)
+        {
+          times.insert({time, next_serial_++});
+        }
+        else
+        {
+          times.erase(times.lower_bound({time, 0}));
+          if (times.empty())
+            times_.erase(day);
+        }
+      }
+
+      // Caller holds mutex_. count() plus the pending delta for the callback.
+      void record(int64_t date, int64_t delta)
+      {
+        count(date, delta);
+        pending_[day_of(date)] += delta;
+      }
+
+      // Caller holds mutex_. Todos dated before `moment`.
+      int64_t before(int64_t moment) const
+      {
+        int64_t day = day_of(moment);
+        int64_t count = tree_.before(day);
+        auto it = times_.find(day);
+        if (it != times_.end())
+          count += static_cast<int64_t>(it->second.order_of_key({time_of_day(moment), 0}));
+        return count;
+      }
+
+      // Caller holds mutex_. The id map, the per-day times and the tree.
+      void account()
+      {
+        int64_t bytes = static_cast<int64_t>(dates_.size()) * (sizeof(TodoId) + sizeof(int64_t) + kNodeBytes + kTimeNodeBytes) +
+                        static_cast<int64_t>(times_.size()) * (sizeof(int64_t) + sizeof(DayTimes) + kNodeBytes) +
+                        static_cast<int64_t>(tree_.capacity() * sizeof(int64_t));
+        memory::add(memory::Component::Indexes, bytes - accounted_);
+        accounted_ = bytes;
+      }
+
+      // Holds callback_mutex_ throughout, so that flushes running on
+      // different workers deliver in the order they read the aggregates.
+      void flush()
+      {
+        std::lock_guard<std::mutex> delivery(callback_mutex_);
+        std::string json;
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          flush_pending_ = false;
+          int64_t overdue = before(now_ms());
+          std::string days;
+          for (auto &entry : pending_)
+          {
+            if (entry.second == 0)
+              continue;
+            days += days.empty() ? "" : ",";
+            days += "{\"day\":" + std::to_string(entry.first * kDayMs) + ",\"delta\":" + std::to_string(entry.second) + "}";
+          }
+          pending_.clear();
+          if (days.empty() && overdue == last_overdue_)
+            return;
+          last_overdue_ = overdue;
+          json = "{\"days\":[" + days + "],\"total\":" + std::to_string(dates_.size()) +
+                 ",\"overdue\":" + std::to_string(overdue) + "}";
+        }
+
+        if (callback_)
+          callback_(json);
+      }
+
+      std::mutex mutex_;
+      std::unordered_map<TodoId, int64_t, TodoIdHash> dates_;
+      std::unordered_map<int64_t, DayTimes> times_; // per day
+      uint64_t next_serial_ = 1;
+      DayTree tree_;
+      bool loading_ = true;
+      std::unordered_set<TodoId, TodoIdHash> seen_; // changed while loading
+      std::map<int64_t, int64_t> pending_;          // day -> delta since the last flush
+      bool flush_pending_ = false;
+      int64_t last_overdue_ = -1;
+      int64_t accounted_ = 0;
+
+      // Separate from mutex_ so delivering an event never blocks the store
+      // observer.
+      std::mutex callback_mutex_;
+      TodoCallback callback_;
+    };
+
+    std::mutex g_aggregator_mutex;
+    // Never destroyed: flushes queued on the task pool may outlive main().
+    Aggregator *g_aggregator = nullptr;
+    TodoCallback g_pending_callback;
+
+    Aggregator &aggregator()
+    {
+      std::lock_guard<std::mutex> lock(g_aggregator_mutex);
+      if (!g_aggregator)
+      {
+        g_aggregator = new Aggregator();
+        g_aggregator->set_callback(std::move(g_pending_callback));
+      }
+      return *g_aggregator;
+    }
+  }
+
+  TodoAggregateReport todo_aggregates(int64_t from, int64_t to, int64_t bucket_days, int64_t now)
+  {
+    return aggregator().report(from, to, bucket_days, now);
+  }
+
+  void setAggregatesCallback(TodoCallback callback)
+  {
+    std::lock_guard<std::mutex> lock(g_aggregator_mutex);
+    if (g_aggregator)
+      g_aggregator->set_callback(std::move(callback));
+    else
+      g_pending_callback = std::move(callback);
+  }
+
+} // namespace cpp_code
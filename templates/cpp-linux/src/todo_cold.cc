@@ -0,0 +1,602 @@
+#include "todo_cold.h"
+#include "cpp_code.h"
+#include "lz_codec.h"
+#include "memory_accounting.h"
+#include "task_pool.h"
+#include "todo_query.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    constexpr size_t kBlockItems = 1024;
+    constexpr size_t kDictionaryBytes = 32 * 1024;
+    constexpr size_t kBloomBitsPerItem = 10;
+
+    // Uncompressed payload of a block: every date, then the end offset of
+    // every text, then the texts back to back. Rows are in id order.
+    class DecodedBlock
+    {
+    public:
+      explicit DecodedBlock(size_t count) : count_(count) {}
+
+      std::vector<uint8_t> &bytes() { return bytes_; }
+
+      int64_t date(size_t row) const
+      {
+        int64_t value;
+        memcpy(&value, bytes_.data() + row * sizeof(int64_t), sizeof(value));
+        return value;
+      }
+
+      std::string text(size_t row) const
+      {
+        uint32_t begin = row ? end(row - 1) : 0;
+        return std::string(reinterpret_cast<const char *>(bytes_.data()) + texts_offset() + begin,
+                           end(row) - begin);
+      }
+
+    private:
+      size_t texts_offset() const { return count_ * (sizeof(int64_t) + sizeof(uint32_t)); }
+
+      uint32_t end(size_t row) const
+      {
+        uint32_t value;
+        memcpy(&value, bytes_.data() + count_ * sizeof(int64_t) + row * sizeof(uint32_t), sizeof(value));
+        return value;
+      }
+
+      size_t count_;
+      std::vector<uint8_t> bytes_;
+    };
+
+    struct ColdBlock
+    {
+      int64_t min_date;
+      int64_t max_date;
+      uint32_t count;
+      uint32_t live;
+      size_t text_bytes;
+      uint32_t raw_size;
+      std::vector<uint8_t> ids; // sorted
+      std::vector<uint64_t> bloom;
+      std::vector<uint64_t> deleted;
+      std::vector<uint8_t> payload;
+      std::shared_ptr<const std::string> dictionary;
+      bool accounted = false;
+
+      // Blocks stay alive after leaving the tier while a cursor pins them.
+      ~ColdBlock()
+      {
+        if (accounted)
+          account(-1);
+      }
+
+      // Ids are random, so three disjoint 32-bit slices are independent
+      // hashes without hashing.
+      template <typename Fn>
+      void bloom_bits(const uuid_t id, Fn fn) const
+      {
+        const size_t bits = bloom.size() * 64;
+        for (int i = 0; i < 3; ++i)
+        {
+          uint32_t slice;
+          memcpy(&slice, id + i * 4, sizeof(slice));
+          fn(slice % bits);
+        }
+      }
+
+      int find(const uuid_t id) const
+      {
+        bool maybe = true;
+        bloom_bits(id, [&](size_t bit)
+                   { maybe &= (bloom[bit / 64] >> (bit % 64)) & 1; });
+        if (!maybe)
+          return -1;
+
+        size_t low = 0, high = count;
+        while (low < high)
+        {
+          size_t mid = (low + high) / 2;
+          int cmp = memcmp(&ids[mid * sizeof(uuid_t)], id, sizeof(uuid_t));
+          if (cmp == 0)
+            return is_deleted(mid) ? -1 : static_cast<int>(mid);
+          if (cmp < 0)
+            low = mid + 1;
+          else
+            high = mid;
+        }
+        return -1;
+      }
+
+      bool is_deleted(size_t row) const { return (deleted[row / 64] >> (row % 64)) & 1; }
+
+      DecodedBlock decode() const
+      {
+        DecodedBlock decoded(count);
+        decoded.bytes().resize(raw_size);
+        // Blocks never leave the process, so this is memory corruption or a
+        // codec bug; rows of zeros would silently lose todos.
+        if (!lz::decompress(reinterpret_cast<const uint8_t *>(dictionary->data()), dictionary->size(),
+                            payload.data(), payload.size(), decoded.bytes().data(), raw_size))
+        {
+          throw std::runtime_error("Corrupt cold tier block");
+        }
+        return decoded;
+      }
+
+      TodoItem item(const DecodedBlock &decoded, size_t row) const
+      {
+        TodoItem todo;
+        memcpy(todo.id, &ids[row * sizeof(uuid_t)], sizeof(uuid_t));
+        todo.text = decoded.text(row);
+        todo.date = decoded.date(row);
+        return todo;
+      }
+
+      size_t index_bytes() const
+      {
+        return ids.capacity() + (bloom.capacity() + deleted.capacity()) * sizeof(uint64_t);
+      }
+
+      size_t resident_bytes() const { return sizeof(ColdBlock) + payload.capacity() + index_bytes(); }
+
+      // Blocks are accounted once built; the dictionary accounts for itself.
+      void account(int64_t sign)
+      {
+        accounted = sign > 0;
+        memory::add(memory::Component::ColdTier, sign * static_cast<int64_t>(sizeof(ColdBlock) + payload.capacity()));
+        memory::add(memory::Component::Indexes, sign * static_cast<int64_t>(index_bytes()));
+      }
+    };
+
+    // Blocks are immutable apart from their deletion marks, which are
+    // changed under the exclusive lock.
+    std::shared_mutex g_cold_mutex;
+    std::vector<std::shared_ptr<ColdBlock>> g_blocks;
+
+    // Samples texts evenly across the batch, skipping repeats, so the
+    // dictionary covers the vocabulary rather than its most recent slice.
+    std::shared_ptr<const std::string> build_dictionary(const std::vector<TodoItem> &todos)
+    {
+      auto *dictionary = new std::string();
+      size_t total = 0;
+      for (auto &todo : todos)
+        total += todo.text.size();
+
+      size_t stride = std::max<size_t>(1, total / kDictionaryBytes);
+      std::unordered_set<std::string_view> seen;
+      for (size_t i = 0; i < todos.size() && dictionary->size() < kDictionaryBytes; i += stride)
+      {
+        const std::string &text = todos[i].text;
+        if (text.size() < 4 || !seen.insert(text).second)
+          continue;
+        dictionary->append(text, 0, kDictionaryBytes - dictionary->size());
+      }
+
+      memory::add(memory::Component::ColdTier, sizeof(std::string) + dictionary->capacity());
+      return std::shared_ptr<const std::string>(dictionary, [](const std::string *owned)
+                                                {
+        memory::add(memory::Component::ColdTier, -static_cast<int64_t>(sizeof(std::string) + owned->capacity()));
+        delete owned; });
+    }
+
+    std::unique_ptr<ColdBlock> build_block(const TodoItem *const *todos, size_t count,
+                                           std::shared_ptr<const std::string> dictionary)
+    {
+      std::vector<const TodoItem *> rows(todos, todos + count);
+      std::sort(rows.begin(), rows.end(), [](const TodoItem *a, const TodoItem *b)
+                { return memcmp(a->id, b->id, sizeof(uuid_t)) < 0; });
+
+      auto block = std::make_unique<ColdBlock>();
+      block->count = static_cast<uint32_t>(count);
+      block->live = block->count;
+      block->min_date = rows[0]->date;
+      block->max_date = rows[0]->date;
+      block->text_bytes = 0;
+      block->ids.resize(count * sizeof(uuid_t));
+      block->bloom.assign((count * kBloomBitsPerItem + 63) / 64, 0);
+      block->deleted.assign((count + 63) / 64, 0);
+      block->dictionary = std::move(dictionary);
+
+      std::vector<uint8_t> raw(count * (sizeof(int64_t) + sizeof(uint32_t)));
+      uint32_t end = 0;
+      for (size_t row = 0; row < count; ++row)
+      {
+        const TodoItem &todo = *rows[row];
+        memcpy(&block->ids[row * sizeof(uuid_t)], todo.id, sizeof(uuid_t));
+        block->bloom_bits(todo.id, [&](size_t bit)
+                          { block->bloom[bit / 64] |= uint64_t(1) << (bit % 64); });
+        block->min_date = std::min(block->min_date, todo.date);
+        block->max_date = std::max(block->max_date, todo.date);
+        block->text_bytes += todo.text.size();
+
+        end += static_cast<uint32_t>(todo.text.size());
+        memcpy(&raw[row * sizeof(int64_t)], &todo.date, sizeof(int64_t));
+        memcpy(&raw[count * sizeof(int64_t) + row * sizeof(uint32_t)], &end, sizeof(uint32_t));
+      }
+      for (auto *todo : rows)
+        raw.insert(raw.end(), todo->text.begin(), todo->text.end());
+
+      block->raw_size = static_cast<uint32_t>(raw.size());
+      block->payload.resize(lz::compress_bound(raw.size()));
+      size_t size = lz::compress(reinterpret_cast<const uint8_t *>(block->dictionary->data()),
+                                 block->dictionary->size(), raw.data(), raw.size(), block->payload.data());
+      block->payload.resize(size);
+      block->payload.shrink_to_fit();
+      block->account(1);
+      return block;
+    }
+
+    int64_t now_ms()
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+
+    void mark_deleted(size_t index, size_t row, size_t text_size)
+    {
+      ColdBlock &block = *g_blocks[index];
+      block.deleted[row / 64] |= uint64_t(1) << (row % 64);
+      block.text_bytes -= text_size;
+      if (--block.live == 0)
+        g_blocks.erase(g_blocks.begin() + index);
+    }
+
+    class ColdTierCompactor
+    {
+    public:
+      ColdTierCompactor(int64_t age_ms, int64_t interval_ms)
+          : age_(age_ms), interval_(interval_ms)
+      {
+        thread_ = std::thread([this]()
+                              { run(); });
+      }
+
+      ~ColdTierCompactor()
+      {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          stopping_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+      }
+
+    private:
+      void run()
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_)
+        {
+          lock.unlock();
+          freeze_todos_before(now_ms() - age_);
+          lock.lock();
+
+          cv_.wait_for(lock, std::chrono::milliseconds(interval_), [this]()
+                       { return stopping_; });
+        }
+      }
+
+      int64_t age_;
+      int64_t interval_;
+      std::mutex mutex_;
+      std::condition_variable cv_;
+      bool stopping_ = false;
+      std::thread thread_;
+    };
+
+    std::mutex g_compactor_mutex;
+    std::unique_ptr<ColdTierCompactor> g_compactor;
+
+    // Held while the callback runs, so clearing it waits for a running call.
+    std::mutex g_pressure_mutex;
+    TodoCallback g_memoryPressureCallback;
+
+    std::string usage_json(const memory::Usage &usage)
+    {
+      return "{\"items\":" + std::to_string(usage[memory::Component::Items]) +
+             ",\"text\":" + std::to_string(usage[memory::Component::Text]) +
+             ",\"indexes\":" + std::to_string(usage[memory::Component::Indexes]) +
+             ",\"eventQueues\":" + std::to_string(usage[memory::Component::EventQueues]) +
+             ",\"coldTier\":" + std::to_string(usage[memory::Component::ColdTier]) +
+             ",\"total\":" + std::to_string(usage.total()) +
+             ",\"softLimit\":" + std::to_string(memory::soft_limit()) + "}";
+    }
+
+    // Runs on the pool: the limit callback fires on an allocating thread
+    // that may hold the store's write mutex.
+    void shed_memory(int64_t freeze_age_ms)
+    {
+      freeze_todos_before(now_ms() - freeze_age_ms);
+      release_todo_columns();
+
+      memory::Usage usage = memory::usage();
+      int64_t limit = memory::soft_limit();
+      if (limit <= 0 || usage.total() <= limit)
+        return;
+
+      std::lock_guard<std::mutex> lock(g_pressure_mutex);
+      if (g_memoryPressureCallback)
+        g_memoryPressureCallback(usage_json(usage));
+    }
+  }
+
+  namespace cold
+  {
+
+    struct Batch
+    {
+      std::vector<std::unique_ptr<ColdBlock>> blocks;
+    };
+
+    std::shared_ptr<Batch> build(const std::vector<TodoItem> &todos)
+    {
+      auto batch = std::make_shared<Batch>();
+      if (todos.empty())
+        return batch;
+
+      // Blocks cover consecutive date ranges so date scans skip most of them.
+      std::vector<const TodoItem *> rows(todos.size());
+      for (size_t i = 0; i < todos.size(); ++i)
+        rows[i] = &todos[i];
+      std::stable_sort(rows.begin(), rows.end(), [](const TodoItem *a, const TodoItem *b)
+                       { return a->date < b->date; });
+      auto dictionary = build_dictionary(todos);
+
+      const size_t count = (todos.size() + kBlockItems - 1) / kBlockItems;
+      batch->blocks.resize(count);
+      TaskPool::shared().parallel_for(count, 1, [&](size_t begin, size_t end)
+                                      {
+        for (size_t i = begin; i < end; ++i)
+        {
+          size_t first = i * kBlockItems;
+          size_t size = std::min(kBlockItems, todos.size() - first);
+          batch->blocks[i] = build_block(&rows[first], size, dictionary);
+        } });
+      return batch;
+    }
+
+    void insert(std::shared_ptr<Batch> batch)
+    {
+      std::unique_lock<std::shared_mutex> lock(g_cold_mutex);
+      for (auto &block : batch->blocks)
+        g_blocks.push_back(std::move(block));
+      batch->blocks.clear();
+    }
+
+    bool find(const uuid_t id, TodoItem &out)
+    {
+      std::shared_lock<std::shared_mutex> lock(g_cold_mutex);
+      for (auto &block : g_blocks)
+      {
+        int row = block->find(id);
+        if (row >= 0)
+        {
+          out = block->item(block->decode(), row);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool take(const uuid_t id, TodoItem &out)
+    {
+      std::unique_lock<std::shared_mutex> lock(g_cold_mutex);
+      for (size_t i = 0; i < g_blocks.size(); ++i)
+      {
+        int row = g_blocks[i]->find(id);
+        if (row < 0)
+          continue;
+
+        out = g_blocks[i]->item(g_blocks[i]->decode(), row);
+        mark_deleted(i, row, out.text.size());
+        return true;
+      }
+      return false;
+    }
+
+    void for_each(const std::function<void(const TodoItem &)> &fn)
+    {
+      std::shared_lock<std::shared_mutex> lock(g_cold_mutex);
+      for (auto &block : g_blocks)
+      {
+        DecodedBlock decoded = block->decode();
+        for (size_t row = 0; row < block->count; ++row)
+        {
+          if (!block->is_deleted(row))
+            fn(block->item(decoded, row));
+        }
+      }
+    }
+
+  } // namespace cold
+
+  bool find_todo(const uuid_t id, TodoItem &out)
+  {
+    // Moves between the tiers always publish a new hot version, so a miss
+    // on an unchanged version is a real miss.
+    for (;;)
+    {
+      uint64_t version;
+      {
+        TodoReadGuard snapshot;
+        version = snapshot->version();
+        bool found = false;
+        snapshot->for_each([&](const TodoItem &todo)
+                           {
+          if (!found && memcmp(todo.id, id, sizeof(uuid_t)) == 0)
+          {
+            out = todo;
+            found = true;
+          } });
+        if (found)
+          return true;
+      }
+
+      if (cold::find(id, out))
+        return true;
+
+      TodoReadGuard snapshot;
+      if (snapshot->version() == version)
+        return false;
+    }
+  }
+
+  void scan_cold_todos(int64_t from, int64_t to, const std::function<void(const TodoItem &)> &fn)
+  {
+    std::shared_lock<std::shared_mutex> lock(g_cold_mutex);
+    for (auto &block : g_blocks)
+    {
+      if (block->max_date < from || block->min_date > to)
+        continue;
+
+      DecodedBlock decoded = block->decode();
+      for (size_t row = 0; row < block->count; ++row)
+      {
+        int64_t date = decoded.date(row);
+        if (date >= from && date <= to && !block->is_deleted(row))
+          fn(block->item(decoded, row));
+      }
+    }
+  }
+
+  struct ColdTierView::State
+  {
+    struct Pinned
+    {
+      std::shared_ptr<const ColdBlock> block;
+      std::vector<uint64_t> deleted;
+      size_t first; // view index of its first live todo
+    };
+
+    std::vector<Pinned> blocks;
+    size_t size = 0;
+    int64_t accounted = 0;
+
+    // The block decoded last and its live rows.
+    size_t decoded_index = SIZE_MAX;
+    std::optional<DecodedBlock> decoded;
+    std::vector<uint32_t> rows;
+
+    ~State() { memory::add(memory::Component::Indexes, -accounted); }
+  };
+
+  ColdTierView::ColdTierView() = default;
+  ColdTierView::~ColdTierView() = default;
+  ColdTierView::ColdTierView(ColdTierView &&) noexcept = default;
+  ColdTierView &ColdTierView::operator=(ColdTierView &&) noexcept = default;
+
+  size_t ColdTierView::size() const { return state_ ? state_->size : 0; }
+
+  size_t ColdTierView::for_each_from(size_t first, size_t count, const std::function<void(const TodoItem &)> &fn)
+  {
+    if (!state_ || first >= state_->size)
+      return 0;
+
+    State &state = *state_;
+    auto it = std::upper_bound(state.blocks.begin(), state.blocks.end(), first, [](size_t index, const State::Pinned &pinned)
+                               { return index < pinned.first; });
+    size_t walked = 0;
+    for (size_t b = static_cast<size_t>(it - state.blocks.begin()) - 1; b < state.blocks.size() && walked < count; ++b)
+    {
+      const State::Pinned &pinned = state.blocks[b];
+      if (state.decoded_index != b)
+      {
+        state.decoded = pinned.block->decode();
+        state.rows.clear();
+        for (uint32_t row = 0; row < pinned.block->count; ++row)
+        {
+          if (!((pinned.deleted[row / 64] >> (row % 64)) & 1))
+            state.rows.push_back(row);
+        }
+        state.decoded_index = b;
+      }
+
+      for (size_t offset = first + walked - pinned.first; offset < state.rows.size() && walked < count; ++offset, ++walked)
+        fn(pinned.block->item(*state.decoded, state.rows[offset]));
+    }
+    return walked;
+  }
+
+  ColdTierView pin_cold_todos()
+  {
+    ColdTierView view;
+    view.state_ = std::make_unique<ColdTierView::State>();
+    ColdTierView::State &state = *view.state_;
+
+    std::shared_lock<std::shared_mutex> lock(g_cold_mutex);
+    state.blocks.reserve(g_blocks.size());
+    for (auto &block : g_blocks)
+    {
+      state.blocks.push_back({block, block->deleted, state.size});
+      state.size += block->live;
+      state.accounted += static_cast<int64_t>(sizeof(ColdTierView::State::Pinned) + block->deleted.capacity() * sizeof(uint64_t));
+    }
+    memory::add(memory::Component::Indexes, state.accounted);
+    return view;
+  }
+
+  ColdTierStats cold_tier_stats()
+  {
+    std::shared_lock<std::shared_mutex> lock(g_cold_mutex);
+    ColdTierStats stats{g_blocks.size(), 0, 0, 0};
+    std::unordered_set<const std::string *> dictionaries;
+    for (auto &block : g_blocks)
+    {
+      stats.items += block->live;
+      stats.text_bytes += block->text_bytes;
+      stats.resident_bytes += block->resident_bytes();
+      if (dictionaries.insert(block->dictionary.get()).second)
+        stats.resident_bytes += block->dictionary->capacity();
+    }
+    return stats;
+  }
+
+  void start_cold_tier(int64_t age_ms, int64_t interval_ms)
+  {
+    std::lock_guard<std::mutex> lock(g_compactor_mutex);
+    g_compactor.reset();
+    g_compactor = std::make_unique<ColdTierCompactor>(age_ms, std::max<int64_t>(interval_ms, 1000));
+  }
+
+  void stop_cold_tier()
+  {
+    std::lock_guard<std::mutex> lock(g_compactor_mutex);
+    g_compactor.reset();
+  }
+
+  void set_memory_limit(int64_t bytes, int64_t freeze_age_ms)
+  {
+    if (bytes <= 0)
+    {
+      memory::set_soft_limit(0, nullptr);
+      return;
+    }
+    memory::set_soft_limit(bytes, [freeze_age_ms]()
+                           { TaskPool::shared().submit([freeze_age_ms]()
+                                                       { shed_memory(freeze_age_ms); }); });
+  }
+
+  void setMemoryPressureCallback(TodoCallback callback)
+  {
+    std::lock_guard<std::mutex> lock(g_pressure_mutex);
+    g_memoryPressureCallback = std::move(callback);
+  }
+
+} // namespace cpp_code
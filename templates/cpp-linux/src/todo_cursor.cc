@@ -0,0 +1,111 @@
+#include "todo_cursor.h"
+#include "memory_accounting.h"
+#include "task_pool.h"
+#include <algorithm>
+
+namespace cpp_code
+{
+
+  TodoCursor::TodoCursor(const TodoCursorOptions &options)
+  {
+    const int64_t from = options.from;
+    size_t frozen = 0;
+    if (options.order_by == TodoCursorOrder::List)
+    {
+      uint64_t cold_version = ~uint64_t(0);
+      read_changed_tiers(cold_version, [this]()
+                         { snapshot_ = pin_todos(); },
+                         [this]()
+                         { cold_ = pin_cold_todos(); });
+      frozen = cold_.size();
+    }
+    else
+    {
+      int64_t first = std::numeric_limits<int64_t>::min();
+      int64_t last = std::numeric_limits<int64_t>::max();
+      if (options.order_by == TodoCursorOrder::DateAscending)
+        first = from;
+      else
+        last = from;
+      read_both_tiers([this]()
+                      {
+        snapshot_ = pin_todos();
+        frozen_.clear(); },
+                      first, last, [this](const TodoItem &todo)
+                      { frozen_.push_back(todo); });
+
+      frozen_.shrink_to_fit();
+      accounted_items_ = static_cast<int64_t>(frozen_.capacity() * sizeof(TodoItem));
+      for (const TodoItem &todo : frozen_)
+      {
+        if (todo.text.capacity() > std::string().capacity())
+          accounted_text_ += static_cast<int64_t>(todo.text.capacity() + 1);
+      }
+      memory::add(memory::Component::Items, accounted_items_);
+      memory::add(memory::Component::Text, accounted_text_);
+      frozen = frozen_.size();
+    }
+
+    const size_t total = snapshot_->size() + frozen;
+    switch (options.order_by)
+    {
+    case TodoCursorOrder::List:
+      begin_ = static_cast<size_t>(std::clamp<int64_t>(from, 0, static_cast<int64_t>(total)));
+      end_ = total;
+      break;
+
+    case TodoCursorOrder::DateAscending:
+    case TodoCursorOrder::DateDescending:
+    {
+      const bool ascending = options.order_by == TodoCursorOrder::DateAscending;
+      order_.reserve(total);
+      snapshot_->for_each([&](const TodoItem &todo)
+                          {
+        if (ascending ? todo.date >= from : todo.date <= from)
+          order_.push_back(&todo); });
+      for (const TodoItem &todo : frozen_)
+        order_.push_back(&todo);
+      order_.shrink_to_fit();
+
+      // parallel_sort is stable, so equal dates stay in list order.
+      if (ascending)
+      {
+        parallel_sort(TaskPool::shared(), order_.begin(), order_.end(), [](const TodoItem *a, const TodoItem *b)
+                      { return a->date < b->date; });
+      }
+      else
+      {
+        parallel_sort(TaskPool::shared(), order_.begin(), order_.end(), [](const TodoItem *a, const TodoItem *b)
+                      { return a->date > b->date; });
+      }
+      end_ = order_.size();
+
+      accounted_ = static_cast<int64_t>(order_.capacity() * sizeof(const TodoItem *));
+      memory::add(memory::Component::Indexes, accounted_);
+      break;
+    }
+    }
+    position_ = begin_;
+  }
+
+  TodoCursor::~TodoCursor()
+  {
+    close();
+  }
+
+  void TodoCursor::close()
+  {
+    memory::add(memory::Component::Indexes, -accounted_);
+    memory::add(memory::Component::Items, -accounted_items_);
+    memory::add(memory::Component::Text, -accounted_text_);
+    accounted_ = accounted_items_ = accounted_text_ = 0;
+    order_.clear();
+    order_.shrink_to_fit();
+    frozen_.clear();
+    frozen_.shrink_to_fit();
+    cold_ = ColdTierView();
+    snapshot_.reset();
+    position_ = end_;
+  }
+
+} // namespace cpp_code
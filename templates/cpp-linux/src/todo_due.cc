@@ -0,0 +1,226 @@
+#include "cpp_code.h"
+#include "timing_wheel.h"
+#include "todo_store.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    // Due notifications are delivered with one-second resolution; every todo
+    // that falls due within the same tick is delivered as one JSON array.
+    constexpr int64_t kTickMs = 1000;
+
+    struct DueTimer : TimingWheel::Timer
+    {
+      TodoItem todo;
+    };
+
+    int64_t now_ms()
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+
+    std::string id_key(const uuid_t id)
+    {
+      return std::string(reinterpret_cast<const char *>(id), sizeof(uuid_t));
+    }
+
+    // Keeps one wheel timer per future-dated todo in step with the store and
+    // fires todoDue from a single thread driven by a timerfd, which is only
+    // armed while at least one timer is pending.
+    class DueScheduler
+    {
+    public:
+      DueScheduler()
+          : wheel_(static_cast<uint64_t>(now_ms() / kTickMs))
+      {
+        timer_fd_ = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        // Register before loading so no mutation can slip between the two;
+        // loading skips todos the observer has already seen, so a todo
+        // deleted or moved after the snapshot keeps its newer state.
+        observer_ = add_todo_observer([this](TodoChange change, const TodoItem &todo)
+                                      { on_change(change, todo); });
+        {
+          TodoReadGuard snapshot;
+          snapshot->for_each([this](const TodoItem &todo)
+                             { load(todo); });
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          loading_ = false;
+          seen_ = {};
+        }
+
+        thread_ = std::thread([this]()
+                              { run(); });
+      }
+
+      ~DueScheduler()
+      {
+        remove_todo_observer(observer_);
+        stopping_ = true;
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+        thread_.join();
+        close(timer_fd_);
+        close(wake_fd_);
+      }
+
+      void set_callback(TodoCallback callback)
+      {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        callback_ = std::move(callback);
+      }
+
+    private:
+      void load(const TodoItem &todo)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto key = id_key(todo.id);
+        if (!seen_.count(key))
+          apply(TodoChange::Added, key, todo);
+      }
+
+      void on_change(TodoChange change, const TodoItem &todo)
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto key = id_key(todo.id);
+        if (loading_)
+          seen_.insert(key);
+        apply(change, key, todo);
+      }
+
+      // Caller holds mutex_.
+      void apply(TodoChange change, const std::string &key, const TodoItem &todo)
+      {
+        auto it = timers_.find(key);
+
+        // Only dates still in the future are scheduled; editing a todo into
+        // the past simply cancels its notification.
+        if (change == TodoChange::Deleted || todo.date <= now_ms())
+        {
+          if (it != timers_.end())
+          {
+            wheel_.cancel(it->second.get());
+            timers_.erase(it);
+          }
+          return;
+        }
+
+        if (it == timers_.end())
+        {
+          it = timers_.emplace(key, std::make_unique<DueTimer>()).first;
+        }
+        it->second->todo = todo;
+        wheel_.schedule(it->second.get(), static_cast<uint64_t>((todo.date + kTickMs - 1) / kTickMs));
+        arm(true);
+      }
+
+      // Caller holds mutex_.
+      void arm(bool pending)
+      {
+        if (pending == armed_)
+          return;
+
+        itimerspec spec{};
+        if (pending)
+        {
+          spec.it_value.tv_sec = spec.it_interval.tv_sec = kTickMs / 1000;
+          spec.it_value.tv_nsec = spec.it_interval.tv_nsec = (kTickMs % 1000) * 1000000;
+        }
+        timerfd_settime(timer_fd_, 0, &spec, nullptr);
+        armed_ = pending;
+      }
+
+      void run()
+      {
+        pollfd fds[2] = {{timer_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+        std::vector<TimingWheel::Timer *> due;
+
+        while (!stopping_)
+        {
+          if (poll(fds, 2, -1) <= 0 || !(fds[0].revents & POLLIN))
+            continue;
+
+          uint64_t expirations;
+          ssize_t ignored = read(timer_fd_, &expirations, sizeof(expirations));
+          (void)ignored;
+
+          std::string batch;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            due.clear();
+            wheel_.advance(static_cast<uint64_t>(now_ms() / kTickMs), due);
+
+            for (auto *timer : due)
+            {
+              auto *entry = static_cast<DueTimer *>(timer);
+              batch += batch.empty() ? "[" : ",";
+              batch += entry->todo.toJson();
+              timers_.erase(id_key(entry->todo.id));
+            }
+            arm(wheel_.size() > 0);
+          }
+
+          if (!batch.empty())
+          {
+            batch += "]";
+            std::lock_guard<std::mutex> lock(callback_mutex_);
+            if (callback_)
+              callback_(batch);
+          }
+        }
+      }
+
+      std::mutex mutex_;
+      TimingWheel wheel_;
+      std::unordered_map<std::string, std::unique_ptr<DueTimer>> timers_;
+      bool loading_ = true;
+      std::unordered_set<std::string> seen_; // changed while loading
+
+      // Separate from mutex_ so delivering a batch never blocks the store
+      // observers that reschedule timers.
+      std::mutex callback_mutex_;
+      TodoCallback callback_;
+      bool armed_ = false;
+
+      int timer_fd_ = -1;
+      int wake_fd_ = -1;
+      int observer_ = 0;
+      std::atomic<bool> stopping_{false};
+      std::thread thread_;
+    };
+
+    std::mutex g_scheduler_mutex;
+    std::unique_ptr<DueScheduler> g_scheduler;
+  }
+
+  void setTodoDueCallback(TodoCallback callback)
+  {
+    std::lock_guard<std::mutex> lock(g_scheduler_mutex);
+    if (!g_scheduler)
+    {
+      g_scheduler = std::make_unique<DueScheduler>();
+    }
+    g_scheduler->set_callback(std::move(callback));
+  }
+
+} // namespace cpp_code
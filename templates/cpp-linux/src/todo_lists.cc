@@ -0,0 +1,289 @@
+#include "todo_lists.h"
+#include "memory_accounting.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    using TodoId = std::array<unsigned char, sizeof(uuid_t)>;
+
+    // Ids are random, so their first eight bytes are a good hash.
+    struct TodoIdHash
+    {
+      size_t operator()(const TodoId &id) const
+      {
+        uint64_t hash;
+        memcpy(&hash, id.data(), sizeof(hash));
+        return static_cast<size_t>(hash);
+      }
+    };
+
+    TodoId to_key(const uuid_t id)
+    {
+      TodoId key;
+      memcpy(key.data(), id, key.size());
+      return key;
+    }
+
+    // Deleted todos leave a tombstone in `items` so that removal does not
+    // move the todos behind them; the tombstones are compacted away once
+    // they make up half of `items`, which keeps removal amortized O(1).
+    struct TodoList
+    {
+      std::string name;
+      std::vector<TodoItem> items;
+      std::vector<bool> removed; // parallel to items
+      size_t removed_count = 0;
+      std::unordered_map<TodoId, uint32_t, TodoIdHash> index; // id -> position
+
+      size_t size() const { return items.size() - removed_count; }
+
+      void compact()
+      {
+        size_t kept = 0;
+        for (size_t i = 0; i < items.size(); ++i)
+        {
+          if (removed[i])
+            continue;
+          if (kept != i)
+          {
+            items[kept] = std::move(items[i]);
+            index[to_key(items[kept].id)] = static_cast<uint32_t>(kept);
+          }
+          ++kept;
+        }
+        items.resize(kept);
+        removed.assign(kept, false);
+        removed_count = 0;
+      }
+    };
+
+    // Node of the id index: the entry plus the bucket chain pointer.
+    constexpr int64_t kIndexEntryBytes = sizeof(std::pair<const TodoId, uint32_t>) + 2 * sizeof(void *);
+
+    // Shards pass memory changes on in batches of this size, so writers of
+    // different shards do not all hit the global counters on every change.
+    constexpr int64_t kAccountBatchBytes = 64 * 1024;
+
+    // Memory accounting deltas of one shard not yet passed on.
+    struct PendingBytes
+    {
+      int64_t items = 0;
+      int64_t text = 0;
+      int64_t indexes = 0;
+
+      void add(const TodoItem &item, int64_t sign)
+      {
+        items += sign * static_cast<int64_t>(sizeof(TodoItem));
+        if (item.text.capacity() > std::string().capacity())
+          text += sign * static_cast<int64_t>(item.text.capacity() + 1);
+        indexes += sign * kIndexEntryBytes;
+        if (std::abs(items) + std::abs(text) + std::abs(indexes) >= kAccountBatchBytes)
+          flush();
+      }
+
+      void flush()
+      {
+        memory::add(memory::Component::Items, items);
+        memory::add(memory::Component::Text, text);
+        memory::add(memory::Component::Indexes, indexes);
+        items = text = indexes = 0;
+      }
+    };
+  }
+
+  // Padded to a cache line so that shards locked by different threads do not
+  // share one.
+  struct alignas(64) TodoLists::Shard
+  {
+    mutable std::mutex mutex;
+    uint32_t index = 0;
+    uint64_t sequence = 0;
+    // Keys view the name of the list they map to.
+    std::unordered_map<std::string_view, std::unique_ptr<TodoList>> lists;
+    Observer observer;
+    PendingBytes pending;
+
+    TodoList *find(std::string_view list) const
+    {
+      auto it = lists.find(list);
+      return it == lists.end() ? nullptr : it->second.get();
+    }
+
+    void erase_if_empty(TodoList &list)
+    {
+      if (list.size() == 0)
+        lists.erase(std::string_view(list.name));
+    }
+  };
+
+  TodoLists &TodoLists::shared()
+  {
+    static TodoLists *lists = new TodoLists(kDefaultShards);
+    return *lists;
+  }
+
+  TodoLists::TodoLists(size_t shards)
+      : shard_count_(std::max<size_t>(shards, 1)), shards_(new Shard[shard_count_])
+  {
+    for (size_t i = 0; i < shard_count_; ++i)
+      shards_[i].index = static_cast<uint32_t>(i);
+  }
+
+  TodoLists::~TodoLists()
+  {
+    for (size_t i = 0; i < shard_count_; ++i)
+    {
+      Shard &shard = shards_[i];
+      for (auto &entry : shard.lists)
+      {
+        const TodoList &list = *entry.second;
+        for (size_t j = 0; j < list.items.size(); ++j)
+        {
+          if (!list.removed[j])
+            shard.pending.add(list.items[j], -1);
+        }
+      }
+      shard.pending.flush();
+    }
+  }
+
+  TodoLists::Shard &TodoLists::shard_of(std::string_view list) const
+  {
+    return shards_[std::hash<std::string_view>()(list) % shard_count_];
+  }
+
+  void TodoLists::notify(Shard &shard, std::string_view list, TodoChange change, const TodoItem &item)
+  {
+    uint64_t sequence = ++shard.sequence;
+    if (shard.observer)
+      shard.observer(TodoListEvent{list, change, item, shard.index, sequence});
+  }
+
+  TodoItem TodoLists::add(std::string_view list, const std::string &text, int64_t date)
+  {
+    TodoItem todo;
+    uuid_generate(todo.id);
+    todo.text = text;
+    todo.date = date;
+
+    Shard &shard = shard_of(list);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    TodoList *target = shard.find(list);
+    if (!target)
+    {
+      auto created = std::make_unique<TodoList>();
+      created->name = std::string(list);
+      target = created.get();
+      shard.lists.emplace(std::string_view(target->name), std::move(created));
+    }
+
+    target->index.emplace(to_key(todo.id), static_cast<uint32_t>(target->items.size()));
+    target->items.push_back(todo);
+    target->removed.push_back(false);
+    shard.pending.add(todo, 1);
+
+    notify(shard, target->name, TodoChange::Added, todo);
+    return todo;
+  }
+
+  bool TodoLists::update(std::string_view list, const uuid_t id, const std::string &text, int64_t date)
+  {
+    Shard &shard = shard_of(list);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    TodoList *target = shard.find(list);
+    if (!target)
+      return false;
+    auto found = target->index.find(to_key(id));
+    if (found == target->index.end())
+      return false;
+
+    TodoItem &todo = target->items[found->second];
+    shard.pending.add(todo, -1);
+    todo.text = text;
+    todo.date = date;
+    shard.pending.add(todo, 1);
+
+    notify(shard, target->name, TodoChange::Updated, todo);
+    return true;
+  }
+
+  bool TodoLists::remove(std::string_view list, const uuid_t id)
+  {
+    Shard &shard = shard_of(list);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    TodoList *target = shard.find(list);
+    if (!target)
+      return false;
+    auto found = target->index.find(to_key(id));
+    if (found == target->index.end())
+      return false;
+
+    size_t position = found->second;
+    TodoItem deleted = std::move(target->items[position]);
+    target->index.erase(found);
+    target->items[position] = TodoItem();
+    target->removed[position] = true;
+    ++target->removed_count;
+    if (target->removed_count * 2 >= target->items.size())
+      target->compact();
+    shard.pending.add(deleted, -1);
+
+    notify(shard, target->name, TodoChange::Deleted, deleted);
+    shard.erase_if_empty(*target);
+    return true;
+  }
+
+  std::vector<TodoItem> TodoLists::items(std::string_view list) const
+  {
+    Shard &shard = shard_of(list);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    TodoList *target = shard.find(list);
+    std::vector<TodoItem> items;
+    if (!target)
+      return items;
+    items.reserve(target->size());
+    for (size_t i = 0; i < target->items.size(); ++i)
+    {
+      if (!target->removed[i])
+        items.push_back(target->items[i]);
+    }
+    return items;
+  }
+
+  size_t TodoLists::size(std::string_view list) const
+  {
+    Shard &shard = shard_of(list);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    TodoList *target = shard.find(list);
+    return target ? target->size() : 0;
+  }
+
+  size_t TodoLists::list_count() const
+  {
+    size_t count = 0;
+    for (size_t i = 0; i < shard_count_; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      count += shards_[i].lists.size();
+    }
+    return count;
+  }
+
+  void TodoLists::set_observer(Observer observer)
+  {
+    for (size_t i = 0; i < shard_count_; ++i)
+    {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      shards_[i].observer = observer;
+    }
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,286 @@
+#include "todo_query.h"
+#include "memory_accounting.h"
+#include "task_pool.h"
+#include "todo_cold.h"
+#include "todo_store.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    // Rows per filter block. Each block is evaluated into a byte mask by
+    // branch-free loops the compiler can vectorize, then compacted.
+    constexpr size_t kBlockRows = 4096;
+
+    // Below this many rows a query is cheaper on the calling thread.
+    constexpr size_t kParallelRows = 64 * 1024;
+
+    std::mutex g_columns_mutex;
+    std::shared_ptr<const TodoColumns> g_columns;
+
+    int64_t column_bytes(const TodoColumns &columns)
+    {
+      return sizeof(TodoColumns) + columns.ids.capacity() + columns.dates.capacity() * sizeof(int64_t) +
+             columns.text_offsets.capacity() * sizeof(uint64_t) + columns.text.capacity();
+    }
+
+    void append_row(TodoColumns &columns, const unsigned char *id, int64_t date, std::string_view text)
+    {
+      columns.ids.insert(columns.ids.end(), id, id + sizeof(uuid_t));
+      columns.dates.push_back(date);
+      columns.text.append(text);
+      columns.text_offsets.push_back(columns.text.size());
+    }
+
+    // Accounted to Indexes for as long as a caller holds them.
+    std::shared_ptr<const TodoColumns> share(std::unique_ptr<TodoColumns> columns)
+    {
+      memory::add(memory::Component::Indexes, column_bytes(*columns));
+      return std::shared_ptr<const TodoColumns>(columns.release(), [](const TodoColumns *owned)
+                                                {
+        memory::add(memory::Component::Indexes, -column_bytes(*owned));
+        delete owned; });
+    }
+
+    struct DateKey
+    {
+      int64_t date;
+      uint32_t row;
+    };
+
+    void filter_block(const TodoColumns &columns, const TodoQuery &query,
+                      size_t begin, size_t end, std::vector<uint32_t> &out)
+    {
+      uint8_t mask[kBlockRows];
+      const size_t count = end - begin;
+      const int64_t *dates = columns.dates.data() + begin;
+      const int64_t from = query.from;
+      const int64_t to = query.to;
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        mask[i] = static_cast<uint8_t>((dates[i] >= from) & (dates[i] <= to));
+      }
+
+      if (!query.prefix.empty())
+      {
+        const char *text = columns.text.data();
+        const uint64_t *offsets = columns.text_offsets.data() + begin;
+        const char *prefix = query.prefix.data();
+        const size_t length = query.prefix.size();
+        const char first = prefix[0];
+
+        for (size_t i = 0; i < count; ++i)
+        {
+          if (!mask[i])
+            continue;
+          const size_t size = offsets[i + 1] - offsets[i];
+          const char *candidate = text + offsets[i];
+          mask[i] = size >= length && candidate[0] == first &&
+                    memcmp(candidate, prefix, length) == 0;
+        }
+      }
+
+      size_t base = out.size();
+      out.resize(base + count);
+      uint32_t *selected = out.data() + base;
+      size_t matched = 0;
+      for (size_t i = 0; i < count; ++i)
+      {
+        selected[matched] = static_cast<uint32_t>(begin + i);
+        matched += mask[i];
+      }
+      out.resize(base + matched);
+    }
+
+    std::vector<uint32_t> filter_rows(const TodoColumns &columns, const TodoQuery &query)
+    {
+      const size_t n = columns.size();
+      if (n < kParallelRows)
+      {
+        std::vector<uint32_t> rows;
+        rows.reserve(n);
+        for (size_t begin = 0; begin < n; begin += kBlockRows)
+        {
+          filter_block(columns, query, begin, std::min(n, begin + kBlockRows), rows);
+        }
+        return rows;
+      }
+
+      return TaskPool::shared().parallel_reduce(
+          n, kBlockRows * 4, std::vector<uint32_t>(),
+          [&](size_t begin, size_t end)
+          {
+            std::vector<uint32_t> rows;
+            rows.reserve(end - begin);
+            for (size_t block = begin; block < end; block += kBlockRows)
+            {
+              filter_block(columns, query, block, std::min(end, block + kBlockRows), rows);
+            }
+            return rows;
+          },
+          [](std::vector<uint32_t> left, std::vector<uint32_t> right)
+          {
+            left.insert(left.end(), right.begin(), right.end());
+            return left;
+          });
+    }
+
+    // Full sorts of large inputs go to the pool; top-k uses a partial sort
+    // so only `limit` elements are ever fully ordered.
+    template <typename T, typename Compare>
+    void order(std::vector<T> &values, size_t limit, Compare cmp)
+    {
+      if (limit < values.size() / 2)
+      {
+        std::partial_sort(values.begin(), values.begin() + limit, values.end(), cmp);
+        values.resize(limit);
+        return;
+      }
+
+      if (values.size() >= kParallelRows)
+      {
+        parallel_sort(TaskPool::shared(), values.begin(), values.end(), cmp);
+      }
+      else
+      {
+        std::stable_sort(values.begin(), values.end(), cmp);
+      }
+      if (values.size() > limit)
+        values.resize(limit);
+    }
+  }
+
+  std::shared_ptr<const TodoColumns> todo_columns()
+  {
+    std::lock_guard<std::mutex> lock(g_columns_mutex);
+
+    TodoReadGuard snapshot;
+    if (g_columns && g_columns->version == snapshot->version())
+      return g_columns;
+
+    auto columns = std::make_unique<TodoColumns>();
+    columns->version = snapshot->version();
+    columns->ids.resize(snapshot->size() * sizeof(uuid_t));
+    columns->dates.reserve(snapshot->size());
+    columns->text_offsets.reserve(snapshot->size() + 1);
+    columns->text_offsets.push_back(0);
+
+    size_t row = 0;
+    snapshot->for_each([&](const TodoItem &todo)
+                       {
+      memcpy(&columns->ids[row++ * sizeof(uuid_t)], todo.id, sizeof(uuid_t));
+      columns->dates.push_back(todo.date);
+      columns->text.append(todo.text);
+      columns->text_offsets.push_back(columns->text.size()); });
+
+    g_columns = share(std::move(columns));
+    return g_columns;
+  }
+
+  void release_todo_columns()
+  {
+    std::lock_guard<std::mutex> lock(g_columns_mutex);
+    g_columns.reset();
+  }
+
+  std::vector<uint32_t> run_query(const TodoColumns &columns, const TodoQuery &query)
+  {
+    std::vector<uint32_t> rows = filter_rows(columns, query);
+
+    switch (query.sort_by)
+    {
+    case TodoSortBy::None:
+      if (rows.size() > query.limit)
+        rows.resize(query.limit);
+      break;
+
+    case TodoSortBy::DateAscending:
+    case TodoSortBy::DateDescending:
+    {
+      // Sort (date, row) pairs rather than rows so comparisons stay within
+      // one contiguous array instead of chasing into the date column.
+      std::vector<DateKey> keys(rows.size());
+      for (size_t i = 0; i < rows.size(); ++i)
+      {
+        keys[i] = {columns.dates[rows[i]], rows[i]};
+      }
+
+      if (query.sort_by == TodoSortBy::DateAscending)
+      {
+        order(keys, query.limit, [](const DateKey &a, const DateKey &b)
+              { return a.date < b.date || (a.date == b.date && a.row < b.row); });
+      }
+      else
+      {
+        order(keys, query.limit, [](const DateKey &a, const DateKey &b)
+              { return a.date > b.date || (a.date == b.date && a.row < b.row); });
+      }
+
+      rows.resize(keys.size());
+      for (size_t i = 0; i < keys.size(); ++i)
+      {
+        rows[i] = keys[i].row;
+      }
+      break;
+    }
+
+    case TodoSortBy::Text:
+      order(rows, query.limit, [&columns](uint32_t a, uint32_t b)
+            {
+        int cmp = columns.text_at(a).compare(columns.text_at(b));
+        return cmp < 0 || (cmp == 0 && a < b); });
+      break;
+    }
+
+    return rows;
+  }
+
+  TodoQueryResult query_todos(const TodoQuery &query)
+  {
+    std::shared_ptr<const TodoColumns> hot;
+    std::vector<TodoItem> frozen;
+    read_both_tiers([&]()
+                    {
+      hot = todo_columns();
+      frozen.clear(); },
+                    query.from, query.to, [&](const TodoItem &todo)
+                    {
+      if (todo.text.compare(0, query.prefix.size(), query.prefix) == 0)
+        frozen.push_back(todo); });
+    if (frozen.empty())
+      return {hot, run_query(*hot, query)};
+
+    // Filter the hot rows, then order them together with the frozen matches.
+    TodoQuery filter = query;
+    filter.sort_by = TodoSortBy::None;
+    filter.limit = std::numeric_limits<size_t>::max();
+    std::vector<uint32_t> matches = run_query(*hot, filter);
+
+    auto merged = std::make_unique<TodoColumns>();
+    merged->version = hot->version;
+    merged->dates.reserve(matches.size() + frozen.size());
+    merged->text_offsets.reserve(matches.size() + frozen.size() + 1);
+    merged->text_offsets.push_back(0);
+    for (uint32_t row : matches)
+    {
+      append_row(*merged, &hot->ids[row * sizeof(uuid_t)], hot->dates[row], hot->text_at(row));
+    }
+    for (const TodoItem &todo : frozen)
+    {
+      append_row(*merged, todo.id, todo.date, todo.text);
+    }
+
+    TodoQuery order;
+    order.sort_by = query.sort_by;
+    order.limit = query.limit;
+    std::shared_ptr<const TodoColumns> columns = share(std::move(merged));
+    std::vector<uint32_t> rows = run_query(*columns, order);
+    return {std::move(columns), std::move(rows)};
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,320 @@
+#include "todo_replica.h"
+#include "memory_accounting.h"
+#include "varint.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    enum Field : uint8_t
+    {
+      kText = 1,
+      kDate = 2,
+      kDeleted = 4,
+      kCreated = 8
+    };
+
+    // Node of an unordered_map: the entry plus the bucket chain pointer.
+    constexpr int64_t kNodeBytes = 2 * sizeof(void *);
+
+    int64_t system_ms()
+    {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::system_clock::now().time_since_epoch())
+          .count();
+    }
+
+    int64_t text_bytes(const std::string &text)
+    {
+      return text.capacity() > std::string().capacity() ? static_cast<int64_t>(text.capacity() + 1) : 0;
+    }
+  }
+
+  // Ids are random, so their first eight bytes are a good hash.
+  size_t TodoReplica::TodoIdHash::operator()(const TodoId &id) const
+  {
+    uint64_t hash;
+    memcpy(&hash, id.data(), sizeof(hash));
+    return static_cast<size_t>(hash);
+  }
+
+  TodoReplica::TodoReplica(uint64_t replica_id, WallClock clock)
+      : id_(replica_id), clock_(clock ? std::move(clock) : WallClock(system_ms))
+  {
+    while (id_ == 0)
+    {
+      uuid_t random;
+      uuid_generate_random(random);
+      memcpy(&id_, random, sizeof(id_));
+    }
+  }
+
+  TodoReplica::~TodoReplica()
+  {
+    for (auto &origin : log_)
+    {
+      for (auto &op : origin.second)
+        account(op, -1);
+    }
+    for (auto &entry : todos_)
+    {
+      memory::add(memory::Component::Items, -static_cast<int64_t>(sizeof(Todo)));
+      memory::add(memory::Component::Text, -text_bytes(entry.second.item.text));
+      memory::add(memory::Component::Indexes, -static_cast<int64_t>(sizeof(TodoId) + kNodeBytes));
+    }
+  }
+
+  // Never behind the wall clock, and always ahead of every stamp this
+  // replica has issued or merged, so local edits beat what they replace
+  // even when the wall clock is behind another replica's.
+  uint64_t TodoReplica::tick()
+  {
+    uint64_t physical = static_cast<uint64_t>(std::max<int64_t>(clock_(), 1)) << 16;
+    last_stamp_ = std::max(physical, last_stamp_ + 1);
+    return last_stamp_;
+  }
+
+  void TodoReplica::account(const Operation &op, int64_t sign)
+  {
+    memory::add(memory::Component::Items, sign * static_cast<int64_t>(sizeof(Operation)));
+    memory::add(memory::Component::Text, sign * text_bytes(op.text));
+  }
+
+  void TodoReplica::record(Operation op)
+  {
+    op.origin = id_;
+    op.time = tick();
+    apply(op);
+    account(op, 1);
+    log_[id_].push_back(std::move(op));
+    ++operations_;
+  }
+
+  void TodoReplica::apply(const Operation &op)
+  {
+    auto [it, inserted] = todos_.try_emplace(op.id);
+    Todo &todo = it->second;
+    if (inserted)
+    {
+      memcpy(todo.item.id, op.id.data(), sizeof(uuid_t));
+      todo.item.date = 0;
+      memory::add(memory::Component::Items, sizeof(Todo));
+      memory::add(memory::Component::Indexes, sizeof(TodoId) + kNodeBytes);
+    }
+
+    bool was_live = todo.created && !todo.deleted;
+    Stamp stamp{op.time, op.origin};
+    // The earliest create wins, so that creation order does not depend on
+    // the order operations arrive in.
+    if ((op.fields & kCreated) && (!todo.created || stamp < todo.created))
+      todo.created = stamp;
+    if ((op.fields & kText) && todo.text < stamp)
+    {
+      int64_t before = text_bytes(todo.item.text);
+      todo.item.text = op.text;
+      memory::add(memory::Component::Text, text_bytes(todo.item.text) - before);
+      todo.text = stamp;
+    }
+    if ((op.fields & kDate) && todo.date < stamp)
+    {
+      todo.item.date = op.date;
+      todo.date = stamp;
+    }
+    if ((op.fields & kDeleted) && todo.deleted < stamp)
+      todo.deleted = stamp;
+
+    bool live = todo.created && !todo.deleted;
+    if (live != was_live)
+      live ? ++live_ : --live_;
+  }
+
+  TodoItem TodoReplica::add(const std::string &text, int64_t date)
+  {
+    Operation op{};
+    uuid_t id;
+    uuid_generate(id);
+    memcpy(op.id.data(), id, sizeof(uuid_t));
+    op.fields = kCreated | kText | kDate;
+    op.text = text;
+    op.date = date;
+    TodoId key = op.id;
+    record(std::move(op));
+    return todos_.at(key).item;
+  }
+
+  bool TodoReplica::update(const uuid_t id, const std::optional<std::string> &text, std::optional<int64_t> date)
+  {
+    Operation op{};
+    memcpy(op.id.data(), id, sizeof(uuid_t));
+    auto found = todos_.find(op.id);
+    if (found == todos_.end() || !found->second.created || found->second.deleted)
+      return false;
+    if (!text && !date)
+      return true;
+
+    if (text)
+    {
+      op.fields |= kText;
+      op.text = *text;
+    }
+    if (date)
+    {
+      op.fields |= kDate;
+      op.date = *date;
+    }
+    record(std::move(op));
+    return true;
+  }
+
+  bool TodoReplica::remove(const uuid_t id)
+  {
+    Operation op{};
+    memcpy(op.id.data(), id, sizeof(uuid_t));
+    auto found = todos_.find(op.id);
+    if (found == todos_.end() || !found->second.created || found->second.deleted)
+      return false;
+
+    op.fields = kDeleted;
+    record(std::move(op));
+    return true;
+  }
+
+  std::vector<TodoItem> TodoReplica::items() const
+  {
+    std::vector<const Todo *> live;
+    live.reserve(live_);
+    for (auto &entry : todos_)
+    {
+      if (entry.second.created && !entry.second.deleted)
+        live.push_back(&entry.second);
+    }
+    std::sort(live.begin(), live.end(), [](const Todo *a, const Todo *b)
+              { return a->created < b->created; });
+
+    std::vector<TodoItem> result;
+    result.reserve(live.size());
+    for (const Todo *todo : live)
+      result.push_back(todo->item);
+    return result;
+  }
+
+  std::string TodoReplica::summary() const
+  {
+    std::string out;
+    put_varint(out, log_.size());
+    for (auto &origin : log_)
+    {
+      put_fixed64(out, origin.first);
+      put_varint(out, origin.second.size());
+    }
+    return out;
+  }
+
+  std::string TodoReplica::deltas_since(std::string_view summary) const
+  {
+    ByteReader reader(summary, "Malformed replica summary");
+    std::unordered_map<uint64_t, uint64_t> known;
+    for (uint64_t count = reader.varint(); count > 0; --count)
+    {
+      uint64_t origin = reader.fixed64();
+      known[origin] = reader.varint();
+    }
+    if (!reader.done())
+      throw std::runtime_error("Malformed replica summary");
+
+    std::string groups;
+    uint64_t group_count = 0;
+    for (auto &origin : log_)
+    {
+      auto remote = known.find(origin.first);
+      size_t first = remote == known.end() ? 0 : remote->second;
+      if (first >= origin.second.size())
+        continue;
+
+      ++group_count;
+      put_fixed64(groups, origin.first);
+      put_varint(groups, first + 1);
+      put_varint(groups, origin.second.size() - first);
+      uint64_t previous = 0;
+      for (size_t i = first; i < origin.second.size(); ++i)
+      {
+        const Operation &op = origin.second[i];
+        groups.push_back(static_cast<char>(op.fields));
+        put_varint(groups, op.time - previous);
+        previous = op.time;
+        groups.append(reinterpret_cast<const char *>(op.id.data()), op.id.size());
+        if (op.fields & kText)
+        {
+          put_varint(groups, op.text.size());
+          groups.append(op.text);
+        }
+        if (op.fields & kDate)
+          put_varint(groups, zigzag(op.date));
+      }
+    }
+
+    std::string out;
+    put_varint(out, group_count);
+    out.append(groups);
+    return out;
+  }
+
+  TodoMergeResult TodoReplica::merge(std::string_view deltas)
+  {
+    ByteReader reader(deltas, "Malformed replica deltas");
+    TodoMergeResult result{};
+    for (uint64_t groups = reader.varint(); groups > 0; --groups)
+    {
+      uint64_t origin = reader.fixed64();
+      uint64_t sequence = reader.varint();
+      uint64_t count = reader.varint();
+      if (sequence == 0)
+        throw std::runtime_error("Malformed replica deltas");
+
+      std::deque<Operation> &log = log_[origin];
+      uint64_t time = 0;
+      for (; count > 0; --count, ++sequence)
+      {
+        Operation op{};
+        op.origin = origin;
+        op.fields = reader.byte();
+        if (op.fields == 0 || op.fields > (kText | kDate | kDeleted | kCreated))
+          throw std::runtime_error("Malformed replica deltas");
+        time += reader.varint();
+        op.time = time;
+        memcpy(op.id.data(), reader.bytes(op.id.size()).data(), op.id.size());
+        if (op.fields & kText)
+          op.text = std::string(reader.bytes(reader.varint()));
+        if (op.fields & kDate)
+          op.date = unzigzag(reader.varint());
+
+        if (sequence <= log.size())
+        {
+          ++result.duplicates;
+          continue;
+        }
+        if (sequence > log.size() + 1)
+        {
+          ++result.deferred;
+          continue;
+        }
+
+        last_stamp_ = std::max(last_stamp_, op.time);
+        apply(op);
+        account(op, 1);
+        log.push_back(std::move(op));
+        ++operations_;
+        ++result.applied;
+      }
+    }
+    if (!reader.done())
+      throw std::runtime_error("Malformed replica deltas");
+    return result;
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,535 @@
+#include "todo_store.h"
+#include "cpp_code.h"
+#include "json_escape.h"
+#include "memory_accounting.h"
+#include "todo_cold.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cpp_code
+{
+
+  std::string TodoItem::toJson() const
+  {
+    char uuid_str[37];
+    uuid_unparse(id, uuid_str);
+    std::string json = "{\"id\":\"";
+    json += uuid_str;
+    json += "\",\"text\":\"";
+    append_json_escaped(json, text);
+    json += "\",\"date\":" + std::to_string(date) + "}";
+    return json;
+  }
+
+  TodoChunk::~TodoChunk()
+  {
+    memory::add(memory::Component::Items, -accounted_items);
+    memory::add(memory::Component::Text, -accounted_text);
+  }
+
+  TodoSnapshot::TodoSnapshot(const TodoSnapshot &other)
+      : version_(other.version_), size_(other.size_), chunks_(other.chunks_), starts_(other.starts_)
+  {
+  }
+
+  TodoSnapshot::~TodoSnapshot()
+  {
+    memory::add(memory::Component::Indexes, -accounted_);
+  }
+
+  size_t TodoSnapshot::chunk_of(size_t index) const
+  {
+    return std::upper_bound(starts_.begin(), starts_.end(), index) - starts_.begin() - 1;
+  }
+
+  const TodoItem &TodoSnapshot::operator[](size_t index) const
+  {
+    size_t chunk = chunk_of(index);
+    return chunks_[chunk]->items[index - starts_[chunk]];
+  }
+
+  // Global state
+  namespace
+  {
+    // Chunks are split when they grow past this size and merged with a
+    // neighbour when deletions leave both below half of it.
+    constexpr size_t kChunkItems = 512;
+
+    TodoCallback g_todoAddedCallback;
+    TodoCallback g_todoUpdatedCallback;
+    TodoCallback g_todoDeletedCallback;
+
+    EpochDomain g_epochs;
+    std::atomic<const TodoSnapshot *> g_current{new TodoSnapshot()};
+    std::mutex g_write_mutex;
+    // Odd while the cold tier changes, when a todo moves between the tiers
+    // or a frozen one is deleted; see read_both_tiers().
+    std::atomic<uint64_t> g_cold_changes{0};
+
+    constexpr int kFreezeAttempts = 3;
+
+    // Brackets a change of the cold tier. Only used with g_write_mutex held.
+    class ColdChange
+    {
+    public:
+      ColdChange() { g_cold_changes.fetch_add(1); }
+      ~ColdChange() { g_cold_changes.fetch_add(1); }
+    };
+
+    // Copy-on-write so notifying never holds a lock or copies the list.
+    std::mutex g_observers_mutex;
+    std::shared_ptr<const std::vector<std::pair<int, TodoObserver>>> g_observers =
+        std::make_shared<std::vector<std::pair<int, TodoObserver>>>();
+    int g_next_observer_id = 1;
+  }
+
+  // Builds new versions. Only used with g_write_mutex held, so the current
+  // version cannot change underneath it.
+  class TodoStoreWriter
+  {
+  public:
+    explicit TodoStoreWriter(const TodoSnapshot &base)
+        : next_(new TodoSnapshot(base))
+    {
+      ++next_->version_;
+    }
+
+    ~TodoStoreWriter() { delete next_; }
+
+    static TodoSnapshot *copy(const TodoSnapshot &snapshot)
+    {
+      auto *pinned = new TodoSnapshot(snapshot);
+      account(*pinned);
+      return pinned;
+    }
+
+    bool find(const uuid_t id, size_t &chunk, size_t &offset) const
+    {
+      for (chunk = 0; chunk < next_->chunks_.size(); ++chunk)
+      {
+        auto &items = next_->chunks_[chunk]->items;
+        for (offset = 0; offset < items.size(); ++offset)
+        {
+          if (uuid_compare(items[offset].id, id) == 0)
+            return true;
+        }
+      }
+      return false;
+    }
+
+    const TodoItem &at(size_t chunk, size_t offset) const { return next_->chunks_[chunk]->items[offset]; }
+
+    void append(const TodoItem &todo)
+    {
+      auto &chunks = next_->chunks_;
+      if (chunks.empty() || chunks.back()->items.size() >= kChunkItems)
+      {
+        chunks.push_back(std::make_shared<TodoChunk>());
+      }
+      auto chunk = std::make_shared<TodoChunk>(*chunks.back());
+      chunk->items.push_back(todo);
+      chunks.back() = std::move(chunk);
+    }
+
+    void replace(size_t chunk, size_t offset, const std::string &text, int64_t date)
+    {
+      auto copy = std::make_shared<TodoChunk>(*next_->chunks_[chunk]);
+      copy->items[offset].text = text;
+      copy->items[offset].date = date;
+      next_->chunks_[chunk] = std::move(copy);
+    }
+
+    void erase(size_t chunk, size_t offset)
+    {
+      auto &chunks = next_->chunks_;
+      auto copy = std::make_shared<TodoChunk>(*chunks[chunk]);
+      copy->items.erase(copy->items.begin() + offset);
+
+      if (chunk + 1 < chunks.size() &&
+          copy->items.size() + chunks[chunk + 1]->items.size() <= kChunkItems / 2)
+      {
+        auto &next = chunks[chunk + 1]->items;
+        copy->items.insert(copy->items.end(), next.begin(), next.end());
+        chunks.erase(chunks.begin() + chunk + 1);
+      }
+
+      if (copy->items.empty())
+      {
+        chunks.erase(chunks.begin() + chunk);
+      }
+      else
+      {
+        chunks[chunk] = std::move(copy);
+      }
+    }
+
+    // Drops every item matching `pred`. Chunks without a match are shared;
+    // the survivors of the others are packed into new chunks in list order.
+    template <typename Pred>
+    void remove_if(Pred pred)
+    {
+      std::vector<std::shared_ptr<const TodoChunk>> chunks;
+      std::shared_ptr<TodoChunk> packed;
+      auto flush = [&]()
+      {
+        if (packed && !packed->items.empty())
+          chunks.push_back(std::move(packed));
+        packed.reset();
+      };
+
+      for (auto &chunk : next_->chunks_)
+      {
+        if (std::none_of(chunk->items.begin(), chunk->items.end(), pred))
+        {
+          flush();
+          chunks.push_back(chunk);
+          continue;
+        }
+
+        for (auto &item : chunk->items)
+        {
+          if (pred(item))
+            continue;
+          if (!packed)
+            packed = std::make_shared<TodoChunk>();
+          packed->items.push_back(item);
+          if (packed->items.size() >= kChunkItems)
+            flush();
+        }
+      }
+      flush();
+      next_->chunks_ = std::move(chunks);
+    }
+
+    // Makes the new version visible to readers and retires the old one.
+    void publish()
+    {
+      auto &starts = next_->starts_;
+      starts.resize(next_->chunks_.size());
+      size_t size = 0;
+      for (size_t i = 0; i < next_->chunks_.size(); ++i)
+      {
+        starts[i] = size;
+        size += next_->chunks_[i]->items.size();
+      }
+      next_->size_ = size;
+
+      // Chunks shared with the previous version were accounted with it.
+      for (auto &chunk : next_->chunks_)
+      {
+        if (chunk->accounted_items == 0)
+          account(*chunk);
+      }
+      account(*next_);
+
+      const TodoSnapshot *old = g_current.exchange(next_, std::memory_order_seq_cst);
+      next_ = nullptr;
+      g_epochs.retire(const_cast<TodoSnapshot *>(old), [](void *snapshot)
+                      { delete static_cast<TodoSnapshot *>(snapshot); });
+    }
+
+  private:
+    static void account(const TodoChunk &chunk)
+    {
+      // Text that fits the small-string buffer is part of the item itself.
+      const size_t inline_capacity = std::string().capacity();
+      int64_t text = 0;
+      for (auto &item : chunk.items)
+      {
+        if (item.text.capacity() > inline_capacity)
+          text += item.text.capacity() + 1;
+      }
+      chunk.accounted_items = sizeof(TodoChunk) + chunk.items.capacity() * sizeof(TodoItem);
+      chunk.accounted_text = text;
+      memory::add(memory::Component::Items, chunk.accounted_items);
+      memory::add(memory::Component::Text, text);
+    }
+
+    static void account(TodoSnapshot &snapshot)
+    {
+      snapshot.accounted_ = sizeof(TodoSnapshot) +
+                            snapshot.chunks_.capacity() * sizeof(snapshot.chunks_[0]) +
+                            snapshot.starts_.capacity() * sizeof(size_t);
+      memory::add(memory::Component::Indexes, snapshot.accounted_);
+    }
+
+    TodoSnapshot *next_;
+  };
+
+  // Helper functions
+  static void notify_callback(const TodoCallback &callback, const TodoItem &todo)
+  {
+    if (callback)
+    {
+      std::string json;
+      {
+        trace::Span span("store.serialize");
+        json = todo.toJson();
+      }
+      callback(json);
+    }
+  }
+
+  static void notify_change(TodoChange change, const TodoItem &todo)
+  {
+    trace::Span span("store.notify");
+    std::shared_ptr<const std::vector<std::pair<int, TodoObserver>>> observers;
+    {
+      std::lock_guard<std::mutex> lock(g_observers_mutex);
+      observers = g_observers;
+    }
+    for (auto &entry : *observers)
+    {
+      entry.second(change, todo);
+    }
+
+    switch (change)
+    {
+    case TodoChange::Added:
+      notify_callback(g_todoAddedCallback, todo);
+      break;
+    case TodoChange::Updated:
+      notify_callback(g_todoUpdatedCallback, todo);
+      break;
+    case TodoChange::Deleted:
+      notify_callback(g_todoDeletedCallback, todo);
+      break;
+    }
+  }
+
+  TodoItem add_todo(const std::string &text, int64_t date)
+  {
+    trace::Span span("store.add_todo");
+    TodoItem todo;
+    uuid_generate(todo.id);
+    todo.text = text;
+    todo.date = date;
+
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    TodoStoreWriter writer(*g_current.load(std::memory_order_relaxed));
+    writer.append(todo);
+    writer.publish();
+
+    notify_change(TodoChange::Added, todo);
+    return todo;
+  }
+
+  bool update_todo(const uuid_t id, const std::string &text, int64_t date)
+  {
+    trace::Span span("store.update_todo");
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    TodoStoreWriter writer(*g_current.load(std::memory_order_relaxed));
+    size_t chunk, offset;
+    if (writer.find(id, chunk, offset))
+    {
+      writer.replace(chunk, offset, text, date);
+      TodoItem updated = writer.at(chunk, offset);
+      writer.publish();
+
+      notify_change(TodoChange::Updated, updated);
+      return true;
+    }
+
+    // Thaw a frozen todo. It is published before it leaves the cold tier so
+    // that find_todo() never misses it.
+    TodoItem updated;
+    if (!cold::find(id, updated))
+      return false;
+    updated.text = text;
+    updated.date = date;
+    {
+      ColdChange change;
+      writer.append(updated);
+      writer.publish();
+      TodoItem frozen;
+      cold::take(id, frozen);
+    }
+
+    notify_change(TodoChange::Updated, updated);
+    return true;
+  }
+
+  bool delete_todo(const uuid_t id)
+  {
+    trace::Span span("store.delete_todo");
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    TodoStoreWriter writer(*g_current.load(std::memory_order_relaxed));
+    size_t chunk, offset;
+    TodoItem deleted;
+    if (writer.find(id, chunk, offset))
+    {
+      deleted = writer.at(chunk, offset);
+      writer.erase(chunk, offset);
+      writer.publish();
+    }
+    else
+    {
+      ColdChange change;
+      if (!cold::take(id, deleted))
+        return false;
+    }
+
+    notify_change(TodoChange::Deleted, deleted);
+    return true;
+  }
+
+  size_t freeze_todos_before(int64_t cutoff)
+  {
+    // Compressing allocates, which can cross the soft limit and queue
+    // shed_memory(), and takes long enough to stall writers, so the blocks
+    // are built from a read snapshot before taking the write mutex. They are
+    // only used if the todos to freeze are still the same; after a few
+    // misses the last attempt builds them with the mutex held.
+    for (int attempt = 1;; ++attempt)
+    {
+      const bool last = attempt == kFreezeAttempts;
+      std::unique_lock<std::mutex> lock(g_write_mutex, std::defer_lock);
+      if (last)
+        lock.lock();
+
+      std::vector<TodoItem> frozen;
+      {
+        TodoReadGuard snapshot;
+        snapshot->for_each([&](const TodoItem &todo)
+                           {
+          if (todo.date < cutoff)
+            frozen.push_back(todo); });
+      }
+      if (frozen.empty())
+        return 0;
+      std::shared_ptr<cold::Batch> batch = cold::build(frozen);
+
+      if (!last)
+        lock.lock();
+      const TodoSnapshot &current = *g_current.load(std::memory_order_relaxed);
+      size_t matched = 0;
+      bool same = true;
+      current.for_each([&](const TodoItem &todo)
+                       {
+        if (todo.date >= cutoff || !same)
+          return;
+        same = matched < frozen.size() && uuid_compare(todo.id, frozen[matched].id) == 0 &&
+               todo.date == frozen[matched].date && todo.text == frozen[matched].text;
+        ++matched; });
+      if (!same || matched != frozen.size())
+        continue;
+
+      // Into the cold tier before leaving the hot one, so that find_todo()
+      // never misses them.
+      ColdChange change;
+      cold::insert(std::move(batch));
+
+      TodoStoreWriter writer(current);
+      writer.remove_if([cutoff](const TodoItem &todo)
+                       { return todo.date < cutoff; });
+      writer.publish();
+      return frozen.size();
+    }
+  }
+
+  void read_both_tiers(const std::function<void()> &pin, int64_t from, int64_t to,
+                       const std::function<void(const TodoItem &)> &fn)
+  {
+    uint64_t cold_version = ~uint64_t(0);
+    read_changed_tiers(cold_version, pin, [&]()
+                       { scan_cold_todos(from, to, fn); });
+  }
+
+  bool read_changed_tiers(uint64_t &cold_version, const std::function<void()> &pin,
+                          const std::function<void()> &cold)
+  {
+    for (;;)
+    {
+      uint64_t changes = g_cold_changes.load();
+      if (changes & 1)
+      {
+        // Changes run under the write mutex; wait for this one to finish.
+        std::lock_guard<std::mutex> wait(g_write_mutex);
+        continue;
+      }
+      pin();
+      bool changed = changes != cold_version;
+      if (changed)
+        cold();
+      if (g_cold_changes.load() == changes)
+      {
+        cold_version = changes;
+        return changed;
+      }
+    }
+  }
+
+  std::vector<TodoItem> list_todos()
+  {
+    // Serialized with freezes, which briefly hold a todo in both tiers.
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    TodoReadGuard snapshot;
+    std::vector<TodoItem> todos;
+    todos.reserve(snapshot->size());
+    snapshot->for_each([&todos](const TodoItem &todo)
+                       { todos.push_back(todo); });
+    cold::for_each([&todos](const TodoItem &todo)
+                   { todos.push_back(todo); });
+    return todos;
+  }
+
+  TodoReadGuard::TodoReadGuard()
+      : guard_(g_epochs), snapshot_(g_current.load(std::memory_order_seq_cst))
+  {
+  }
+
+  std::shared_ptr<const TodoSnapshot> pin_todos()
+  {
+    TodoReadGuard snapshot;
+    return std::shared_ptr<const TodoSnapshot>(TodoStoreWriter::copy(*snapshot));
+  }
+
+  int add_todo_observer(TodoObserver observer)
+  {
+    std::lock_guard<std::mutex> lock(g_observers_mutex);
+    auto next = std::make_shared<std::vector<std::pair<int, TodoObserver>>>(*g_observers);
+    int id = g_next_observer_id++;
+    next->emplace_back(id, std::move(observer));
+    g_observers = std::move(next);
+    return id;
+  }
+
+  // Observers run under the write mutex, so taking it waits for a running
+  // notification to finish.
+  void remove_todo_observer(int id)
+  {
+    std::lock_guard<std::mutex> write_lock(g_write_mutex);
+    std::lock_guard<std::mutex> lock(g_observers_mutex);
+    auto next = std::make_shared<std::vector<std::pair<int, TodoObserver>>>(*g_observers);
+    next->erase(std::remove_if(next->begin(), next->end(), [id](const std::pair<int, TodoObserver> &entry)
+                               { return entry.first == id; }),
+                next->end());
+    g_observers = std::move(next);
+  }
+
+  // Callbacks run under the write mutex, so once a setter returns the
+  // previous callback is not running and is never called again.
+  void setTodoAddedCallback(TodoCallback callback)
+  {
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    g_todoAddedCallback = std::move(callback);
+  }
+
+  void setTodoUpdatedCallback(TodoCallback callback)
+  {
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    g_todoUpdatedCallback = std::move(callback);
+  }
+
+  void setTodoDeletedCallback(TodoCallback callback)
+  {
+    std::lock_guard<std::mutex> lock(g_write_mutex);
+    g_todoDeletedCallback = std::move(callback);
+  }
+
+} // namespace cpp_code
@@ -0,0 +1,260 @@
+#include "trace.h"
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace cpp_code
+{
+  namespace trace
+  {
+
+    std::atomic<bool> g_enabled{false};
+
+    namespace
+    {
+      // 32 bytes each, so a ring is 1 MB per thread that recorded anything.
+      constexpr uint64_t kEventsPerThread = 1 << 15;
+
+      enum Kind : uint32_t
+      {
+        kSpan,
+        kFlowBegin,
+        kFlowEnd
+      };
+
+      // Relaxed atomics, so dump() may copy a slot while its thread
+      // overwrites it; such copies are detected and dropped.
+      struct Event
+      {
+        std::atomic<const char *> name;
+        std::atomic<uint64_t> start;
+        // End of a span, id of a flow.
+        std::atomic<uint64_t> value;
+        std::atomic<uint32_t> kind;
+      };
+
+      struct ThreadBuffer
+      {
+        pid_t tid;
+        std::string thread_name;
+        // Session the events belong to; the owning thread rewinds the ring
+        // when it first records in a new one.
+        std::atomic<uint64_t> session{0};
+        // Events written this session. Only the owning thread stores it.
+        std::atomic<uint64_t> head{0};
+        std::unique_ptr<Event[]> events{new Event[kEventsPerThread]};
+      };
+
+      struct Registry
+      {
+        std::mutex mutex;
+        std::vector<ThreadBuffer *> buffers;
+      };
+
+      // Buffers outlive their threads, so a dump still shows threads that
+      // have exited; neither is ever freed.
+      Registry &registry()
+      {
+        static Registry *registry = new Registry;
+        return *registry;
+      }
+
+      std::atomic<uint64_t> g_session{0};
+      std::atomic<uint64_t> g_next_flow_id{1};
+      thread_local ThreadBuffer *t_buffer = nullptr;
+
+      ThreadBuffer *this_thread_buffer()
+      {
+        if (t_buffer)
+          return t_buffer;
+
+        auto *buffer = new ThreadBuffer;
+        buffer->tid = static_cast<pid_t>(syscall(SYS_gettid));
+        char name[16] = {};
+        if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0)
+          buffer->thread_name = name;
+
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.buffers.push_back(buffer);
+        t_buffer = buffer;
+        return buffer;
+      }
+
+      void record(Kind kind, const char *name, uint64_t start, uint64_t value)
+      {
+        ThreadBuffer *buffer = this_thread_buffer();
+        uint64_t session = g_session.load(std::memory_order_relaxed);
+        if (buffer->session.load(std::memory_order_relaxed) != session)
+        {
+          buffer->head.store(0, std::memory_order_relaxed);
+          buffer->session.store(session, std::memory_order_release);
+        }
+
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        Event &event = buffer->events[head % kEventsPerThread];
+        event.name.store(name, std::memory_order_relaxed);
+        event.start.store(start, std::memory_order_relaxed);
+        event.value.store(value, std::memory_order_relaxed);
+        event.kind.store(kind, std::memory_order_relaxed);
+        buffer->head.store(head + 1, std::memory_order_release);
+      }
+
+      struct Copy
+      {
+        const char *name;
+        uint64_t start;
+        uint64_t value;
+        uint32_t kind;
+      };
+
+      // Copies the events of the current session that were not overwritten
+      // while copying.
+      std::vector<Copy> copy_events(const ThreadBuffer &buffer, uint64_t session)
+      {
+        std::vector<Copy> copies;
+        if (buffer.session.load(std::memory_order_acquire) != session)
+          return copies;
+
+        uint64_t head = buffer.head.load(std::memory_order_acquire);
+        uint64_t first = head > kEventsPerThread ? head - kEventsPerThread : 0;
+        copies.reserve(head - first);
+        for (uint64_t i = first; i < head; ++i)
+        {
+          const Event &event = buffer.events[i % kEventsPerThread];
+          copies.push_back({event.name.load(std::memory_order_relaxed),
+                            event.start.load(std::memory_order_relaxed),
+                            event.value.load(std::memory_order_relaxed),
+                            event.kind.load(std::memory_order_relaxed)});
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (buffer.session.load(std::memory_order_relaxed) != session)
+          return {};
+        uint64_t after = buffer.head.load(std::memory_order_relaxed);
+        uint64_t valid = after > kEventsPerThread ? after - kEventsPerThread : 0;
+        if (valid > first)
+          copies.erase(copies.begin(), copies.begin() + std::min(valid - first, copies.size()));
+        return copies;
+      }
+
+      void write_escaped(FILE *file, const std::string &text)
+      {
+        for (char c : text)
+        {
+          if (c == '"' || c == '\\')
+            fputc('\\', file);
+          if (static_cast<unsigned char>(c) >= 0x20)
+            fputc(c, file);
+        }
+      }
+    }
+
+    uint64_t now_ns()
+    {
+      timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    void start()
+    {
+      g_session.fetch_add(1, std::memory_order_relaxed);
+      g_enabled.store(true, std::memory_order_relaxed);
+    }
+
+    void stop()
+    {
+      g_enabled.store(false, std::memory_order_relaxed);
+    }
+
+    void record_span(const char *name, uint64_t start_ns, uint64_t end_ns)
+    {
+      record(kSpan, name, start_ns, end_ns);
+    }
+
+    uint64_t new_flow_id()
+    {
+      return g_next_flow_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void flow_begin(const char *name, uint64_t id)
+    {
+      record(kFlowBegin, name, now_ns(), id);
+    }
+
+    void flow_end(const char *name, uint64_t id)
+    {
+      record(kFlowEnd, name, now_ns(), id);
+    }
+
+    size_t dump(const std::string &path)
+    {
+      std::vector<ThreadBuffer *> buffers;
+      {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        buffers = reg.buffers;
+      }
+
+      FILE *file = fopen(path.c_str(), "w");
+      if (!file)
+        throw std::runtime_error("Cannot open " + path + " for writing");
+
+      uint64_t session = g_session.load(std::memory_order_acquire);
+      int pid = static_cast<int>(getpid());
+      size_t written = 0;
+      const char *separator = "\n";
+
+      fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+      for (const ThreadBuffer *buffer : buffers)
+      {
+        std::vector<Copy> events = copy_events(*buffer, session);
+        if (events.empty())
+          continue;
+
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+                separator, pid, buffer->tid);
+        write_escaped(file, buffer->thread_name.empty() ? "thread" : buffer->thread_name);
+        fputs("\"}}", file);
+        separator = ",\n";
+
+        // Trace-event timestamps are microseconds; keep nanosecond precision.
+        for (const Copy &event : events)
+        {
+          double ts = event.start / 1000.0;
+          switch (event.kind)
+          {
+          case kSpan:
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"cpp\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                    event.name, ts, (event.value - event.start) / 1000.0, pid, buffer->tid);
+            break;
+          case kFlowBegin:
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"flow\",\"ph\":\"s\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+                    event.name, static_cast<unsigned long long>(event.value), ts, pid, buffer->tid);
+            break;
+          case kFlowEnd:
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"flow\",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu,\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+                    event.name, static_cast<unsigned long long>(event.value), ts, pid, buffer->tid);
+            break;
+          }
+          ++written;
+        }
+      }
+      fputs("\n]}\n", file);
+
+      bool failed = ferror(file) != 0;
+      if (fclose(file) != 0 || failed)
+        throw std::runtime_error("Failed to write " + path);
+      return written;
+    }
+
+  } // namespace trace
+} // namespace cpp_code
@@ -0,0 +1,121 @@
+// Throughput of the UTF-16 to UTF-8 paths on a few kinds of text. The code
+// is platform-independent, so this also builds and runs on Linux and macOS.
+// Run with `npm run bench`.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "utf_transcode.h"
+
+namespace {
+
+using cpp_code::Utf16Path;
+
+struct Corpus {
+  const char* name;
+  std::u16string text;
+};
+
+// `pick` returns one code point; astral ones are stored as surrogate pairs.
+template <typename Pick>
+std::u16string make_text(size_t units, Pick pick) {
+  std::mt19937 rng(42);
+  std::u16string text;
+  while (text.size() < units) {
+    char32_t cp = pick(rng);
+    if (cp >= 0x10000) {
+      text.push_back(static_cast<char16_t>(0xD800 + ((cp - 0x10000) >> 10)));
+      text.push_back(static_cast<char16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+    } else {
+      text.push_back(static_cast<char16_t>(cp));
+    }
+  }
+  return text;
+}
+
+std::vector<Corpus> make_corpora(size_t units) {
+  std::vector<Corpus> corpora;
+  corpora.push_back({"ascii", make_text(units, [](std::mt19937& rng) {
+                       return static_cast<char32_t>(0x20 + rng() % 0x5F);
+                     })});
+  corpora.push_back({"latin (10% accents)", make_text(units, [](std::mt19937& rng) {
+                       return static_cast<char32_t>(rng() % 10 ? 0x61 + rng() % 26 : 0xC0 + rng() % 0x40);
+                     })});
+  corpora.push_back({"cyrillic", make_text(units, [](std::mt19937& rng) {
+                       return static_cast<char32_t>(rng() % 6 ? 0x430 + rng() % 32 : 0x20);
+                     })});
+  corpora.push_back({"cjk", make_text(units, [](std::mt19937& rng) {
+                       return static_cast<char32_t>(0x4E00 + rng() % 0x5000);
+                     })});
+  corpora.push_back({"ascii + emoji", make_text(units, [](std::mt19937& rng) {
+                       return static_cast<char32_t>(rng() % 20 ? 0x20 + rng() % 0x5F : 0x1F600 + rng() % 0x50);
+                     })});
+  return corpora;
+}
+
+const char* path_name(Utf16Path path) {
+  switch (path) {
+  case Utf16Path::Scalar:
+    return "scalar";
+  case Utf16Path::Sse2:
+    return "sse2";
+  case Utf16Path::Avx2:
+    return "avx2";
+  }
+  return "?";
+}
+
+// `std::string(w.begin(), w.end())`, which is what the serialization did
+// before: one byte per unit, anything outside ASCII truncated.
+size_t narrow(const char16_t* in, size_t length, char* out) {
+  for (size_t i = 0; i < length; ++i) {
+    out[i] = static_cast<char>(in[i]);
+  }
+  return length;
+}
+
+} // namespace
+
+int main() {
+  const size_t units = 1 << 20;
+  const int iterations = 50;
+  std::vector<Corpus> corpora = make_corpora(units);
+  std::vector<char> out(cpp_code::utf8_bound(units + 1));
+  std::vector<char> expected(out.size());
+
+  std::printf("%-22s %-8s %10s\n", "text (1M units)", "path", "GB/s in");
+  for (const Corpus& corpus : corpora) {
+    const char16_t* in = corpus.text.data();
+    size_t length = corpus.text.size();
+    size_t expected_size = cpp_code::utf16_to_utf8(Utf16Path::Scalar, in, length, expected.data());
+
+    for (Utf16Path path : {Utf16Path::Scalar, Utf16Path::Sse2, Utf16Path::Avx2}) {
+      if (!cpp_code::utf16_path_supported(path)) continue;
+
+      size_t size = cpp_code::utf16_to_utf8(path, in, length, out.data());
+      if (size != expected_size || memcmp(out.data(), expected.data(), size) != 0) {
+        std::fprintf(stderr, "%s output differs from scalar on %s\n", path_name(path), corpus.name);
+        return 1;
+      }
+
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i) {
+        cpp_code::utf16_to_utf8(path, in, length, out.data());
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::printf("%-22s %-8s %10.2f\n", corpus.name, path_name(path),
+                  length * sizeof(char16_t) * iterations / seconds / 1e9);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      narrow(in, length, out.data());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%-22s %-8s %10.2f  (lossy)\n", corpus.name, "narrow",
+                length * sizeof(char16_t) * iterations / seconds / 1e9);
+  }
+  return 0;
+}
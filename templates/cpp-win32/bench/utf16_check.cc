@@ -0,0 +1,92 @@
+// Fixed UTF-16 inputs whose UTF-8 form is known, run through every path the
+// CPU supports. Each vector is also placed after prefixes of 0 to 40 units,
+// so its units land on every position of the 8-, 16- and 32-unit blocks the
+// vector paths take. Run with `npm test`.
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "utf_transcode.h"
+
+namespace {
+
+using cpp_code::Utf16Path;
+
+struct Vector {
+  const char* name;
+  std::u16string in;
+  std::string out;
+};
+
+const char* const kReplacement = "\xEF\xBF\xBD";
+
+std::vector<Vector> vectors() {
+  const std::string replacement = kReplacement;
+  return {
+      {"lone high surrogate", u"a\xD800" u"b", "a" + replacement + "b"},
+      {"lone high surrogate at the end", u"a\xD83D", "a" + replacement},
+      {"lone low surrogate", u"a\xDC00" u"b", "a" + replacement + "b"},
+      {"low before high", u"\xDE00\xD83D", replacement + replacement},
+      {"two high surrogates", u"\xD83D\xD83D\xDE00", replacement + "\xF0\x9F\x98\x80"},
+      {"surrogate pair", u"\xD83D\xDE00", "\xF0\x9F\x98\x80"},
+      {"U+FFFF", u"\xFFFF", "\xEF\xBF\xBF"},
+      {"U+10FFFF", u"\xDBFF\xDFFF", "\xF4\x8F\xBF\xBF"},
+      {"U+007F U+0080 U+07FF U+0800", u"\x007F\x0080\x07FF\x0800", "\x7F\xC2\x80\xDF\xBF\xE0\xA0\x80"},
+  };
+}
+
+// Prefixes of ASCII and of a two-byte letter, so the vector starts both on
+// the all-ASCII fast path and inside a block already being encoded.
+std::vector<Vector> prefixes() {
+  std::vector<Vector> result;
+  for (size_t length = 0; length <= 40; ++length) {
+    result.push_back({"ascii", std::u16string(length, u'x'), std::string(length, 'x')});
+    Vector accented{"accented", std::u16string(length, u'\x00E9'), ""};
+    for (size_t i = 0; i < length; ++i) accented.out += "\xC3\xA9";
+    result.push_back(accented);
+  }
+  return result;
+}
+
+const char* path_name(Utf16Path path) {
+  switch (path) {
+  case Utf16Path::Scalar:
+    return "scalar";
+  case Utf16Path::Sse2:
+    return "sse2";
+  case Utf16Path::Avx2:
+    return "avx2";
+  }
+  return "?";
+}
+
+} // namespace
+
+int main() {
+  size_t checked = 0;
+  size_t failed = 0;
+  for (Utf16Path path : {Utf16Path::Scalar, Utf16Path::Sse2, Utf16Path::Avx2}) {
+    if (!cpp_code::utf16_path_supported(path)) continue;
+
+    for (const Vector& vector : vectors()) {
+      for (const Vector& prefix : prefixes()) {
+        // Trailing ASCII too, so a pair is never split only by the input's end.
+        for (size_t tail : {0, 1, 17}) {
+          std::u16string in = prefix.in + vector.in + std::u16string(tail, u'y');
+          std::string expected = prefix.out + vector.out + std::string(tail, 'y');
+
+          std::string out(cpp_code::utf8_bound(in.size()), '\0');
+          out.resize(cpp_code::utf16_to_utf8(path, in.data(), in.size(), &out[0]));
+          ++checked;
+          if (out != expected) {
+            ++failed;
+            std::printf("%s: %s after %zu %s units, %zu after\n", path_name(path), vector.name, prefix.in.size(),
+                        prefix.name, tail);
+          }
+        }
+      }
+    }
+  }
+
+  std::printf("%zu of %zu transcodings wrong\n", failed, checked);
+  return failed == 0 ? 0 : 1;
+}
@@ -6,7 +6,8 @@
         ['OS=="win"', {
           "sources": [
             "src/cpp_addon.cc",
-            "src/cpp_code.cc"
+            "src/cpp_code.cc",
+            "src/utf_transcode.cc"
           ],
           "include_dirs": [
             "<!@(node -p \"require('node-addon-api').include\")",
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace cpp_code {
+
+// Upper bound on the UTF-8 bytes produced from `length` UTF-16 code units.
+inline size_t utf8_bound(size_t length)
+{
+  return 3 * length;
+}
+
+// Transcodes UTF-16 to UTF-8. Surrogate pairs become one four-byte sequence;
+// unpaired surrogates become U+FFFD. `out` must have room for
+// utf8_bound(length) bytes. Returns the number of bytes written.
+//
+// Uses AVX2 when the CPU has it, SSE2 on other x86 CPUs and portable scalar
+// code elsewhere; all paths produce identical output.
+size_t utf16_to_utf8(const char16_t *in, size_t length, char *out);
+
+// Appends the UTF-8 form of `in` to `out`.
+void append_utf8(std::string &out, const char16_t *in, size_t length);
+
+std::string utf16_to_utf8(const std::u16string &in);
+
+// The individual paths, for benchmarks. A path is only safe to call when
+// utf16_path_supported() says so.
+enum class Utf16Path
+{
+  Scalar,
+  Sse2,
+  Avx2
+};
+bool utf16_path_supported(Utf16Path path);
+size_t utf16_to_utf8(Utf16Path path, const char16_t *in, size_t length, char *out);
+
+} // namespace cpp_code
@@ -7,6 +7,7 @@
 #include <commctrl.h>
 #include <shellscalingapi.h>
 #include <thread>
+#include "utf_transcode.h"
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(linker, "\"/manifestdependency:type='win32' \
@@ -28,6 +29,24 @@ int64_t getCurrentTimeMillis()
       .count();
 }
 
+// wchar_t holds UTF-16 code units on Windows.
+static_assert(sizeof(wchar_t) == sizeof(char16_t), "wchar_t must be 16 bits");
+
+void AppendUtf8(std::string &out, const std::wstring &text)
+{
+  cpp_code::append_utf8(out, reinterpret_cast<const char16_t *>(text.data()), text.size());
+}
+
+std::string GuidToUtf8(const GUID &id)
+{
+  OLECHAR *guidString;
+  StringFromCLSID(id, &guidString);
+  std::string result;
+  cpp_code::append_utf8(result, reinterpret_cast<const char16_t *>(guidString), wcslen(guidString));
+  CoTaskMemFree(guidString);
+  return result;
+}
+
 struct TodoItem
 {
   GUID id;
@@ -36,20 +55,14 @@ struct TodoItem
 
   std::string toJson() const
   {
-    OLECHAR *guidString;
-    StringFromCLSID(id, &guidString);
-    std::wstring widGuid(guidString);
-    CoTaskMemFree(guidString);
-
-    // Convert wide string to narrow for JSON
-    std::string guidStr(widGuid.begin(), widGuid.end());
-    std::string textStr(text.begin(), text.end());
-
-    return "{"
-           "\"id\":\"" + guidStr + "\","
-           "\"text\":\"" + textStr + "\","
-           "\"date\":" + std::to_string(date) +
-           "}";
+    std::string json = "{\"id\":\"";
+    json += GuidToUtf8(id);
+    json += "\",\"text\":\"";
+    AppendUtf8(json, text);
+    json += "\",\"date\":";
+    json += std::to_string(date);
+    json += "}";
+    return json;
   }
 };
 
@@ -333,12 +346,7 @@ namespace cpp_code
           SendMessageW(hListBox, LB_DELETESTRING, index, 0);
           g_todos.erase(g_todos.begin() + index);
 
-          OLECHAR *guidString;
-          StringFromCLSID(todoId, &guidString);
-          std::wstring widGuid(guidString);
-          CoTaskMemFree(guidString);
-          std::string guidStr(widGuid.begin(), widGuid.end());
-          NotifyCallback(g_todoDeletedCallback, guidStr);
+          NotifyCallback(g_todoDeletedCallback, GuidToUtf8(todoId));
         }
         break;
       }
@@ -0,0 +1,380 @@
+#include "utf_transcode.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPP_CODE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit instructions of the ISA a function is compiled
+// for; MSVC emits any intrinsic, so there the attribute is not needed.
+#if defined(CPP_CODE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CPP_CODE_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPP_CODE_TARGET(isa)
+#endif
+
+namespace cpp_code
+{
+
+  namespace
+  {
+    // Writes the code point starting at in[i] and advances past it.
+    inline void encode_one(const char16_t *in, size_t &i, size_t length, char *&out)
+    {
+      uint32_t c = in[i++];
+      if (c < 0x80)
+      {
+        *out++ = static_cast<char>(c);
+        return;
+      }
+      if (c < 0x800)
+      {
+        out[0] = static_cast<char>(0xC0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3F));
+        out += 2;
+        return;
+      }
+      if ((c & 0xF800) == 0xD800)
+      {
+        if (c < 0xDC00 && i < length && (in[i] & 0xFC00) == 0xDC00)
+        {
+          uint32_t cp = 0x10000 + ((c - 0xD800) << 10) + (in[i++] - 0xDC00);
+          out[0] = static_cast<char>(0xF0 | (cp >> 18));
+          out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+          out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+          out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+          out += 4;
+          return;
+        }
+        c = 0xFFFD;
+      }
+      out[0] = static_cast<char>(0xE0 | (c >> 12));
+      out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      out[2] = static_cast<char>(0x80 | (c & 0x3F));
+      out += 3;
+    }
+
+    // Encodes from in[i] until at least in[end - 1] is consumed; a pair that
+    // straddles `end` is consumed whole.
+    inline void encode_range(const char16_t *in, size_t &i, size_t end, size_t length, char *&out)
+    {
+      while (i < end)
+      {
+        // ASCII runs go four units at a time.
+        while (i + 4 <= end)
+        {
+          uint64_t word;
+          memcpy(&word, in + i, sizeof(word));
+          if (word & 0xFF80FF80FF80FF80ull)
+            break;
+          out[0] = static_cast<char>(in[i]);
+          out[1] = static_cast<char>(in[i + 1]);
+          out[2] = static_cast<char>(in[i + 2]);
+          out[3] = static_cast<char>(in[i + 3]);
+          i += 4;
+          out += 4;
+        }
+        if (i < end)
+          encode_one(in, i, length, out);
+      }
+    }
+
+    size_t convert_scalar(const char16_t *in, size_t length, char *out)
+    {
+      char *start = out;
+      size_t i = 0;
+      encode_range(in, i, length, length, out);
+      return out - start;
+    }
+
+#if defined(CPP_CODE_X86)
+    // SSE2 has no byte shuffle, so it only speeds up ASCII: eight units are
+    // narrowed at once until the first block that is not all ASCII. Text
+    // with one is rarely ASCII for long, and switching back and forth was
+    // slower than scalar code, so the rest takes the scalar route.
+    CPP_CODE_TARGET("sse2")
+    size_t convert_sse2(const char16_t *in, size_t length, char *out)
+    {
+      char *start = out;
+      size_t i = 0;
+      const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+      const __m128i zero = _mm_setzero_si128();
+
+      while (i + 8 <= length)
+      {
+        __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(units, non_ascii), zero)) == 0xFFFF)
+        {
+          _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(units, units));
+          i += 8;
+          out += 8;
+          continue;
+        }
+        break;
+      }
+      encode_range(in, i, length, length, out);
+      return out - start;
+    }
+
+    // `mask` must not be zero.
+    inline unsigned count_trailing_zeros(unsigned mask)
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return static_cast<unsigned>(index);
+#else
+      return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Byte shuffles that pack four 32-bit lanes, each holding a one- to
+    // three-byte sequence in its low bytes, into consecutive output bytes.
+    // Indexed by (needs two or more bytes) | (needs three bytes) << 4, one bit
+    // per lane in each nibble.
+    struct PackEntry
+    {
+      alignas(16) uint8_t shuffle[16];
+      uint8_t length;
+    };
+
+    struct PackTable
+    {
+      PackEntry entries[256];
+
+      PackTable()
+      {
+        for (unsigned index = 0; index < 256; ++index)
+        {
+          PackEntry &entry = entries[index];
+          memset(entry.shuffle, 0x80, sizeof(entry.shuffle));
+          uint8_t length = 0;
+          for (unsigned lane = 0; lane < 4; ++lane)
+          {
+            unsigned bytes = 1 + ((index >> lane) & 1) + ((index >> (lane + 4)) & 1);
+            for (unsigned b = 0; b < bytes; ++b)
+              entry.shuffle[length++] = static_cast<uint8_t>(lane * 4 + b);
+          }
+          entry.length = length;
+        }
+      }
+    };
+
+    const PackTable &pack_table()
+    {
+      static const PackTable table;
+      return table;
+    }
+
+    // Encodes eight units that contain no surrogates. Writes up to 16 bytes
+    // past the returned end.
+    CPP_CODE_TARGET("avx2")
+    char *encode_bmp8(__m128i units, const PackTable &table, char *out)
+    {
+      const __m256i lane_low6 = _mm256_set1_epi32(0x3F);
+      const __m256i continuation = _mm256_set1_epi32(0x80);
+
+      __m256i w = _mm256_cvtepu16_epi32(units);
+      __m256i low = _mm256_or_si256(_mm256_and_si256(w, lane_low6), continuation);
+      __m256i mid = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(w, 6), lane_low6), continuation);
+
+      // Each 32-bit lane holds its sequence in output order, low byte first.
+      __m256i two = _mm256_or_si256(
+          _mm256_or_si256(_mm256_srli_epi32(w, 6), _mm256_set1_epi32(0xC0)),
+          _mm256_slli_epi32(low, 8));
+      __m256i three = _mm256_or_si256(
+          _mm256_or_si256(_mm256_srli_epi32(w, 12), _mm256_set1_epi32(0xE0)),
+          _mm256_or_si256(_mm256_slli_epi32(mid, 8), _mm256_slli_epi32(low, 16)));
+
+      __m256i is_one = _mm256_cmpgt_epi32(_mm256_set1_epi32(0x80), w);
+      __m256i is_two = _mm256_cmpgt_epi32(_mm256_set1_epi32(0x800), w);
+      __m256i bytes = _mm256_blendv_epi8(three, two, is_two);
+      bytes = _mm256_blendv_epi8(bytes, w, is_one);
+
+      unsigned multi = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(is_one))) & 0xFF;
+      unsigned wide = ~static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(is_two))) & 0xFF;
+
+      const PackEntry &first = table.entries[(multi & 0x0F) | ((wide & 0x0F) << 4)];
+      const PackEntry &second = table.entries[(multi >> 4) | (wide & 0xF0)];
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                       _mm_shuffle_epi8(_mm256_castsi256_si128(bytes),
+                                        _mm_load_si128(reinterpret_cast<const __m128i *>(first.shuffle))));
+      out += first.length;
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                       _mm_shuffle_epi8(_mm256_extracti128_si256(bytes, 1),
+                                        _mm_load_si128(reinterpret_cast<const __m128i *>(second.shuffle))));
+      return out + second.length;
+    }
+
+    // Sixteen ASCII units are narrowed at once; otherwise the next eight units
+    // are encoded with shuffles, or up to their first surrogate if they hold
+    // one. Blocks are only taken while 16 units remain, which leaves room in
+    // `out` for the overlong stores.
+    CPP_CODE_TARGET("avx2")
+    size_t convert_avx2(const char16_t *in, size_t length, char *out)
+    {
+      const PackTable &table = pack_table();
+      char *start = out;
+      size_t i = 0;
+      const __m256i non_ascii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+      const __m128i surrogate_bits = _mm_set1_epi16(static_cast<short>(0xF800));
+      const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+      const __m128i zero = _mm_setzero_si128();
+
+      while (i + 16 <= length)
+      {
+        __m256i units = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        if (_mm256_testz_si256(units, non_ascii))
+        {
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(out),
+                           _mm_packus_epi16(_mm256_castsi256_si128(units), _mm256_extracti128_si256(units, 1)));
+          i += 16;
+          out += 16;
+          continue;
+        }
+
+        __m128i half = _mm256_castsi256_si128(units);
+        unsigned ascii = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(half, _mm256_castsi256_si128(non_ascii)), zero)));
+        unsigned surrogates = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(half, surrogate_bits), surrogate)));
+        if (surrogates == 0)
+        {
+          if (ascii == 0xFFFF)
+          {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(half, half));
+            out += 8;
+          }
+          else
+          {
+            out = encode_bmp8(half, table, out);
+          }
+          i += 8;
+          continue;
+        }
+
+        // Masks have two bits per unit. Narrow an ASCII prefix in one store
+        // (the bytes past it are overwritten or dropped), then encode the
+        // first surrogate, usually a pair, with the scalar code.
+        unsigned first = count_trailing_zeros(surrogates) / 2;
+        unsigned prefix = (1u << (2 * first)) - 1;
+        if ((ascii & prefix) == prefix)
+        {
+          _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(half, half));
+          out += first;
+          i += first;
+        }
+        else
+        {
+          encode_range(in, i, i + first, length, out);
+        }
+        encode_one(in, i, length, out);
+      }
+      encode_range(in, i, length, length, out);
+      return out - start;
+    }
+#endif
+
+    bool cpu_has_sse2()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+      return true;
+#elif !defined(CPP_CODE_X86)
+      return false;
+#elif defined(_MSC_VER)
+      int regs[4];
+      __cpuid(regs, 1);
+      return (regs[3] & (1 << 26)) != 0;
+#else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse2");
+#endif
+    }
+
+    bool cpu_has_avx2()
+    {
+#if !defined(CPP_CODE_X86)
+      return false;
+#elif defined(_MSC_VER)
+      int regs[4];
+      __cpuid(regs, 0);
+      if (regs[0] < 7)
+        return false;
+      // The OS must also save the YMM registers on context switches.
+      __cpuid(regs, 1);
+      if (!(regs[2] & (1 << 27)) || !(regs[2] & (1 << 28)) || (_xgetbv(0) & 6) != 6)
+        return false;
+      __cpuidex(regs, 7, 0);
+      return (regs[1] & (1 << 5)) != 0;
+#else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    using Converter = size_t (*)(const char16_t *, size_t, char *);
+
+    Converter best_converter()
+    {
+#if defined(CPP_CODE_X86)
+      if (cpu_has_avx2())
+        return convert_avx2;
+      if (cpu_has_sse2())
+        return convert_sse2;
+#endif
+      return convert_scalar;
+    }
+  }
+
+  size_t utf16_to_utf8(const char16_t *in, size_t length, char *out)
+  {
+    static const Converter convert = best_converter();
+    return convert(in, length, out);
+  }
+
+  void append_utf8(std::string &out, const char16_t *in, size_t length)
+  {
+    size_t size = out.size();
+    out.resize(size + utf8_bound(length));
+    out.resize(size + utf16_to_utf8(in, length, &out[size]));
+  }
+
+  std::string utf16_to_utf8(const std::u16string &in)
+  {
+    std::string out;
+    append_utf8(out, in.data(), in.size());
+    return out;
+  }
+
+  bool utf16_path_supported(Utf16Path path)
+  {
+    switch (path)
+    {
+    case Utf16Path::Scalar:
+      return true;
+    case Utf16Path::Sse2:
+      return cpu_has_sse2();
+    case Utf16Path::Avx2:
+      return cpu_has_avx2();
+    }
+    return false;
+  }
+
+  size_t utf16_to_utf8(Utf16Path path, const char16_t *in, size_t length, char *out)
+  {
+#if defined(CPP_CODE_X86)
+    if (path == Utf16Path::Avx2)
+      return convert_avx2(in, length, out);
+    if (path == Utf16Path::Sse2)
+      return convert_sse2(in, length, out);
+#endif
+    return convert_scalar(in, length, out);
+  }
+
+} // namespace cpp_code